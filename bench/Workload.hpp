@@ -0,0 +1,217 @@
+#ifndef ROMZ_AMITTAI_BTREE_WORKLOAD_H
+#define ROMZ_AMITTAI_BTREE_WORKLOAD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "BPlusTree.hpp"
+#include "PerfCounters.hpp"
+#include "PerfProfile.hpp"
+#include "Zipfian.hpp"
+
+//
+// Key generators and container adapters shared by the benchmarks.
+//
+// The benchmarks are templates over an adapter, so that each one runs
+// on the B+ tree and on std::map. Their arguments are the order (ignored
+// by std::map) and the number of keys.
+//
+
+namespace workload
+{
+
+//
+// Keys 0, 2, 4, ...; the odd keys in between are misses.
+//
+inline std::vector< std::int64_t > sequential_keys( std::size_t key_no )
+{
+    std::vector< std::int64_t > keys( key_no );
+    for( std::size_t i = 0; i < key_no; i++ )
+    {
+        keys[ i ] = 2 * static_cast< std::int64_t >( i );
+    }
+    return keys;
+}
+
+//
+// The sequential keys in random order.
+//
+inline std::vector< std::int64_t > random_keys( std::size_t key_no, unsigned seed )
+{
+    std::vector< std::int64_t > keys = sequential_keys( key_no );
+    std::shuffle( keys.begin(), keys.end(), std::mt19937( seed ) );
+    return keys;
+}
+
+//
+// "count" keys drawn from the sequential keys with Zipfian popularity.
+//
+inline std::vector< std::int64_t > zipfian_keys( std::size_t key_no, std::size_t count, unsigned seed )
+{
+    std::mt19937_64 rng( seed );
+    Zipfian zipf( key_no );
+    std::vector< std::int64_t > keys( count );
+    for( auto& key : keys )
+    {
+        key = 2 * static_cast< std::int64_t >( zipf( rng ) );
+    }
+    return keys;
+}
+
+//
+//
+//
+class TreeAdapter
+{
+public:
+    explicit TreeAdapter( std::size_t order ) : m_tree( order ) {}
+
+    void insert( std::int64_t key, ValueType value ) { m_tree.insert_or_assign( key, value ); }
+    bool find( std::int64_t key ) const { return m_tree.search( key ) != nullptr; }
+    void remove( std::int64_t key ) { m_tree.remove( key ); }
+
+    ValueType scan( std::int64_t lo, std::int64_t hi ) const
+    {
+        ValueType sum = 0;
+        m_tree.scan( lo, hi, [ &sum ]( const KeyType&, const Record* rec ){ sum += rec->value(); } );
+        return sum;
+    }
+
+private:
+    BPlusTree m_tree;
+};
+
+//
+//
+//
+class MapAdapter
+{
+public:
+    explicit MapAdapter( std::size_t ) {}
+
+    void insert( std::int64_t key, ValueType value ) { m_map[ key ] = value; }
+    bool find( std::int64_t key ) const { return m_map.find( key ) != m_map.end(); }
+    void remove( std::int64_t key ) { m_map.erase( key ); }
+
+    ValueType scan( std::int64_t lo, std::int64_t hi ) const
+    {
+        ValueType sum = 0;
+        for( auto it = m_map.lower_bound( lo ); it != m_map.end() && it->first <= hi; ++it )
+        {
+            sum += it->second;
+        }
+        return sum;
+    }
+
+private:
+    std::map< std::int64_t, ValueType > m_map;
+};
+
+//
+// Hardware events of a benchmark loop, reported per item as user
+// counters, e.g. "llc_misses/op". Events the machine does not count are
+// left out. With BTREE_PERF the hot paths of the tree are reported as
+// well, e.g. "find_leaf.cycles/op".
+//
+class Measurement
+{
+public:
+    Measurement()
+    {
+        PerfProfile::reset();
+        m_counters.start();
+    }
+
+    void pause() { m_counters.stop(); }
+    void resume() { m_counters.start(); }
+
+    void report( benchmark::State& state, std::int64_t items )
+    {
+        m_counters.stop();
+        if( items <= 0 )
+        {
+            return;
+        }
+
+        const auto per_item = [ items ]( std::uint64_t n ){ return static_cast< double >( n ) / static_cast< double >( items ); };
+        const PerfCounters::Values values = m_counters.read();
+        for( int e = 0; e < PerfCounters::EVENT_NO; e++ )
+        {
+            const auto event = static_cast< PerfCounters::Event >( e );
+            if( m_counters.available( event ) )
+            {
+                state.counters[ std::string( PerfCounters::name( event ) ) + "/op" ] = per_item( values[ e ] );
+            }
+        }
+
+#ifdef BTREE_PERF
+        for( int r = 0; r < PerfProfile::REGION_NO; r++ )
+        {
+            const auto region = static_cast< PerfProfile::Region >( r );
+            const PerfProfile::Totals totals = PerfProfile::totals( region );
+            if( !totals.m_calls )
+            {
+                continue;
+            }
+            const std::string prefix = std::string( PerfProfile::name( region ) ) + ".";
+            state.counters[ prefix + "calls/op" ] = per_item( totals.m_calls );
+            for( int e = 0; e < PerfCounters::EVENT_NO; e++ )
+            {
+                const auto event = static_cast< PerfCounters::Event >( e );
+                if( PerfProfile::counters().available( event ) )
+                {
+                    state.counters[ prefix + PerfCounters::name( event ) + "/op" ] = per_item( totals.m_values[ e ] );
+                }
+            }
+        }
+#endif
+    }
+
+private:
+    PerfCounters m_counters;
+};
+
+//
+// Orders 16, 64 and 256 with 10^4, 10^5 and 10^6 keys.
+//
+inline void tree_args( benchmark::internal::Benchmark* b )
+{
+    for( std::int64_t order : { 16, 64, 256 } )
+    {
+        for( std::int64_t key_no : { 10000, 100000, 1000000 } )
+        {
+            b->Args( { order, key_no } );
+        }
+    }
+}
+
+//
+//
+//
+inline void map_args( benchmark::internal::Benchmark* b )
+{
+    for( std::int64_t key_no : { 10000, 100000, 1000000 } )
+    {
+        b->Args( { 0, key_no } );
+    }
+}
+
+//
+//
+//
+template < typename Container >
+void fill( Container& c, const std::vector< std::int64_t >& keys )
+{
+    for( auto key : keys )
+    {
+        c.insert( key, key );
+    }
+}
+
+}
+
+#endif
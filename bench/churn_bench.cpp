@@ -0,0 +1,89 @@
+#include "benchmark/benchmark.h"
+#include "BPlusTree.hpp"
+#include <cstdint>
+#include <deque>
+#include <random>
+
+//
+// Churn near the minimum node size: ascending inserts leave every leaf
+// at its minimum, then keys are removed and put back a few operations
+// later. Each policy reports the entries it moved per operation.
+//
+// Arguments: order, and the policy (0 EAGER, 1 THRESHOLD at a quarter
+// of the order, 2 AT_EMPTY, 3 AT_EMPTY with a compact() per iteration).
+//
+
+namespace
+{
+
+const std::int64_t KEY_NO = 50000;
+const std::size_t OP_NO = 50000;
+const std::size_t DELAY = 16;
+
+void set_policy( BPlusTree& tree, std::int64_t policy )
+{
+    switch( policy )
+    {
+    case 1:
+        tree.set_underflow_policy( UnderflowPolicy::THRESHOLD, tree.leaf_max_size() / 4 );
+        break;
+    case 2:
+    case 3:
+        tree.set_underflow_policy( UnderflowPolicy::AT_EMPTY );
+        break;
+    default:
+        tree.set_underflow_policy( UnderflowPolicy::EAGER );
+        break;
+    }
+}
+
+}
+
+//
+//
+//
+static void BM_churn( benchmark::State& state )
+{
+    BPlusTree tree( static_cast< std::size_t >( state.range( 0 ) ) );
+    set_policy( tree, state.range( 1 ) );
+    for( std::int64_t key = 0; key < KEY_NO; key++ )
+    {
+        tree.insert( key, key );
+    }
+    tree.reset_rebalance_counters();
+
+    std::mt19937 rng( 1 );
+    std::uniform_int_distribution< std::int64_t > dist( 0, KEY_NO - 1 );
+    std::deque< std::int64_t > removed;
+
+    for( auto _ : state )
+    {
+        for( std::size_t i = 0; i < OP_NO; i++ )
+        {
+            const std::int64_t key = dist( rng );
+            if( tree.search( key ) )
+            {
+                tree.remove( key );
+                removed.push_back( key );
+            }
+            if( removed.size() > DELAY )
+            {
+                tree.insert( removed.front(), removed.front() );
+                removed.pop_front();
+            }
+        }
+        if( state.range( 1 ) == 3 )
+        {
+            tree.compact();
+        }
+    }
+
+    const RebalanceCounters& counters = tree.rebalance_counters();
+    const double op_no = static_cast< double >( state.iterations() * OP_NO );
+    state.counters[ "moved_per_op" ] = static_cast< double >( counters.m_moved ) / op_no;
+    state.counters[ "splits" ] = static_cast< double >( counters.m_splits );
+    state.counters[ "merges" ] = static_cast< double >( counters.m_merges );
+    state.counters[ "deferred" ] = static_cast< double >( tree.deferred_underflows() );
+    state.SetItemsProcessed( state.iterations() * static_cast< std::int64_t >( OP_NO ) );
+}
+BENCHMARK( BM_churn )->ArgsProduct( { { 16, 128 }, { 0, 1, 2, 3 } } )->Unit( benchmark::kMillisecond );
@@ -0,0 +1,99 @@
+#include "benchmark/benchmark.h"
+#include "BPlusTree.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//
+// Delete-heavy workloads. Each iteration builds a tree of "key_no"
+// keys with the clock paused, and then times the removals, so that
+// the cost of underflow handling dominates.
+//
+
+namespace
+{
+
+const std::size_t KEY_NO = 100000;
+
+std::vector< std::int64_t > shuffled_keys( std::size_t key_no, unsigned seed )
+{
+    std::vector< std::int64_t > keys( key_no );
+    for( std::size_t i = 0; i < key_no; i++ )
+    {
+        keys[ i ] = static_cast< std::int64_t >( i );
+    }
+    std::shuffle( keys.begin(), keys.end(), std::mt19937( seed ) );
+    return keys;
+}
+
+}
+
+//
+// Remove every key in random order, until the tree is empty.
+//
+static void BM_remove_all( benchmark::State& state )
+{
+    const std::size_t order = static_cast< std::size_t >( state.range( 0 ) );
+    const auto keys = shuffled_keys( KEY_NO, 1 );
+    const auto victims = shuffled_keys( KEY_NO, 2 );
+
+    for( auto _ : state )
+    {
+        state.PauseTiming();
+        BPlusTree tree( order );
+        for( auto key : keys )
+        {
+            tree.insert( key, key );
+        }
+        state.ResumeTiming();
+
+        for( auto key : victims )
+        {
+            tree.remove( key );
+        }
+        benchmark::DoNotOptimize( tree.is_empty() );
+    }
+    state.SetItemsProcessed( state.iterations() * static_cast< std::int64_t >( KEY_NO ) );
+}
+BENCHMARK( BM_remove_all )->Arg( 16 )->Arg( 64 )->Arg( 256 )->Arg( 1024 )->Unit( benchmark::kMillisecond );
+
+//
+// Three removals for every insertion, on a tree that starts full
+// and shrinks to half of its size.
+//
+static void BM_remove_mostly( benchmark::State& state )
+{
+    const std::size_t order = static_cast< std::size_t >( state.range( 0 ) );
+    const auto keys = shuffled_keys( KEY_NO, 1 );
+    const std::size_t op_no = KEY_NO / 2;
+
+    for( auto _ : state )
+    {
+        state.PauseTiming();
+        BPlusTree tree( order );
+        for( auto key : keys )
+        {
+            tree.insert( key, key );
+        }
+        std::mt19937 rng( 3 );
+        std::uniform_int_distribution< std::int64_t > dist( 0, static_cast< std::int64_t >( KEY_NO ) - 1 );
+        state.ResumeTiming();
+
+        for( std::size_t i = 0; i < op_no; i++ )
+        {
+            const std::int64_t key = dist( rng );
+            if( i % 4 == 3 )
+            {
+                tree.try_insert( key, key );
+            }
+            else
+            {
+                tree.remove( key );
+            }
+        }
+        benchmark::DoNotOptimize( tree.is_empty() );
+    }
+    state.SetItemsProcessed( state.iterations() * static_cast< std::int64_t >( op_no ) );
+}
+BENCHMARK( BM_remove_mostly )->Arg( 16 )->Arg( 64 )->Arg( 256 )->Arg( 1024 )->Unit( benchmark::kMillisecond );
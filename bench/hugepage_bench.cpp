@@ -0,0 +1,70 @@
+#include "benchmark/benchmark.h"
+#include "BPlusTree.hpp"
+#include "EntryArenas.hpp"
+#include "InternalNode.hpp"
+#include "LeafNode.hpp"
+#include "Workload.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//
+// Random lookups in a tree whose nodes lie on normal pages
+// ( range( 0 ) == 0 ), on transparent huge pages ( range( 0 ) == 1 ) or
+// on pages of the huge page pool ( range( 0 ) == 2 ); "range( 1 )" is the
+// number of keys. The descents of a tree much larger than the TLB reach
+// miss it at almost every node and entry array on normal pages;
+// "dtlb_misses/op" shows the difference where the machine counts it,
+// "huge_fraction" the share of node and entry memory the system did back
+// with huge pages.
+//
+
+namespace
+{
+
+const std::size_t ORDER = 16;
+const std::size_t LOOKUP_NO = 1000000;
+
+}
+
+//
+//
+//
+static void BM_lookup_pages( benchmark::State& state )
+{
+    const auto mode = static_cast< NodeArena::PageMode >( state.range( 0 ) );
+    const std::size_t key_no = static_cast< std::size_t >( state.range( 1 ) );
+
+    BPlusTree::set_page_mode( mode );
+    workload::TreeAdapter tree( ORDER );
+    workload::fill( tree, workload::random_keys( key_no, 1 ) );
+    BPlusTree::set_page_mode( NodeArena::SMALL_PAGES );
+
+    const std::size_t bytes = LeafNode::arena().bytes() + InternalNode::arena().bytes() + EntryArenas::bytes();
+    const std::size_t huge_bytes = LeafNode::arena().huge_bytes() + InternalNode::arena().huge_bytes() + EntryArenas::huge_bytes();
+
+    std::mt19937 rng( 2 );
+    std::uniform_int_distribution< std::int64_t > dist( 0, static_cast< std::int64_t >( key_no ) - 1 );
+    std::vector< std::int64_t > trace( LOOKUP_NO );
+    for( auto& key : trace )
+    {
+        // The keys present, which are even.
+        key = 2 * dist( rng );
+    }
+
+    workload::Measurement measurement;
+    for( auto _ : state )
+    {
+        for( auto key : trace )
+        {
+            benchmark::DoNotOptimize( tree.find( key ) );
+        }
+    }
+    const std::int64_t items = state.iterations() * static_cast< std::int64_t >( LOOKUP_NO );
+    state.SetItemsProcessed( items );
+    measurement.report( state, items );
+    state.counters[ "huge_fraction" ] = bytes ? static_cast< double >( huge_bytes ) / static_cast< double >( bytes ) : 0.0;
+}
+BENCHMARK( BM_lookup_pages )
+    ->ArgsProduct( { { NodeArena::SMALL_PAGES, NodeArena::TRANSPARENT_HUGE_PAGES, NodeArena::HUGE_PAGES }, { 1 << 20, 1 << 22 } } )
+    ->Unit( benchmark::kMillisecond );
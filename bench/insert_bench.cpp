@@ -0,0 +1,72 @@
+#include "benchmark/benchmark.h"
+#include "Workload.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//
+// Build a container of "range( 1 )" keys from scratch in every iteration.
+// Freeing it is not timed.
+//
+
+namespace
+{
+
+template < typename Container >
+void insert_all( benchmark::State& state, const std::vector< std::int64_t >& keys )
+{
+    const std::size_t order = static_cast< std::size_t >( state.range( 0 ) );
+
+    workload::Measurement measurement;
+    for( auto _ : state )
+    {
+        std::unique_ptr< Container > c( new Container( order ) );
+        workload::fill( *c, keys );
+
+        state.PauseTiming();
+        measurement.pause();
+        c.reset();
+        measurement.resume();
+        state.ResumeTiming();
+    }
+    const std::int64_t items = state.iterations() * static_cast< std::int64_t >( keys.size() );
+    state.SetItemsProcessed( items );
+    measurement.report( state, items );
+}
+
+}
+
+//
+//
+//
+template < typename Container >
+static void BM_insert_sequential( benchmark::State& state )
+{
+    insert_all< Container >( state, workload::sequential_keys( static_cast< std::size_t >( state.range( 1 ) ) ) );
+}
+BENCHMARK_TEMPLATE( BM_insert_sequential, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_insert_sequential, workload::MapAdapter )->Apply( workload::map_args );
+
+//
+//
+//
+template < typename Container >
+static void BM_insert_random( benchmark::State& state )
+{
+    insert_all< Container >( state, workload::random_keys( static_cast< std::size_t >( state.range( 1 ) ), 1 ) );
+}
+BENCHMARK_TEMPLATE( BM_insert_random, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_insert_random, workload::MapAdapter )->Apply( workload::map_args );
+
+//
+// Popular keys repeat, so most inserts overwrite the value of a key
+// already present.
+//
+template < typename Container >
+static void BM_insert_zipfian( benchmark::State& state )
+{
+    const std::size_t key_no = static_cast< std::size_t >( state.range( 1 ) );
+    insert_all< Container >( state, workload::zipfian_keys( key_no, key_no, 1 ) );
+}
+BENCHMARK_TEMPLATE( BM_insert_zipfian, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_insert_zipfian, workload::MapAdapter )->Apply( workload::map_args );
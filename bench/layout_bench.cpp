@@ -0,0 +1,94 @@
+#include "benchmark/benchmark.h"
+#include "BPlusTree.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//
+// Scans and lookups on a tree whose nodes are scattered by random
+// inserts and removals, before ( range( 1 ) == 0 ) and after
+// ( range( 1 ) == 1 ) a relayout; "range( 0 )" is the order.
+//
+
+namespace
+{
+
+const std::int64_t KEY_NO = 200000;
+const std::size_t LOOKUP_NO = 100000;
+
+void build( BPlusTree& tree, bool relayout )
+{
+    std::mt19937 rng( 1 );
+    std::vector< std::int64_t > keys( KEY_NO * 2 );
+    for( std::size_t i = 0; i < keys.size(); i++ )
+    {
+        keys[ i ] = static_cast< std::int64_t >( i );
+    }
+    std::shuffle( keys.begin(), keys.end(), rng );
+
+    // Every other key goes again, so that later nodes reuse freed slots.
+    for( auto key : keys )
+    {
+        tree.insert( key, key );
+    }
+    for( auto key : keys )
+    {
+        if( key % 2 )
+        {
+            tree.remove( key );
+        }
+    }
+
+    if( relayout )
+    {
+        tree.relayout();
+    }
+}
+
+}
+
+//
+//
+//
+static void BM_scan_layout( benchmark::State& state )
+{
+    BPlusTree tree( static_cast< std::size_t >( state.range( 0 ) ) );
+    build( tree, state.range( 1 ) != 0 );
+
+    for( auto _ : state )
+    {
+        ValueType sum = 0;
+        tree.scan( 0, 2 * KEY_NO, [ &sum ]( const KeyType&, const Record* rec ){ sum += rec->value(); } );
+        benchmark::DoNotOptimize( sum );
+    }
+    state.SetItemsProcessed( state.iterations() * KEY_NO );
+}
+BENCHMARK( BM_scan_layout )->Args( { 16, 0 } )->Args( { 16, 1 } )->Args( { 128, 0 } )->Args( { 128, 1 } );
+
+//
+//
+//
+static void BM_lookup_layout( benchmark::State& state )
+{
+    BPlusTree tree( static_cast< std::size_t >( state.range( 0 ) ) );
+    build( tree, state.range( 1 ) != 0 );
+
+    std::mt19937 rng( 2 );
+    std::uniform_int_distribution< std::int64_t > dist( 0, KEY_NO - 1 );
+    std::vector< std::int64_t > trace( LOOKUP_NO );
+    for( auto& key : trace )
+    {
+        key = 2 * dist( rng );
+    }
+
+    for( auto _ : state )
+    {
+        for( auto key : trace )
+        {
+            benchmark::DoNotOptimize( tree.search( key ) );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * static_cast< std::int64_t >( LOOKUP_NO ) );
+}
+BENCHMARK( BM_lookup_layout )->Args( { 16, 0 } )->Args( { 16, 1 } )->Args( { 128, 0 } )->Args( { 128, 1 } );
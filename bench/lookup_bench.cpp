@@ -0,0 +1,81 @@
+#include "benchmark/benchmark.h"
+#include "Workload.hpp"
+#include <cstdint>
+#include <vector>
+
+//
+// Point lookups in a container of "range( 1 )" keys, in batches of
+// LOOKUP_NO.
+//
+
+namespace
+{
+
+const std::size_t LOOKUP_NO = 100000;
+
+template < typename Container >
+void lookup_all( benchmark::State& state, const std::vector< std::int64_t >& trace )
+{
+    const std::size_t key_no = static_cast< std::size_t >( state.range( 1 ) );
+    Container c( static_cast< std::size_t >( state.range( 0 ) ) );
+    workload::fill( c, workload::random_keys( key_no, 1 ) );
+
+    workload::Measurement measurement;
+    for( auto _ : state )
+    {
+        for( auto key : trace )
+        {
+            benchmark::DoNotOptimize( c.find( key ) );
+        }
+    }
+    const std::int64_t items = state.iterations() * static_cast< std::int64_t >( trace.size() );
+    state.SetItemsProcessed( items );
+    measurement.report( state, items );
+}
+
+std::vector< std::int64_t > uniform_trace( std::size_t key_no, std::int64_t offset )
+{
+    std::mt19937 rng( 2 );
+    std::uniform_int_distribution< std::size_t > dist( 0, key_no - 1 );
+    std::vector< std::int64_t > trace( LOOKUP_NO );
+    for( auto& key : trace )
+    {
+        key = 2 * static_cast< std::int64_t >( dist( rng ) ) + offset;
+    }
+    return trace;
+}
+
+}
+
+//
+//
+//
+template < typename Container >
+static void BM_lookup_hit( benchmark::State& state )
+{
+    lookup_all< Container >( state, uniform_trace( static_cast< std::size_t >( state.range( 1 ) ), 0 ) );
+}
+BENCHMARK_TEMPLATE( BM_lookup_hit, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_lookup_hit, workload::MapAdapter )->Apply( workload::map_args );
+
+//
+// The keys are even, so odd keys miss, within the key range.
+//
+template < typename Container >
+static void BM_lookup_miss( benchmark::State& state )
+{
+    lookup_all< Container >( state, uniform_trace( static_cast< std::size_t >( state.range( 1 ) ), 1 ) );
+}
+BENCHMARK_TEMPLATE( BM_lookup_miss, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_lookup_miss, workload::MapAdapter )->Apply( workload::map_args );
+
+//
+//
+//
+template < typename Container >
+static void BM_lookup_zipfian( benchmark::State& state )
+{
+    lookup_all< Container >( state, workload::zipfian_keys( static_cast< std::size_t >( state.range( 1 ) ), LOOKUP_NO, 2 ) );
+}
+BENCHMARK_TEMPLATE( BM_lookup_zipfian, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_lookup_zipfian, workload::MapAdapter )->Apply( workload::map_args );
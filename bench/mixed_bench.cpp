@@ -0,0 +1,125 @@
+#include "benchmark/benchmark.h"
+#include "Workload.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//
+// Mixed workloads on a container of "range( 1 )" keys. The operations
+// are drawn with Zipfian popularity over twice the key range, so that
+// inserts and removes keep the size roughly constant.
+//
+
+namespace
+{
+
+const std::size_t OP_NO = 100000;
+
+enum class Op { LOOKUP, INSERT, REMOVE, SCAN };
+
+struct Step
+{
+    Op m_op;
+    std::int64_t m_key;
+};
+
+//
+// "read_percent" lookups and "scan_percent" short scans; the rest is
+// split evenly between inserts and removes.
+//
+std::vector< Step > mixed_trace( std::size_t key_no, int read_percent, int scan_percent )
+{
+    std::mt19937_64 rng( 3 );
+    Zipfian zipf( 2 * key_no );
+    std::uniform_int_distribution< int > percent( 0, 99 );
+
+    std::vector< Step > trace( OP_NO );
+    for( auto& step : trace )
+    {
+        const int p = percent( rng );
+        if( p < read_percent )
+        {
+            step.m_op = Op::LOOKUP;
+        }
+        else if( p < read_percent + scan_percent )
+        {
+            step.m_op = Op::SCAN;
+        }
+        else
+        {
+            step.m_op = ( p % 2 ) ? Op::INSERT : Op::REMOVE;
+        }
+        step.m_key = static_cast< std::int64_t >( zipf( rng ) );
+    }
+    return trace;
+}
+
+template < typename Container >
+void run_mixed( benchmark::State& state, int read_percent, int scan_percent )
+{
+    const std::size_t key_no = static_cast< std::size_t >( state.range( 1 ) );
+    Container c( static_cast< std::size_t >( state.range( 0 ) ) );
+    workload::fill( c, workload::random_keys( key_no, 1 ) );
+    const auto trace = mixed_trace( key_no, read_percent, scan_percent );
+
+    workload::Measurement measurement;
+    for( auto _ : state )
+    {
+        for( const auto& step : trace )
+        {
+            switch( step.m_op )
+            {
+            case Op::LOOKUP:
+                benchmark::DoNotOptimize( c.find( step.m_key ) );
+                break;
+            case Op::INSERT:
+                c.insert( step.m_key, step.m_key );
+                break;
+            case Op::REMOVE:
+                c.remove( step.m_key );
+                break;
+            case Op::SCAN:
+                benchmark::DoNotOptimize( c.scan( step.m_key, step.m_key + 100 ) );
+                break;
+            }
+        }
+    }
+    const std::int64_t items = state.iterations() * static_cast< std::int64_t >( OP_NO );
+    state.SetItemsProcessed( items );
+    measurement.report( state, items );
+}
+
+}
+
+//
+// 90% lookups, 5% inserts, 5% removes.
+//
+template < typename Container >
+static void BM_mixed_read_heavy( benchmark::State& state )
+{
+    run_mixed< Container >( state, 90, 0 );
+}
+BENCHMARK_TEMPLATE( BM_mixed_read_heavy, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_mixed_read_heavy, workload::MapAdapter )->Apply( workload::map_args );
+
+//
+// 50% lookups, 25% inserts, 25% removes.
+//
+template < typename Container >
+static void BM_mixed_write_heavy( benchmark::State& state )
+{
+    run_mixed< Container >( state, 50, 0 );
+}
+BENCHMARK_TEMPLATE( BM_mixed_write_heavy, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_mixed_write_heavy, workload::MapAdapter )->Apply( workload::map_args );
+
+//
+// 45% lookups, 45% scans of 50 keys, 5% inserts, 5% removes.
+//
+template < typename Container >
+static void BM_mixed_scan( benchmark::State& state )
+{
+    run_mixed< Container >( state, 45, 45 );
+}
+BENCHMARK_TEMPLATE( BM_mixed_scan, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_mixed_scan, workload::MapAdapter )->Apply( workload::map_args );
@@ -0,0 +1,88 @@
+#include "benchmark/benchmark.h"
+#include "BPlusTree.hpp"
+#include "PartitionedTree.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//
+// Concurrent inserts, each thread into a key range of its own. In
+// BM_partitioned_insert every range is a partition of a PartitionedTree,
+// so the threads share no lock; BM_locked_insert puts a single tree
+// behind one mutex, the way a caller of BPlusTree has to share it.
+//
+
+namespace
+{
+
+const std::size_t ORDER = 16;
+const std::int64_t BATCH = 1000;
+const int STRIDE = 40;
+
+std::unique_ptr< PartitionedTree > partitioned;
+
+std::unique_ptr< BPlusTree > locked;
+std::mutex lock;
+
+}
+
+//
+//
+//
+static void BM_partitioned_insert( benchmark::State& state )
+{
+    if( state.thread_index() == 0 )
+    {
+        std::vector< KeyType > split_keys;
+        for( int t = 1; t < state.threads(); t++ )
+        {
+            split_keys.push_back( static_cast< std::int64_t >( t ) << STRIDE );
+        }
+        partitioned.reset( new PartitionedTree( ORDER, split_keys ) );
+    }
+
+    std::int64_t key = static_cast< std::int64_t >( state.thread_index() ) << STRIDE;
+    for( auto _ : state )
+    {
+        for( std::int64_t i = 0; i < BATCH; i++, key++ )
+        {
+            partitioned->insert( key, key );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * BATCH );
+
+    if( state.thread_index() == 0 )
+    {
+        partitioned.reset();
+    }
+}
+BENCHMARK( BM_partitioned_insert )->Threads( 1 )->Threads( 2 )->Threads( 4 )->UseRealTime();
+
+//
+//
+//
+static void BM_locked_insert( benchmark::State& state )
+{
+    if( state.thread_index() == 0 )
+    {
+        locked.reset( new BPlusTree( ORDER ) );
+    }
+
+    std::int64_t key = static_cast< std::int64_t >( state.thread_index() ) << STRIDE;
+    for( auto _ : state )
+    {
+        for( std::int64_t i = 0; i < BATCH; i++, key++ )
+        {
+            std::lock_guard< std::mutex > guard( lock );
+            locked->insert( key, key );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * BATCH );
+
+    if( state.thread_index() == 0 )
+    {
+        locked.reset();
+    }
+}
+BENCHMARK( BM_locked_insert )->Threads( 1 )->Threads( 2 )->Threads( 4 )->UseRealTime();
@@ -0,0 +1,49 @@
+#include "benchmark/benchmark.h"
+#include "Workload.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//
+// Remove all "range( 1 )" keys of a container in random order, until it
+// is empty. Building the container and freeing it are not timed.
+//
+
+//
+//
+//
+template < typename Container >
+static void BM_remove( benchmark::State& state )
+{
+    const std::size_t order = static_cast< std::size_t >( state.range( 0 ) );
+    const std::size_t key_no = static_cast< std::size_t >( state.range( 1 ) );
+    const std::vector< std::int64_t > keys = workload::random_keys( key_no, 1 );
+    const std::vector< std::int64_t > victims = workload::random_keys( key_no, 2 );
+
+    workload::Measurement measurement;
+    for( auto _ : state )
+    {
+        state.PauseTiming();
+        measurement.pause();
+        std::unique_ptr< Container > c( new Container( order ) );
+        workload::fill( *c, keys );
+        measurement.resume();
+        state.ResumeTiming();
+
+        for( auto key : victims )
+        {
+            c->remove( key );
+        }
+
+        state.PauseTiming();
+        measurement.pause();
+        c.reset();
+        measurement.resume();
+        state.ResumeTiming();
+    }
+    const std::int64_t items = state.iterations() * static_cast< std::int64_t >( key_no );
+    state.SetItemsProcessed( items );
+    measurement.report( state, items );
+}
+BENCHMARK_TEMPLATE( BM_remove, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_remove, workload::MapAdapter )->Apply( workload::map_args );
@@ -0,0 +1,51 @@
+#include "benchmark/benchmark.h"
+#include "Workload.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//
+// Range scans of SCAN_LEN keys from random start keys, in a container
+// of "range( 1 )" keys.
+//
+
+namespace
+{
+
+const std::size_t SCAN_NO = 1000;
+const std::int64_t SCAN_LEN = 100;
+
+}
+
+//
+//
+//
+template < typename Container >
+static void BM_scan( benchmark::State& state )
+{
+    const std::size_t key_no = static_cast< std::size_t >( state.range( 1 ) );
+    Container c( static_cast< std::size_t >( state.range( 0 ) ) );
+    workload::fill( c, workload::random_keys( key_no, 1 ) );
+
+    std::mt19937 rng( 2 );
+    std::uniform_int_distribution< std::size_t > dist( 0, key_no - 1 );
+    std::vector< std::int64_t > starts( SCAN_NO );
+    for( auto& key : starts )
+    {
+        key = 2 * static_cast< std::int64_t >( dist( rng ) );
+    }
+
+    workload::Measurement measurement;
+    for( auto _ : state )
+    {
+        for( auto lo : starts )
+        {
+            benchmark::DoNotOptimize( c.scan( lo, lo + 2 * ( SCAN_LEN - 1 ) ) );
+        }
+    }
+    const std::int64_t items = state.iterations() * static_cast< std::int64_t >( SCAN_NO ) * SCAN_LEN;
+    state.SetItemsProcessed( items );
+    measurement.report( state, items );
+}
+BENCHMARK_TEMPLATE( BM_scan, workload::TreeAdapter )->Apply( workload::tree_args );
+BENCHMARK_TEMPLATE( BM_scan, workload::MapAdapter )->Apply( workload::map_args );
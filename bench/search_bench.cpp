@@ -0,0 +1,85 @@
+#include "benchmark/benchmark.h"
+#include "BPlusTree.hpp"
+#include "Finger.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//
+// Lookups with key locality: a random walk with steps of up to
+// "range( 1 )" keys, over a tree of KEY_NO keys of order "range( 0 )".
+//
+
+namespace
+{
+
+const std::int64_t KEY_NO = 100000;
+const std::size_t TRACE_LEN = 100000;
+
+std::vector< std::int64_t > random_walk( std::int64_t step )
+{
+    std::mt19937 rng( 1 );
+    std::uniform_int_distribution< std::int64_t > dist( -step, step );
+
+    std::vector< std::int64_t > trace( TRACE_LEN );
+    std::int64_t key = KEY_NO / 2;
+    for( auto& k : trace )
+    {
+        key = std::max< std::int64_t >( 0, std::min< std::int64_t >( KEY_NO - 1, key + dist( rng ) ) );
+        k = key;
+    }
+    return trace;
+}
+
+void fill( BPlusTree& tree )
+{
+    for( std::int64_t key = 0; key < KEY_NO; key++ )
+    {
+        tree.insert( key, key );
+    }
+}
+
+}
+
+//
+//
+//
+static void BM_search_walk( benchmark::State& state )
+{
+    BPlusTree tree( static_cast< std::size_t >( state.range( 0 ) ) );
+    fill( tree );
+    const auto trace = random_walk( state.range( 1 ) );
+
+    for( auto _ : state )
+    {
+        for( auto key : trace )
+        {
+            benchmark::DoNotOptimize( tree.search( key ) );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * static_cast< std::int64_t >( TRACE_LEN ) );
+}
+BENCHMARK( BM_search_walk )->Args( { 64, 4 } )->Args( { 64, 256 } )->Args( { 256, 4 } )->Args( { 256, 256 } );
+
+//
+//
+//
+static void BM_finger_walk( benchmark::State& state )
+{
+    BPlusTree tree( static_cast< std::size_t >( state.range( 0 ) ) );
+    fill( tree );
+    const auto trace = random_walk( state.range( 1 ) );
+    Finger finger( tree );
+
+    for( auto _ : state )
+    {
+        for( auto key : trace )
+        {
+            benchmark::DoNotOptimize( finger.search( key ) );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * static_cast< std::int64_t >( TRACE_LEN ) );
+    state.counters[ "hit_rate" ] = finger.hit_rate();
+}
+BENCHMARK( BM_finger_walk )->Args( { 64, 4 } )->Args( { 64, 256 } )->Args( { 256, 4 } )->Args( { 256, 256 } );
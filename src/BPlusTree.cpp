@@ -1,17 +1,34 @@
 #include <stdexcept>
 #include <algorithm>
 #include <cassert>
+#include <limits>
+#include <thread>
+#include <vector>
 #include "BPlusTree.hpp"
+#include "BulkLoader.hpp"
+#include "EntryArenas.hpp"
 #include "InternalNode.hpp"
 #include "LeafNode.hpp"
 #include "Node.hpp"
+#include "Numa.hpp"
+#include "Path.hpp"
+#include "PerfProfile.hpp"
+#include "Replicas.hpp"
 
 //
 // Minimum order is necessarily 3.
 //
-BPlusTree::BPlusTree( std::size_t order )
+BPlusTree::BPlusTree( std::size_t order, bool allow_duplicates )
     : m_order{ std::max( order, static_cast< std::size_t >( 3 ) ) }
+    , m_allow_duplicates{ allow_duplicates }
+    , m_top_down{ false }
+    , m_append_mode{ false }
     , m_root{ nullptr }
+    , m_last_leaf{ nullptr }
+    , m_epoch{ 0 }
+    , m_underflow_policy{ UnderflowPolicy::EAGER }
+    , m_merge_threshold{ 0 }
+    , m_deferred_underflows{ 0 }
 {
 
 }
@@ -29,6 +46,7 @@ BPlusTree::~BPlusTree()
 //
 void BPlusTree::destroy_tree()
 {
+    invalidate_caches();
     if( !m_root )
     {
         return;
@@ -56,8 +74,122 @@ bool BPlusTree::is_empty() const
 //
 //
 //
-Record* BPlusTree::search( const KeyType& key ) const
+bool BPlusTree::allows_duplicates() const
 {
+    return m_allow_duplicates;
+}
+
+//
+//
+//
+void BPlusTree::set_top_down( bool top_down )
+{
+    if( top_down == m_top_down )
+    {
+        return;
+    }
+
+    if( !is_empty() )
+    {
+        throw std::runtime_error( "Mode can only be changed on an empty tree" );
+    }
+
+    // With order 3 a preemptive split would leave internal nodes
+    // with a single child.
+    if( top_down && m_order < 4 )
+    {
+        throw std::runtime_error( "Top-down mode requires an order of at least 4" );
+    }
+    m_top_down = top_down;
+}
+
+//
+//
+//
+bool BPlusTree::top_down() const
+{
+    return m_top_down;
+}
+
+//
+//
+//
+void BPlusTree::set_append_mode( bool append_mode )
+{
+    if( m_append_mode && !append_mode )
+    {
+        repair_right_edge();
+        update_replicas();
+    }
+    m_append_mode = append_mode;
+    invalidate_caches();
+}
+
+//
+//
+//
+bool BPlusTree::append_mode() const
+{
+    return m_append_mode;
+}
+
+//
+//
+//
+void BPlusTree::set_underflow_policy( UnderflowPolicy policy, std::size_t threshold )
+{
+    m_underflow_policy = policy;
+    m_merge_threshold = threshold;
+}
+
+//
+//
+//
+UnderflowPolicy BPlusTree::underflow_policy() const
+{
+    return m_underflow_policy;
+}
+
+//
+//
+//
+std::size_t BPlusTree::deferred_underflows() const
+{
+    return m_deferred_underflows;
+}
+
+//
+//
+//
+const RebalanceCounters& BPlusTree::rebalance_counters() const
+{
+    return m_counters;
+}
+
+//
+//
+//
+void BPlusTree::reset_rebalance_counters()
+{
+    m_counters = RebalanceCounters();
+}
+
+#ifdef BTREE_STATS
+//
+//
+//
+Metrics& BPlusTree::metrics() const
+{
+    return m_metrics;
+}
+#endif
+
+//
+//
+//
+const Record* BPlusTree::search( const KeyType& key ) const
+{
+    BTREE_STATS_SCOPE( SEARCHES, SEARCH_LATENCY );
     if( is_empty() )
     {
         return nullptr;
@@ -75,6 +207,7 @@ Record* BPlusTree::search( const KeyType& key ) const
 LeafNode* BPlusTree::find_leaf_node( const KeyType& key )
 {
     assert( !is_empty() );
+    BTREE_PERF_SCOPE( FIND_LEAF );
 
     auto node = m_root;
     while( !node->is_leaf() )
@@ -86,12 +219,39 @@ LeafNode* BPlusTree::find_leaf_node( const KeyType& key )
     return node->leaf();
 }
 
+//
+// As above, recording the internal nodes passed in "path".
+//
+LeafNode* BPlusTree::find_leaf_node( const KeyType& key, Path& path )
+{
+    assert( !is_empty() );
+    BTREE_PERF_SCOPE( FIND_LEAF );
+
+    path.clear();
+    Node* node = m_root;
+    while( !node->is_leaf() )
+    {
+        InternalNode* internalNode = node->internal();
+        const std::size_t index = internalNode->child_index( key );
+        path.push( internalNode, index );
+        node = internalNode->neighbor( index );
+    }
+
+    return node->leaf();
+}
+
 //
 //
 //
 const LeafNode* BPlusTree::find_leaf_node( const KeyType& key ) const
 {
     assert( !is_empty() );
+    BTREE_PERF_SCOPE( FIND_LEAF );
+
+    if( m_replicas )
+    {
+        return m_replicas->find_leaf( m_root, key, m_replicas->local() );
+    }
 
     auto node = m_root;
     while( !node->is_leaf() )
@@ -105,272 +265,1777 @@ const LeafNode* BPlusTree::find_leaf_node( const KeyType& key ) const
 
 
 //
-// INSERTION
+// ORDER STATISTICS
 //
 
 //
 //
 //
-void BPlusTree::insert( const KeyType& key, ValueType value )
+std::size_t BPlusTree::size() const
 {
-    if( is_empty() )
-    {
-        start_new_tree( key, value );
-    }
-    else
-    {
-        insert_into_leaf( key, value );
-    }
+    return m_root ? m_root->summary().m_count : 0;
 }
 
 //
 //
 //
-void BPlusTree::start_new_tree( const KeyType& key, ValueType value )
+std::size_t BPlusTree::rank( const KeyType& key ) const
 {
-    LeafNode* new_leaf = new LeafNode( this, nullptr );
-    new_leaf->insert( key, value );
-    m_root = new_leaf;
+    return count_less( key, false );
 }
 
 //
 //
 //
-void BPlusTree::insert_into_leaf( const KeyType& key, ValueType value )
+std::pair< KeyType, const Record* > BPlusTree::select( std::size_t index ) const
 {
-    LeafNode* leaf = find_leaf_node( key );
-    assert( leaf );
-
-    leaf->insert( key, value );
-    if( leaf->size() > leaf_max_size() )
+    if( index >= size() )
     {
-        //
-        // Split the leaf node
-        //
-        LeafNode* new_leaf = new LeafNode( this, leaf->get_parent() );
-        LeafNode::move_half( leaf, new_leaf );
-
-        new_leaf->set_next( leaf->next() );
-        leaf->set_next( new_leaf );
+        throw std::runtime_error( "Index out of range" );
+    }
 
-        const KeyType new_key = new_leaf->first_key();
-        insert_into_parent( leaf, new_key, new_leaf );
+    const Node* node = m_root;
+    while( !node->is_leaf() )
+    {
+        const InternalNode* internal = node->internal();
+        std::size_t i = 0;
+        while( index >= internal->count_at( i ) )
+        {
+            index -= internal->count_at( i );
+            i++;
+        }
+        node = internal->neighbor( i );
     }
+
+    return std::make_pair( node->leaf()->key_at( index ), node->leaf()->record_at( index ) );
 }
 
 //
 //
 //
-void BPlusTree::insert_into_parent(  Node *old_node, const KeyType& key, Node *new_node )
+std::size_t BPlusTree::count( const KeyType& lo, const KeyType& hi ) const
 {
-    if( old_node->is_root() )
-    {
-        InternalNode* new_root = new InternalNode( this, nullptr );
-        old_node->set_parent( new_root );
-        new_node->set_parent( new_root );
-        new_root->populate_new_root( old_node, key, new_node );
-        m_root = new_root;
-    }
-    else
+    if( hi < lo )
     {
-        InternalNode* parent = old_node->get_parent();
-        assert( parent );
-        parent->insert_after( old_node, key, new_node );
-        if( parent->size() > internal_max_size() )
-        {
-            InternalNode* new_parent = new InternalNode( this, parent->get_parent() );
-            // parent->move_half_to( new_parent );
-            InternalNode::move_half( parent, new_parent );
-
-            const KeyType new_key = new_parent->replace_and_return_first_key();
-            insert_into_parent( parent, new_key, new_parent );
-        }
+        return 0;
     }
+    return count_less( hi, true ) - count_less( lo, false );
 }
 
-
 //
-// REMOVAL
 //
+//
+Summary BPlusTree::aggregate( const KeyType& lo, const KeyType& hi ) const
+{
+    if( is_empty() || hi < lo )
+    {
+        return Summary();
+    }
+    return aggregate_in( m_root, &lo, &hi );
+}
 
 //
 //
 //
-void BPlusTree::remove( const KeyType& key )
+std::size_t BPlusTree::scan( const KeyType& lo, const KeyType& hi, const std::function< void( const KeyType&, const Record* ) >& fn ) const
 {
-    if( is_empty() )
+    if( is_empty() || hi < lo )
     {
-        return;
+        return 0;
     }
-    else
+
+    std::size_t count = 0;
+    const LeafNode* leaf = find_leaf_node( lo );
+    for( std::size_t i = leaf->lower_bound( lo ); leaf; leaf = leaf->next(), i = 0 )
     {
-        remove_from_leaf( key );
+        for( ; i < leaf->size(); i++ )
+        {
+            const KeyType key = leaf->key_at( i );
+            if( hi < key )
+            {
+                return count;
+            }
+            fn( key, leaf->record_at( i ) );
+            count++;
+        }
     }
+    return count;
 }
 
 //
+// The root is counted here, its subtrees on the worker threads, and the
+// partial results are merged one level below the root.
 //
-//
-void BPlusTree::remove_from_leaf( const KeyType& key )
+TreeStats BPlusTree::stats( std::size_t thread_no ) const
 {
-    LeafNode* leafNode = find_leaf_node( key );
-    assert( leafNode );
+    TreeStats stats;
+    if( is_empty() )
+    {
+        return stats;
+    }
 
-    if( !leafNode->lookup( key ) )
+    if( !thread_no )
     {
-        return;
+        thread_no = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+    if( m_root->is_leaf() || thread_no == 1 )
+    {
+        stats_in( m_root, 0, stats );
+        return stats;
     }
 
-    leafNode->remove( key );
-    if( leafNode->size() < leaf_min_size() )
+    const InternalNode* root = m_root->internal();
+    thread_no = std::min( thread_no, root->size() );
+    std::vector< TreeStats > parts( thread_no );
+    const auto worker = [ this, root, thread_no, &parts ]( std::size_t t )
+    {
+        for( std::size_t i = t; i < root->size(); i += thread_no )
+        {
+            stats_in( root->neighbor( i ), 0, parts[ t ] );
+        }
+    };
+
+    std::vector< std::thread > threads;
+    for( std::size_t t = 1; t < thread_no; t++ )
+    {
+        threads.emplace_back( worker, t );
+    }
+    worker( 0 );
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    // The root alone, without descending.
+    TreeStats top;
+    top.m_levels.resize( 1 );
+    LevelStats& level = top.m_levels[ 0 ];
+    level.m_nodes = 1;
+    level.m_entries = root->size();
+    level.m_capacity = internal_max_size();
+    level.m_fill[ std::min( LevelStats::FILL_BUCKET_NO - 1, root->size() * LevelStats::FILL_BUCKET_NO / internal_max_size() ) ]++;
+    if( root->size() > 1 )
+    {
+        level.m_keys = root->size() - 1;
+        level.m_min_key = root->key_at( 1 );
+        level.m_max_key = root->key_at( root->size() - 1 );
+    }
+    top.m_node_bytes = sizeof( InternalNode );
+    top.m_entry_bytes = root->entry_bytes();
+
+    stats.merge( top, 0 );
+    for( const auto& part : parts )
     {
-        coalesce_or_redistribute( leafNode );
+        stats.merge( part, 1 );
     }
+    return stats;
 }
 
 //
 //
 //
-void BPlusTree::coalesce_or_redistribute( LeafNode* node )
+void BPlusTree::stats_in( const Node* node, std::size_t level, TreeStats& stats ) const
 {
-    if( node->is_root() )
+    if( stats.m_levels.size() <= level )
     {
-        adjust_root();
-        return;
+        stats.m_levels.resize( level + 1 );
     }
-    InternalNode* parent = node->get_parent();
-    const std::size_t index_of_node_in_parent = parent->node_index( node );
-    const std::size_t neighbor_index = ( index_of_node_in_parent == 0 ) ? 1 : index_of_node_in_parent - 1;
-    LeafNode* neighbor_node = parent->neighbor( neighbor_index )->leaf();
+    LevelStats& ls = stats.m_levels[ level ];
 
-    if( node->size() + neighbor_node->size() <= leaf_max_size() )
+    const std::size_t capacity = node->is_leaf() ? leaf_max_size() : internal_max_size();
+    ls.m_nodes++;
+    ls.m_entries += node->size();
+    ls.m_capacity = capacity;
+    ls.m_fill[ std::min( LevelStats::FILL_BUCKET_NO - 1, node->size() * LevelStats::FILL_BUCKET_NO / capacity ) ]++;
+
+    // Internal nodes hold keys from the second entry on.
+    const std::size_t first = node->is_leaf() ? 0 : 1;
+    if( node->size() > first )
     {
-        coalesce( neighbor_node, node, parent, index_of_node_in_parent );
+        const KeyType lo = node->is_leaf() ? node->leaf()->first_key() : node->internal()->key_at( first );
+        const KeyType hi = node->is_leaf() ? node->leaf()->last_key() : node->internal()->key_at( node->size() - 1 );
+        ls.m_min_key = ls.m_keys ? std::min( ls.m_min_key, lo ) : lo;
+        ls.m_max_key = ls.m_keys ? std::max( ls.m_max_key, hi ) : hi;
+        ls.m_keys += node->size() - first;
     }
-    else
+
+    if( node->is_leaf() )
+    {
+        const LeafNode* leaf = node->leaf();
+        stats.m_node_bytes += sizeof( LeafNode );
+        stats.m_entry_bytes += leaf->entry_bytes();
+        stats.m_keys += leaf->size();
+        for( std::size_t i = 0; i < leaf->size(); i++ )
+        {
+            const Record* record = leaf->record_at( i );
+            stats.m_values += record->size();
+            stats.m_record_bytes += record->bytes();
+        }
+        return;
+    }
+
+    const InternalNode* internal = node->internal();
+    stats.m_node_bytes += sizeof( InternalNode );
+    stats.m_entry_bytes += internal->entry_bytes();
+    for( std::size_t i = 0; i < internal->size(); i++ )
     {
-        redistribute( neighbor_node, node, index_of_node_in_parent );
+        stats_in( internal->neighbor( i ), level + 1, stats );
     }
 }
 
 //
+// Same walk as erase_in(): the children strictly between the two boundary
+// paths contribute their stored summaries, only the boundary leaves are read.
 //
-//
-void BPlusTree::coalesce_or_redistribute( InternalNode* node )
+Summary BPlusTree::aggregate_in( const Node* node, const KeyType* lo, const KeyType* hi ) const
 {
-    if( node->is_root() )
+    Summary s;
+    if( node->is_leaf() )
     {
-        adjust_root();
-        return;
+        const LeafNode* leaf = node->leaf();
+        for( std::size_t i = lo ? leaf->lower_bound( *lo ) : 0; i < leaf->size(); i++ )
+        {
+            if( hi && *hi < leaf->key_at( i ) )
+            {
+                break;
+            }
+            s.add( leaf->record_at( i )->summary() );
+        }
+        return s;
     }
 
-    InternalNode* parent = node->get_parent();
-    const std::size_t index_of_node_in_parent = parent->node_index( node );
-    const std::size_t neighbor_index = ( index_of_node_in_parent == 0 ) ? 1 : index_of_node_in_parent - 1;
-    InternalNode* neighbor_node = parent->neighbor( neighbor_index )->internal();
+    const InternalNode* internal = node->internal();
+    const std::size_t first = lo ? internal->child_index( *lo ) : 0;
+    const std::size_t last = hi ? internal->child_index( *hi ) : internal->size() - 1;
 
-    if( node->size() + neighbor_node->size() <= internal_max_size() )
+    if( lo && hi && first == last )
     {
-        coalesce( neighbor_node, node, parent, index_of_node_in_parent );
+        return aggregate_in( internal->neighbor( first ), lo, hi );
     }
-    else
+
+    if( lo )
+    {
+        s.add( aggregate_in( internal->neighbor( first ), lo, nullptr ) );
+    }
+
+    const std::size_t b = lo ? first + 1 : 0;
+    const std::size_t e = hi ? last : internal->size();
+    for( std::size_t i = b; i < e; i++ )
     {
-        redistribute( neighbor_node, node, index_of_node_in_parent );
+        s.add( internal->summary_at( i ) );
     }
+
+    if( hi )
+    {
+        s.add( aggregate_in( internal->neighbor( last ), nullptr, hi ) );
+    }
+    return s;
 }
 
 //
+// Number of keys less than "key", or not greater than "key" if "inclusive".
 //
-//
-void BPlusTree::coalesce( LeafNode* neighbor_node, LeafNode* node, InternalNode* parent, std::size_t index )
+std::size_t BPlusTree::count_less( const KeyType& key, bool inclusive ) const
 {
-    if( index == 0 )
+    if( is_empty() )
     {
-        std::swap( node, neighbor_node );
-        index = 1;
+        return 0;
     }
 
-    LeafNode::move_all( node, neighbor_node );
-    parent->remove( index );
+    std::size_t count = 0;
+    const Node* node = m_root;
+    while( !node->is_leaf() )
+    {
+        const InternalNode* internal = node->internal();
+        const std::size_t index = internal->child_index( key );
+        count += internal->count_before( index );
+        node = internal->neighbor( index );
+    }
 
-    if( parent->size() < internal_min_size() )
+    const LeafNode* leaf = node->leaf();
+    const std::size_t index = leaf->lower_bound( key );
+    count += index;
+    if( inclusive && index < leaf->size() && leaf->key_at( index ) == key )
     {
-        coalesce_or_redistribute( parent );
+        count++;
     }
-    delete node;
+    return count;
 }
 
+
+//
+// INSERTION
+//
+
 //
 //
 //
-void BPlusTree::coalesce( InternalNode* neighbor_node, InternalNode* node, InternalNode* parent, std::size_t index )
+void BPlusTree::insert( const KeyType& key, ValueType value )
 {
-    if( index == 0 )
+    BTREE_STATS_SCOPE( INSERTS, INSERT_LATENCY );
+    Path path;
+    const auto found = find_or_insert( key, value, path );
+    if( found.second )
     {
-        std::swap( node, neighbor_node );
-        index = 1;
+        return;
     }
 
-    InternalNode::move_all( node, neighbor_node, index );
+    if( !m_allow_duplicates )
+    {
+        throw std::runtime_error( "Key duplication" );
+    }
+    found.first->add( value );
+    add_to_path( path, Summary::of_value( value ) );
+}
 
-    parent->remove( index );
+//
+//
+//
+std::pair< const Record*, bool > BPlusTree::try_insert( const KeyType& key, ValueType value )
+{
+    BTREE_STATS_SCOPE( INSERTS, INSERT_LATENCY );
+    Path path;
+    return find_or_insert( key, value, path );
+}
 
-    if( parent->size() < internal_min_size() )
+//
+//
+//
+bool BPlusTree::insert_or_assign( const KeyType& key, ValueType value )
+{
+    BTREE_STATS_SCOPE( INSERTS, INSERT_LATENCY );
+    Path path;
+    const auto found = find_or_insert( key, value, path );
+    if( !found.second )
     {
-        coalesce_or_redistribute( parent );
+        const Summary removed = found.first->summary();
+        found.first->set_value( value );
+        replace_on_path( path, removed, found.first->summary() );
     }
-    delete node;
+    return found.second;
 }
 
 //
 //
 //
-void BPlusTree::redistribute( LeafNode* neighbor_node, LeafNode* node, std::size_t index )
+bool BPlusTree::update( const KeyType& key, const std::function< ValueType( ValueType ) >& fn )
 {
-    if( index == 0 )
+    BTREE_STATS_SCOPE( INSERTS, INSERT_LATENCY );
+    if( is_empty() )
     {
-        neighbor_node->move_first_to_end_of( node );
+        return false;
     }
-    else
+
+    Path path;
+    LeafNode* leaf = find_leaf_node( key, path );
+    Record* record = leaf->lookup( key );
+    if( !record )
     {
-        neighbor_node->move_last_to_front_of( node, index );
+        return false;
     }
+
+    const Summary removed = record->summary();
+    record->transform( fn );
+    replace_on_path( path, removed, record->summary() );
+    return true;
 }
 
 //
 //
 //
-void BPlusTree::redistribute( InternalNode* neighbor_node, InternalNode* node, std::size_t index )
+const Record* BPlusTree::upsert( const KeyType& key, ValueType value, const std::function< ValueType( ValueType ) >& fn )
 {
-    if ( index == 0 )
+    BTREE_STATS_SCOPE( INSERTS, INSERT_LATENCY );
+    Path path;
+    const auto found = find_or_insert( key, value, path );
+    if( !found.second )
     {
-        neighbor_node->move_first_to_end_of( node );
-    }
-    else
-    {
-        neighbor_node->move_last_to_front_of( node, index );
+        const Summary removed = found.first->summary();
+        found.first->transform( fn );
+        replace_on_path( path, removed, found.first->summary() );
     }
+    return found.first;
 }
 
 //
+// Single descent: returns the record of an existing key, or inserts the
+// pair into the leaf reached and returns the new record. For an existing
+// key, "path" leads to the leaf holding it.
 //
-//
-void BPlusTree::adjust_root()
+std::pair< Record*, bool > BPlusTree::find_or_insert( const KeyType& key, ValueType value, Path& path )
 {
-    if( !m_root->is_leaf() && m_root->size() == 1 )
+    if( is_empty() )
     {
-        auto discarded_node = m_root->internal();
-        m_root = m_root->internal()->remove_and_return_only_child();
-        m_root->set_parent( nullptr );
-        delete discarded_node;
+        return std::make_pair( start_new_tree( key, value ), true );
     }
-    else if( !m_root->size() )
+
+    if( m_append_mode )
     {
-        delete m_root;
-        m_root = nullptr;
+        if( last_leaf()->last_key() < key )
+        {
+            return std::make_pair( append( key, value ), true );
+        }
+        invalidate_caches();
     }
+
+    LeafNode* leaf = find_leaf_for_insert( key, path );
+    assert( leaf );
+
+    Record* record = leaf->lookup( key );
+    if( record )
+    {
+        return std::make_pair( record, false );
+    }
+
+    return std::make_pair( insert_into_leaf( leaf, key, value, path ), true );
 }
 
+//
+//
+//
+Record* BPlusTree::start_new_tree( const KeyType& key, ValueType value )
+{
+    invalidate_caches();
+    LeafNode* new_leaf = new LeafNode();
+    Record* record = new_leaf->insert( key, value );
+    m_root = new_leaf;
+    return record;
+}
+
+//
+// The summaries are updated before a split, while "path" still
+// describes the tree; a split does not change the totals above it.
+//
+Record* BPlusTree::insert_into_leaf( LeafNode* leaf, const KeyType& key, ValueType value, Path& path )
+{
+    Record* record = leaf->insert( key, value );
+    add_to_path( path, record->summary() );
+    if( leaf->size() > leaf_max_size() )
+    {
+        BTREE_PERF_SCOPE( SPLIT );
+        invalidate_caches();
+        m_counters.m_splits++;
+        m_counters.m_moved += leaf->size() - leaf_min_size();
+        BTREE_STATS_COUNT( LEAF_SPLITS );
+
+        //
+        // Split the leaf node
+        //
+        LeafNode* new_leaf = LeafNode::create_near( leaf );
+        LeafNode::move_tail( leaf, new_leaf, leaf_min_size() );
+
+        new_leaf->set_next( leaf->next() );
+        leaf->set_next( new_leaf );
+
+        const KeyType new_key = new_leaf->first_key();
+        insert_into_parent( path, leaf, new_key, new_leaf );
+        update_replicas( key );
+    }
+    return record;
+}
+
+//
+// In top-down mode every full node met on the way down is split before
+// it is entered, so the leaf reached has room and its parent can take
+// the entry of a split. Otherwise this is a plain lookup.
+//
+LeafNode* BPlusTree::find_leaf_for_insert( const KeyType& key, Path& path )
+{
+    if( !m_top_down )
+    {
+        return find_leaf_node( key, path );
+    }
+
+    bool split = false;
+    if( is_full( m_root ) )
+    {
+        InternalNode* new_root = new InternalNode();
+        new_root->push_back( key, m_root );
+        m_root = new_root;
+        split_child( new_root, 0 );
+        split = true;
+    }
+
+    path.clear();
+    Node* node = m_root;
+    while( !node->is_leaf() )
+    {
+        InternalNode* parent = node->internal();
+        std::size_t index = parent->child_index( key );
+        if( is_full( parent->neighbor( index ) ) )
+        {
+            split_child( parent, index );
+            index = parent->child_index( key );
+            split = true;
+        }
+        path.push( parent, index );
+        node = parent->neighbor( index );
+    }
+
+    if( split )
+    {
+        update_replicas( key );
+    }
+    return node->leaf();
+}
+
+//
+// Split the full child "index" of "parent", which is not full itself.
+//
+void BPlusTree::split_child( InternalNode* parent, std::size_t index )
+{
+    BTREE_PERF_SCOPE( SPLIT );
+    invalidate_caches();
+    Node* child = parent->neighbor( index );
+    const std::size_t keep = child->size() / 2;
+    m_counters.m_splits++;
+    m_counters.m_moved += child->size() - keep;
+
+    if( child->is_leaf() )
+    {
+        BTREE_STATS_COUNT( LEAF_SPLITS );
+        LeafNode* leaf = child->leaf();
+        LeafNode* new_leaf = LeafNode::create_near( leaf );
+        LeafNode::move_tail( leaf, new_leaf, keep );
+
+        new_leaf->set_next( leaf->next() );
+        leaf->set_next( new_leaf );
+        parent->insert_after( index, new_leaf->first_key(), new_leaf );
+    }
+    else
+    {
+        BTREE_STATS_COUNT( INTERNAL_SPLITS );
+        InternalNode* internal = child->internal();
+        InternalNode* new_node = InternalNode::create_near( internal );
+        InternalNode::move_tail( internal, new_node, keep );
+
+        const KeyType new_key = new_node->replace_and_return_first_key();
+        parent->insert_after( index, new_key, new_node );
+    }
+}
+
+//
+//
+//
+bool BPlusTree::is_full( const Node* node ) const
+{
+    return node->size() >= ( node->is_leaf() ? leaf_max_size() : internal_max_size() );
+}
+
+//
+// "path" leads to "old_node"; its last step is popped when the entry
+// goes into the parent.
+//
+void BPlusTree::insert_into_parent( Path& path, Node *old_node, const KeyType& key, Node *new_node )
+{
+    if( path.empty() )
+    {
+        InternalNode* new_root = new InternalNode();
+        new_root->populate_new_root( old_node, key, new_node );
+        m_root = new_root;
+    }
+    else
+    {
+        InternalNode* parent = path.parent();
+        const std::size_t index = path.index();
+        path.pop();
+        assert( parent->neighbor( index ) == old_node );
+        parent->insert_after( index, key, new_node );
+        split_if_overfull( path, parent );
+    }
+}
+
+//
+//
+//
+void BPlusTree::split_if_overfull( Path& path, InternalNode* node )
+{
+    if( node->size() > internal_max_size() )
+    {
+        BTREE_PERF_SCOPE( SPLIT );
+        m_counters.m_splits++;
+        m_counters.m_moved += node->size() - internal_min_size();
+        BTREE_STATS_COUNT( INTERNAL_SPLITS );
+        InternalNode* new_node = InternalNode::create_near( node );
+        InternalNode::move_tail( node, new_node, internal_min_size() );
+
+        const KeyType new_key = new_node->replace_and_return_first_key();
+        insert_into_parent( path, node, new_key, new_node );
+    }
+}
+
+
+//
+// Add a key greater than all others to the last leaf, or start a new
+// last leaf with it if the current one is full.
+//
+Record* BPlusTree::append( const KeyType& key, ValueType value )
+{
+    LeafNode* leaf = last_leaf();
+    if( leaf->size() < leaf_max_size() )
+    {
+        Record* record = leaf->insert( key, value );
+        add_to_path( m_last_path, record->summary() );
+        return record;
+    }
+
+    // Counted as a split that moves no entries.
+    m_counters.m_splits++;
+    BTREE_STATS_COUNT( LEAF_SPLITS );
+
+    LeafNode* new_leaf = LeafNode::create_near( leaf );
+    Record* record = new_leaf->insert( key, value );
+    leaf->set_next( new_leaf );
+
+    append_to_parent( m_last_path, new_leaf, key, record->summary() );
+    invalidate_caches();
+    update_replicas( key );
+    return record;
+}
+
+//
+// Add "node" as the last child of the last node on "path", which leads
+// along the right edge; "delta" is the summary of the appended key.
+// A full node is not split in half: it hands its last child over to a
+// new node, which takes "node" as well and is appended one level up.
+//
+void BPlusTree::append_to_parent( Path& path, Node* node, const KeyType& key, const Summary& delta )
+{
+    if( path.empty() )
+    {
+        InternalNode* new_root = new InternalNode();
+        new_root->populate_new_root( m_root, key, node );
+        m_root = new_root;
+        return;
+    }
+
+    InternalNode* parent = path.parent();
+    path.pop();
+    if( parent->size() < internal_max_size() )
+    {
+        parent->push_back( key, node );
+        if( !node->is_leaf() )
+        {
+            // The previous last child gave up its own last child.
+            parent->refresh( parent->size() - 2 );
+        }
+        add_to_path( path, delta );
+        return;
+    }
+
+    m_counters.m_splits++;
+    m_counters.m_moved++;
+    BTREE_STATS_COUNT( INTERNAL_SPLITS );
+
+    InternalNode* new_node = InternalNode::create_near( parent );
+    InternalNode::move_tail( parent, new_node, parent->size() - 1 );
+    const KeyType new_key = new_node->replace_and_return_first_key();
+    if( !node->is_leaf() )
+    {
+        new_node->refresh( 0 );
+    }
+    new_node->push_back( key, node );
+    append_to_parent( path, new_node, new_key, delta );
+}
+
+//
+// The last leaf, with the path to it in m_last_path.
+//
+LeafNode* BPlusTree::last_leaf()
+{
+    assert( !is_empty() );
+
+    if( !m_last_leaf )
+    {
+        m_last_path.clear();
+        Node* node = m_root;
+        while( !node->is_leaf() )
+        {
+            const std::size_t index = node->size() - 1;
+            m_last_path.push( node->internal(), index );
+            node = node->internal()->neighbor( index );
+        }
+        m_last_leaf = node->leaf();
+    }
+    return m_last_leaf;
+}
+
+//
+// Called by every operation that may restructure the tree: drops the
+// cached last leaf and makes fingers on the tree descend again.
+//
+void BPlusTree::invalidate_caches()
+{
+    m_last_leaf = nullptr;
+    m_last_path.clear();
+    m_epoch++;
+}
+
+//
+// Bring the nodes on the right edge, which appends may have left
+// underfull, back to their minimum size.
+//
+void BPlusTree::repair_right_edge()
+{
+    if( is_empty() )
+    {
+        return;
+    }
+
+    Node* node = m_root;
+    while( !node->is_leaf() )
+    {
+        InternalNode* internal = node->internal();
+        fix_children( internal );
+        node = internal->neighbor( internal->size() - 1 );
+    }
+    collapse_root();
+}
+
+
+//
+// REMOVAL
+//
+
+//
+//
+//
+void BPlusTree::remove( const KeyType& key )
+{
+    BTREE_STATS_SCOPE( REMOVES, REMOVE_LATENCY );
+    invalidate_caches();
+    if( is_empty() )
+    {
+        return;
+    }
+
+    Path path;
+    LeafNode* leafNode = find_leaf_for_remove( key, path );
+    assert( leafNode );
+
+    if( !leafNode->lookup( key ) )
+    {
+        return;
+    }
+
+    remove_from_leaf( leafNode, key, path );
+}
+
+//
+//
+//
+void BPlusTree::remove( const KeyType& key, ValueType value )
+{
+    BTREE_STATS_SCOPE( REMOVES, REMOVE_LATENCY );
+    invalidate_caches();
+    if( is_empty() )
+    {
+        return;
+    }
+
+    Path path;
+    LeafNode* leafNode = find_leaf_for_remove( key, path );
+    assert( leafNode );
+
+    Record* record = leafNode->lookup( key );
+    if( !record )
+    {
+        return;
+    }
+
+    if( record->size() > 1 )
+    {
+        if( record->remove( value ) )
+        {
+            remove_from_path( path, Summary::of_value( value ) );
+        }
+    }
+    else if( record->value() == value )
+    {
+        remove_from_leaf( leafNode, key, path );
+    }
+}
+
+//
+// In top-down mode every child at its minimum size is refilled from a
+// neighbor, or merged with it, before it is entered, so removing a key
+// from the leaf reached never underflows it. Otherwise this is a plain
+// lookup.
+//
+LeafNode* BPlusTree::find_leaf_for_remove( const KeyType& key, Path& path )
+{
+    if( !m_top_down )
+    {
+        return find_leaf_node( key, path );
+    }
+
+    bool refilled = false;
+    path.clear();
+    Node* node = m_root;
+    while( !node->is_leaf() )
+    {
+        InternalNode* parent = node->internal();
+        std::size_t index = parent->child_index( key );
+        const Node* child = parent->neighbor( index );
+        if( child->size() <= rebalance_threshold( child ) )
+        {
+            refill_child( parent, index );
+            refilled = true;
+            if( parent == m_root && parent->size() == 1 )
+            {
+                collapse_root();
+                path.clear();
+                node = m_root;
+                continue;
+            }
+            index = parent->child_index( key );
+        }
+        path.push( parent, index );
+        node = parent->neighbor( index );
+    }
+
+    if( refilled )
+    {
+        update_replicas( key );
+    }
+    return node->leaf();
+}
+
+//
+// The parent holds more than its minimum, or is the root, so it can
+// give up the entry of a merge.
+//
+void BPlusTree::refill_child( InternalNode* parent, std::size_t index )
+{
+    const std::size_t neighbor_index = ( index == 0 ) ? 1 : index - 1;
+    Node* child = parent->neighbor( index );
+    Node* neighbor = parent->neighbor( neighbor_index );
+
+    if( neighbor->size() > ( neighbor->is_leaf() ? leaf_min_size() : internal_min_size() ) )
+    {
+        if( child->is_leaf() )
+        {
+            redistribute( neighbor->leaf(), child->leaf(), parent, index );
+        }
+        else
+        {
+            redistribute( neighbor->internal(), child->internal(), parent, index );
+        }
+    }
+    else
+    {
+        merge_or_balance( parent, std::min( index, neighbor_index ) );
+    }
+}
+
+//
+// The summaries are updated before any rebalancing, while "path"
+// still describes the tree.
+//
+void BPlusTree::remove_from_leaf( LeafNode* leafNode, const KeyType& key, Path& path )
+{
+    const Summary removed = leafNode->lookup( key )->summary();
+    leafNode->remove( key );
+    remove_from_path( path, removed );
+    if( leafNode->size() < rebalance_threshold( leafNode ) )
+    {
+        coalesce_or_redistribute( leafNode, path );
+        update_replicas( key );
+    }
+    else if( is_underfull( leafNode ) && !path.empty() )
+    {
+        m_deferred_underflows++;
+    }
+}
+
+//
+//
+//
+void BPlusTree::coalesce_or_redistribute( LeafNode* node, Path& path )
+{
+    if( path.empty() )
+    {
+        adjust_root();
+        return;
+    }
+    InternalNode* parent = path.parent();
+    const std::size_t index_of_node_in_parent = path.index();
+    path.pop();
+    const std::size_t neighbor_index = ( index_of_node_in_parent == 0 ) ? 1 : index_of_node_in_parent - 1;
+    LeafNode* neighbor_node = parent->neighbor( neighbor_index )->leaf();
+
+    if( node->size() + neighbor_node->size() <= leaf_max_size() )
+    {
+        coalesce( neighbor_node, node, parent, index_of_node_in_parent, path );
+    }
+    else
+    {
+        redistribute( neighbor_node, node, parent, index_of_node_in_parent );
+    }
+}
+
+//
+//
+//
+void BPlusTree::coalesce_or_redistribute( InternalNode* node, Path& path )
+{
+    if( path.empty() )
+    {
+        adjust_root();
+        return;
+    }
+
+    InternalNode* parent = path.parent();
+    const std::size_t index_of_node_in_parent = path.index();
+    path.pop();
+    const std::size_t neighbor_index = ( index_of_node_in_parent == 0 ) ? 1 : index_of_node_in_parent - 1;
+    InternalNode* neighbor_node = parent->neighbor( neighbor_index )->internal();
+
+    if( node->size() + neighbor_node->size() <= internal_max_size() )
+    {
+        coalesce( neighbor_node, node, parent, index_of_node_in_parent, path );
+    }
+    else
+    {
+        redistribute( neighbor_node, node, parent, index_of_node_in_parent );
+    }
+}
+
+//
+// "path" leads to "parent".
+//
+void BPlusTree::coalesce( LeafNode* neighbor_node, LeafNode* node, InternalNode* parent, std::size_t index, Path& path )
+{
+    BTREE_PERF_SCOPE( MERGE );
+    if( index == 0 )
+    {
+        std::swap( node, neighbor_node );
+        index = 1;
+    }
+
+    m_counters.m_merges++;
+    m_counters.m_moved += node->size();
+    BTREE_STATS_COUNT( COALESCES );
+    LeafNode::move_all( node, neighbor_node );
+    neighbor_node->set_next( node->next() );
+    parent->remove( index );
+    parent->refresh( index - 1 );
+
+    if( parent->size() < rebalance_threshold( parent ) )
+    {
+        coalesce_or_redistribute( parent, path );
+    }
+    else if( is_underfull( parent ) && !path.empty() )
+    {
+        m_deferred_underflows++;
+    }
+    delete node;
+}
+
+//
+// "path" leads to "parent".
+//
+void BPlusTree::coalesce( InternalNode* neighbor_node, InternalNode* node, InternalNode* parent, std::size_t index, Path& path )
+{
+    BTREE_PERF_SCOPE( MERGE );
+    if( index == 0 )
+    {
+        std::swap( node, neighbor_node );
+        index = 1;
+    }
+
+    m_counters.m_merges++;
+    m_counters.m_moved += node->size();
+    BTREE_STATS_COUNT( COALESCES );
+    InternalNode::move_all( node, neighbor_node, parent->key_at( index ) );
+
+    parent->remove( index );
+    parent->refresh( index - 1 );
+
+    if( parent->size() < rebalance_threshold( parent ) )
+    {
+        coalesce_or_redistribute( parent, path );
+    }
+    else if( is_underfull( parent ) && !path.empty() )
+    {
+        m_deferred_underflows++;
+    }
+    delete node;
+}
+
+//
+//
+//
+void BPlusTree::redistribute( LeafNode* neighbor_node, LeafNode* node, InternalNode* parent, std::size_t index )
+{
+    BTREE_PERF_SCOPE( MERGE );
+    m_counters.m_redistributions++;
+    m_counters.m_moved++;
+    BTREE_STATS_COUNT( REDISTRIBUTIONS );
+    if( index == 0 )
+    {
+        neighbor_node->move_first_to_end_of( node, parent );
+    }
+    else
+    {
+        neighbor_node->move_last_to_front_of( node, parent, index );
+    }
+    refresh_pair( parent, index == 0 ? 0 : index - 1 );
+}
+
+//
+//
+//
+void BPlusTree::redistribute( InternalNode* neighbor_node, InternalNode* node, InternalNode* parent, std::size_t index )
+{
+    BTREE_PERF_SCOPE( MERGE );
+    m_counters.m_redistributions++;
+    m_counters.m_moved++;
+    BTREE_STATS_COUNT( REDISTRIBUTIONS );
+    if ( index == 0 )
+    {
+        neighbor_node->move_first_to_end_of( node, parent );
+    }
+    else
+    {
+        neighbor_node->move_last_to_front_of( node, parent, index );
+    }
+    refresh_pair( parent, index == 0 ? 0 : index - 1 );
+}
+
+//
+// Refresh the summaries of the children "index" and "index + 1".
+//
+void BPlusTree::refresh_pair( InternalNode* parent, std::size_t index )
+{
+    parent->refresh( index );
+    parent->refresh( index + 1 );
+}
+
+//
+// Refresh the summaries on "path", from the bottom up to the root.
+//
+void BPlusTree::refresh_path( const Path& path )
+{
+    for( std::size_t level = path.size(); level-- > 0; )
+    {
+        path.node_at( level )->refresh( path.index_at( level ) );
+    }
+}
+
+//
+// Add "delta" to the summaries on "path"; no node is rescanned.
+//
+void BPlusTree::add_to_path( const Path& path, const Summary& delta )
+{
+    for( std::size_t level = 0; level < path.size(); level++ )
+    {
+        path.node_at( level )->add_summary( path.index_at( level ), delta );
+    }
+}
+
+//
+// Replace "removed" by "added" in the summaries on "path", from the bottom
+// up; a level is rescanned only if it may have lost its minimum or maximum.
+//
+void BPlusTree::replace_on_path( const Path& path, const Summary& removed, const Summary& added )
+{
+    for( std::size_t level = path.size(); level-- > 0; )
+    {
+        path.node_at( level )->replace_summary( path.index_at( level ), removed, added );
+    }
+}
+
+//
+// Take "removed" out of the summaries on "path", from the bottom up, so
+// that a level that has to be rescanned sees its children up to date.
+//
+void BPlusTree::remove_from_path( const Path& path, const Summary& removed )
+{
+    for( std::size_t level = path.size(); level-- > 0; )
+    {
+        path.node_at( level )->remove_summary( path.index_at( level ), removed );
+    }
+}
+
+//
+//
+//
+void BPlusTree::adjust_root()
+{
+    if( !m_root->is_leaf() && m_root->size() == 1 )
+    {
+        auto discarded_node = m_root->internal();
+        m_root = m_root->internal()->remove_and_return_only_child();
+        delete discarded_node;
+    }
+    else if( !m_root->size() )
+    {
+        delete m_root;
+        m_root = nullptr;
+    }
+}
+
+
+//
+// RANGE REMOVAL
+//
+
+//
+// The leaves strictly between the leaves of "lo" and "hi" hold keys of
+// the range only, so the chain is relinked once, before they are freed.
+//
+std::size_t BPlusTree::erase_range( const KeyType& lo, const KeyType& hi )
+{
+    if( is_empty() || hi < lo )
+    {
+        return 0;
+    }
+    invalidate_caches();
+
+    LeafNode* leaf_lo = find_leaf_node( lo );
+    LeafNode* leaf_hi = find_leaf_node( hi );
+    if( leaf_lo != leaf_hi )
+    {
+        leaf_lo->set_next( leaf_hi );
+    }
+
+    const std::size_t erased = erase_in( m_root, &lo, &hi );
+    collapse_root();
+    update_replicas();
+    return erased;
+}
+
+//
+// Frees the children between the two boundary paths, recurses along
+// these paths and repairs the children left underfull on the way back.
+// Below the fork of the paths, the lower path is unbounded above
+// ("hi" is null) and the upper path unbounded below ("lo" is null).
+//
+std::size_t BPlusTree::erase_in( Node* node, const KeyType* lo, const KeyType* hi )
+{
+    if( node->is_leaf() )
+    {
+        const KeyType min_key( std::numeric_limits< std::int64_t >::min() );
+        const KeyType max_key( std::numeric_limits< std::int64_t >::max() );
+        return node->leaf()->remove_range( lo ? *lo : min_key, hi ? *hi : max_key );
+    }
+
+    InternalNode* internal = node->internal();
+    const std::size_t first = lo ? internal->child_index( *lo ) : 0;
+    const std::size_t last = hi ? internal->child_index( *hi ) : internal->size() - 1;
+
+    std::size_t erased = 0;
+    if( lo && hi && first == last )
+    {
+        erased += erase_in( internal->neighbor( first ), lo, hi );
+        internal->refresh( first );
+    }
+    else
+    {
+        // Children strictly inside the range hold its keys only.
+        const std::size_t b = lo ? first + 1 : 0;
+        const std::size_t e = hi ? last : internal->size();
+        for( std::size_t i = b; i < e; i++ )
+        {
+            erased += internal->count_at( i );
+        }
+        internal->erase_children( b, e );
+
+        if( lo )
+        {
+            erased += erase_in( internal->neighbor( first ), lo, nullptr );
+            internal->refresh( first );
+        }
+        if( hi )
+        {
+            const std::size_t index = lo ? first + 1 : 0;
+            erased += erase_in( internal->neighbor( index ), nullptr, hi );
+            internal->refresh( index );
+        }
+    }
+
+    fix_children( internal );
+    return erased;
+}
+
+//
+// On return either every descendant of "node" is at least half full, or
+// "node" is left with a single child and its parent has to merge it.
+// The children left of a merged pair are unchanged, so the search for
+// the next underfull child resumes at the pair, which keeps the pass
+// linear in the number of children.
+//
+void BPlusTree::fix_children( InternalNode* node )
+{
+    std::size_t index = 0;
+    while( node->size() > 1 )
+    {
+        while( index < node->size() && !is_underfull( node->neighbor( index ) ) )
+        {
+            index++;
+        }
+
+        if( index == node->size() )
+        {
+            return;
+        }
+
+        index = ( index == 0 ) ? 0 : index - 1;
+        merge_or_balance( node, index );
+    }
+}
+
+//
+// Merge the children "index" and "index + 1" of "parent" if they fit
+// into one node, otherwise split their entries evenly between them.
+//
+void BPlusTree::merge_or_balance( InternalNode* parent, std::size_t index )
+{
+    BTREE_PERF_SCOPE( MERGE );
+    Node* left_node = parent->neighbor( index );
+    Node* right_node = parent->neighbor( index + 1 );
+    const std::size_t total = left_node->size() + right_node->size();
+    const bool fits = total <= ( left_node->is_leaf() ? leaf_max_size() : internal_max_size() );
+
+    m_counters.m_moved += right_node->size() + ( fits ? 0 : total - total / 2 );
+    if( fits )
+    {
+        m_counters.m_merges++;
+        BTREE_STATS_COUNT( COALESCES );
+    }
+    else
+    {
+        m_counters.m_redistributions++;
+        BTREE_STATS_COUNT( REDISTRIBUTIONS );
+    }
+
+    if( left_node->is_leaf() )
+    {
+        LeafNode* left = left_node->leaf();
+        LeafNode* right = right_node->leaf();
+
+        LeafNode::move_all( right, left );
+        if( fits )
+        {
+            left->set_next( right->next() );
+            parent->remove( index + 1 );
+            parent->refresh( index );
+            delete right;
+        }
+        else
+        {
+            LeafNode::move_tail( left, right, total / 2 );
+            parent->set_key_at( index + 1, right->first_key() );
+            refresh_pair( parent, index );
+        }
+        return;
+    }
+
+    InternalNode* left = left_node->internal();
+    InternalNode* right = right_node->internal();
+
+    InternalNode::move_all( right, left, parent->key_at( index + 1 ) );
+    if( fits )
+    {
+        parent->remove( index + 1 );
+        parent->refresh( index );
+        delete right;
+        fix_children( left );
+    }
+    else
+    {
+        InternalNode::move_tail( left, right, total / 2 );
+        parent->set_key_at( index + 1, right->replace_and_return_first_key() );
+        refresh_pair( parent, index );
+        fix_children( left );
+        fix_children( right );
+    }
+}
+
+//
+//
+//
+bool BPlusTree::is_underfull( const Node* node ) const
+{
+    return node->size() < ( node->is_leaf() ? leaf_min_size() : internal_min_size() );
+}
+
+//
+// Removals rebalance a node with fewer entries than this. An internal
+// node keeps at least two children, so that it always has a neighbor
+// to merge a child with.
+//
+std::size_t BPlusTree::rebalance_threshold( const Node* node ) const
+{
+    const std::size_t min_size = node->is_leaf() ? leaf_min_size() : internal_min_size();
+    const std::size_t floor = node->is_leaf() ? 1 : 2;
+
+    switch( m_underflow_policy )
+    {
+    case UnderflowPolicy::THRESHOLD:
+        return std::min( std::max( m_merge_threshold, floor ), min_size );
+    case UnderflowPolicy::AT_EMPTY:
+        return floor;
+    default:
+        return min_size;
+    }
+}
+
+//
+//
+//
+void BPlusTree::compact()
+{
+    invalidate_caches();
+    if( !is_empty() && !m_root->is_leaf() )
+    {
+        compact_in( m_root->internal() );
+        collapse_root();
+        update_replicas();
+    }
+    m_deferred_underflows = 0;
+}
+
+//
+// Children first, so that fix_children() finds every subtree below
+// its children in order.
+//
+void BPlusTree::compact_in( InternalNode* node )
+{
+    for( std::size_t i = 0; i < node->size(); i++ )
+    {
+        Node* child = node->neighbor( i );
+        if( !child->is_leaf() )
+        {
+            compact_in( child->internal() );
+        }
+    }
+    fix_children( node );
+}
+
+//
+// Drop roots left with a single child, and an empty root leaf.
+//
+void BPlusTree::collapse_root()
+{
+    while( m_root && ( !m_root->size() || ( !m_root->is_leaf() && m_root->size() == 1 ) ) )
+    {
+        adjust_root();
+    }
+}
+
+//
+//
+//
+void BPlusTree::set_page_mode( NodeArena::PageMode mode )
+{
+    LeafNode::arena().set_page_mode( mode );
+    InternalNode::arena().set_page_mode( mode );
+    EntryArenas::set_page_mode( mode );
+}
+
+//
+//
+//
+void BPlusTree::set_replication( bool replicated, std::size_t replica_no )
+{
+    drop_replicas();
+    m_replicas.reset();
+    if( replicated )
+    {
+        m_replicas.reset( new Replicas( replica_no ? replica_no : Numa::node_no(), internal_max_size() ) );
+        update_replicas();
+    }
+}
+
+//
+//
+//
+std::size_t BPlusTree::replica_no() const
+{
+    return m_replicas ? m_replicas->size() : 0;
+}
+
+//
+// After a change confined to the path of "key", see Replicas::update().
+//
+void BPlusTree::update_replicas( const KeyType& key )
+{
+    if( m_replicas && m_root )
+    {
+        m_replicas->update( m_root, key );
+    }
+}
+
+//
+//
+//
+void BPlusTree::update_replicas()
+{
+    if( m_replicas )
+    {
+        m_replicas->update( m_root );
+    }
+}
+
+//
+// Free the copies of all internal nodes, before they leave the tree.
+//
+void BPlusTree::drop_replicas()
+{
+    if( m_replicas )
+    {
+        Replicas::clear( m_root );
+    }
+}
+
+//
+// Breadth-first, so that every level of internal nodes is contiguous
+// and in key order; the leaves form the last level.
+//
+void BPlusTree::relayout()
+{
+    invalidate_caches();
+    if( is_empty() )
+    {
+        return;
+    }
+
+    if( m_root->is_leaf() )
+    {
+        m_root = LeafNode::relocate( m_root->leaf() );
+        return;
+    }
+
+    InternalNode* root = InternalNode::relocate( m_root->internal() );
+    m_root = root;
+
+    std::vector< InternalNode* > level{ root };
+    std::vector< InternalNode* > below;
+    while( !level.front()->neighbor( 0 )->is_leaf() )
+    {
+        below.clear();
+        for( InternalNode* node : level )
+        {
+            for( std::size_t i = 0; i < node->size(); i++ )
+            {
+                InternalNode* child = InternalNode::relocate( node->neighbor( i )->internal() );
+                node->set_neighbor( i, child );
+                below.push_back( child );
+            }
+        }
+        level.swap( below );
+    }
+
+    LeafNode* prev = nullptr;
+    for( InternalNode* node : level )
+    {
+        for( std::size_t i = 0; i < node->size(); i++ )
+        {
+            LeafNode* leaf = LeafNode::relocate( node->neighbor( i )->leaf() );
+            node->set_neighbor( i, leaf );
+            if( prev )
+            {
+                prev->set_next( leaf );
+            }
+            prev = leaf;
+        }
+    }
+    update_replicas();
+}
+
+
+//
+// SPLIT AND JOIN
+//
+
+//
+//
+//
+void BPlusTree::split_at( const KeyType& key, BPlusTree& right )
+{
+    check_compatible( right );
+    if( !right.is_empty() )
+    {
+        throw std::runtime_error( "Split requires an empty tree" );
+    }
+
+    if( is_empty() )
+    {
+        return;
+    }
+
+    invalidate_caches();
+    right.invalidate_caches();
+    right.m_root = split_in( m_root, key );
+    collapse_root();
+    right.collapse_root();
+
+    // The nodes of "right" still have copies in the replicas of this tree.
+    Replicas::clear( right.m_root );
+    right.update_replicas();
+    update_replicas();
+}
+
+//
+// Cut "node" along the path of "key": the keys below "key" stay in
+// "node", the others go to the returned node of the same height.
+// Both fragments are repaired before returning.
+//
+Node* BPlusTree::split_in( Node* node, const KeyType& key )
+{
+    if( node->is_leaf() )
+    {
+        LeafNode* leaf = node->leaf();
+        LeafNode* right = new LeafNode();
+        LeafNode::move_tail( leaf, right, leaf->lower_bound( key ) );
+
+        right->set_next( leaf->next() );
+        leaf->set_next( nullptr );
+        return right;
+    }
+
+    InternalNode* internal = node->internal();
+    const std::size_t index = internal->child_index( key );
+    Node* child = split_in( internal->neighbor( index ), key );
+    internal->refresh( index );
+
+    InternalNode* right = new InternalNode();
+    right->push_back( key, child );
+    InternalNode::move_tail( internal, right, index + 1 );
+
+    fix_children( internal );
+    fix_children( right );
+    return right;
+}
+
+//
+//
+//
+void BPlusTree::join( BPlusTree& other )
+{
+    check_compatible( other );
+    if( other.is_empty() )
+    {
+        return;
+    }
+
+    invalidate_caches();
+    other.invalidate_caches();
+    other.drop_replicas();
+
+    if( is_empty() )
+    {
+        std::swap( m_root, other.m_root );
+        update_replicas();
+        return;
+    }
+
+    Node* left = m_root;
+    Node* right = other.m_root;
+    if( !precedes( left, right ) )
+    {
+        std::swap( left, right );
+        if( !precedes( left, right ) )
+        {
+            throw std::runtime_error( "Key ranges overlap" );
+        }
+    }
+
+    other.m_root = nullptr;
+    concatenate( left, right );
+    update_replicas();
+}
+
+//
+//
+//
+void BPlusTree::merge( BPlusTree& other )
+{
+    check_compatible( other );
+    if( is_empty() || other.is_empty() || precedes( m_root, other.m_root ) || precedes( other.m_root, m_root ) )
+    {
+        join( other );
+        return;
+    }
+
+    BPlusTree merged( m_order, m_allow_duplicates );
+    merged.set_top_down( m_top_down );
+    {
+        BulkLoader loader( merged );
+
+        LeafNode* leaf_a = leftmost_leaf( m_root );
+        LeafNode* leaf_b = leftmost_leaf( other.m_root );
+        LeafNode::Entries elt_a = leaf_a->release();
+        LeafNode::Entries elt_b = leaf_b->release();
+        std::size_t a = 0;
+        std::size_t b = 0;
+
+        while( leaf_a || leaf_b )
+        {
+            if( leaf_a && a == elt_a.size() )
+            {
+                leaf_a = leaf_a->next();
+                elt_a = leaf_a ? leaf_a->release() : LeafNode::Entries();
+                a = 0;
+            }
+            else if( leaf_b && b == elt_b.size() )
+            {
+                leaf_b = leaf_b->next();
+                elt_b = leaf_b ? leaf_b->release() : LeafNode::Entries();
+                b = 0;
+            }
+            else if( !leaf_b || ( leaf_a && elt_a[ a ].m_key < elt_b[ b ].m_key ) )
+            {
+                loader.append( elt_a[ a ].m_key, elt_a[ a ].m_record );
+                a++;
+            }
+            else if( !leaf_a || elt_b[ b ].m_key < elt_a[ a ].m_key )
+            {
+                loader.append( elt_b[ b ].m_key, elt_b[ b ].m_record );
+                b++;
+            }
+            else
+            {
+                Record* kept = elt_a[ a ].m_record;
+                Record* dropped = elt_b[ b ].m_record;
+                if( m_allow_duplicates )
+                {
+                    dropped->for_each( [ kept ]( ValueType v ){ kept->add( v ); } );
+                }
+                delete dropped;
+
+                loader.append( elt_a[ a ].m_key, kept );
+                a++;
+                b++;
+            }
+        }
+        loader.finish();
+    }
+
+    // The leaves were emptied above, so no record is freed here.
+    destroy_tree();
+    other.destroy_tree();
+    std::swap( m_root, merged.m_root );
+    update_replicas();
+}
+
+//
+// Attach the root of the lower tree "left" or of the upper tree "right"
+// to the facing edge of the other one, at the level of equal height.
+//
+void BPlusTree::concatenate( Node* left, Node* right )
+{
+    const KeyType separator = leftmost_leaf( right )->first_key();
+    rightmost_leaf( left )->set_next( leftmost_leaf( right ) );
+
+    const std::size_t left_height = height( left );
+    const std::size_t right_height = height( right );
+
+    if( left_height == right_height )
+    {
+        InternalNode* root = new InternalNode();
+        root->push_back( separator, left );
+        root->push_back( separator, right );
+        m_root = root;
+
+        merge_or_balance( root, 0 );
+        collapse_root();
+    }
+    else if( left_height > right_height )
+    {
+        m_root = left;
+        Path path;
+        Node* node = left;
+        for( std::size_t h = left_height; h > right_height + 1; h-- )
+        {
+            const std::size_t index = node->size() - 1;
+            path.push( node->internal(), index );
+            node = node->internal()->neighbor( index );
+        }
+
+        InternalNode* parent = node->internal();
+        parent->push_back( separator, right );
+        refresh_path( path );
+        merge_or_balance( parent, parent->size() - 2 );
+        split_if_overfull( path, parent );
+    }
+    else
+    {
+        m_root = right;
+        Path path;
+        Node* node = right;
+        for( std::size_t h = right_height; h > left_height + 1; h-- )
+        {
+            path.push( node->internal(), 0 );
+            node = node->internal()->first_child();
+        }
+
+        InternalNode* parent = node->internal();
+        parent->push_front( left, separator );
+        refresh_path( path );
+        merge_or_balance( parent, 0 );
+        split_if_overfull( path, parent );
+    }
+}
+
+//
+//
+//
+void BPlusTree::check_compatible( const BPlusTree& other ) const
+{
+    if( &other == this || other.m_order != m_order || other.m_allow_duplicates != m_allow_duplicates || other.m_top_down != m_top_down )
+    {
+        throw std::runtime_error( "Trees are not compatible" );
+    }
+}
+
+//
+// True if every key under "left" is less than every key under "right".
+//
+bool BPlusTree::precedes( const Node* left, const Node* right )
+{
+    return rightmost_leaf( left )->last_key() < leftmost_leaf( right )->first_key();
+}
+
+//
+// Number of internal levels above the leaves.
+//
+std::size_t BPlusTree::height( const Node* node )
+{
+    std::size_t h = 0;
+    while( !node->is_leaf() )
+    {
+        node = node->internal()->first_child();
+        h++;
+    }
+    return h;
+}
+
+//
+//
+//
+LeafNode* BPlusTree::leftmost_leaf( const Node* node )
+{
+    while( !node->is_leaf() )
+    {
+        node = node->internal()->first_child();
+    }
+    return const_cast< LeafNode* >( node->leaf() );
+}
+
+//
+//
+//
+LeafNode* BPlusTree::rightmost_leaf( const Node* node )
+{
+    while( !node->is_leaf() )
+    {
+        node = node->internal()->neighbor( node->size() - 1 );
+    }
+    return const_cast< LeafNode* >( node->leaf() );
+}
 
 
 //
@@ -378,7 +2043,8 @@ void BPlusTree::adjust_root()
 //
 std::size_t BPlusTree::leaf_min_size() const
 {
-    return m_order / 2;
+    // A full leaf split before an insert yields a half of this size.
+    return m_top_down ? ( m_order - 1 ) / 2 : m_order / 2;
 }
 
 //
@@ -394,8 +2060,11 @@ std::size_t BPlusTree::leaf_max_size() const
 //
 std::size_t BPlusTree::internal_min_size() const
 {
-    // return ( m_order + 1 ) / 2;
-    return m_order / 2;
+    // Rounded up: with "m_order / 2" an internal node (and the root)
+    // of order 3 could keep a single child, which then has no neighbor
+    // to coalesce with or borrow from. Top-down mode needs the lower
+    // bound for its preemptive splits and is limited to order 4 or more.
+    return m_top_down ? m_order / 2 : ( m_order + 1 ) / 2;
 }
 
 //
@@ -1,37 +1,202 @@
 #ifndef ROMZ_AMITTAI_BTREE_BPLUSTREE_H
 #define ROMZ_AMITTAI_BTREE_BPLUSTREE_H
 
+#include <functional>
+#include <memory>
+#include <utility>
 #include "Definitions.hpp"
 #include "Record.hpp"
+#include "Summary.hpp"
 #include "KeyType.h"
+#include "Metrics.hpp"
+#include "NodeArena.hpp"
+#include "Path.hpp"
+#include "Rebalance.hpp"
+#include "TreeStats.hpp"
 
 class InternalNode;
 class LeafNode;
 class Node;
+class Replicas;
 
 
 /// Main class providing the API for the Interactive B+ Tree.
 class BPlusTree
 {
     friend class Io;
+    friend class BulkLoader;
+    friend class Finger;
+    friend class Compactor;
 
 public:
     /// Sole constructor.  Accepts an optional order for the B+ Tree.
     /// The default order will provide a reasonable demonstration of the
     /// data structure and its operations.
-    explicit BPlusTree( std::size_t order );
+    /// If "allow_duplicates" is set, the tree is a multimap: every key
+    /// holds a record with all the values inserted under it.
+    explicit BPlusTree( std::size_t order, bool allow_duplicates = false );
     ~BPlusTree();
     
     /// Returns true if this B+ tree has no keys or values.
     bool is_empty() const;
 
-    Record* search( const KeyType& key ) const;
+    /// Returns true if keys may be inserted more than once.
+    bool allows_duplicates() const;
+
+    /// In top-down mode insert and remove restructure the tree during
+    /// their single descent: full nodes are split and minimum-size nodes
+    /// are refilled before they are entered, so no change propagates back
+    /// up. Node minimums are one entry lower than in the default mode.
+    /// The mode can only be changed on an empty tree of order 4 or more.
+    void set_top_down( bool top_down );
+    bool top_down() const;
+
+    /// In append mode the path to the last leaf is kept between calls, and
+    /// a key greater than every key in the tree is added there without a
+    /// descent. A full last leaf is not split in half: the key starts a new
+    /// leaf, so ascending keys leave every other leaf full. Nodes on the
+    /// right edge may hold fewer entries than the minimum while the mode
+    /// is on; turning it off rebalances them.
+    void set_append_mode( bool append_mode );
+    bool append_mode() const;
+
+    /// Choose when removals rebalance a node that has dropped below its
+    /// minimum size. With THRESHOLD, "threshold" is the number of entries
+    /// below which a node is rebalanced; it is raised to 1 for leaves and
+    /// to 2 for internal nodes, and capped at the minimum. The lazier
+    /// policies avoid merging a node that the next insert would split
+    /// again, and leave underfull nodes behind for compact().
+    void set_underflow_policy( UnderflowPolicy policy, std::size_t threshold = 0 );
+    UnderflowPolicy underflow_policy() const;
+
+    /// Rebalance every node below its minimum size in one pass over the
+    /// tree, e.g. during a quiet period after a burst of removals.
+    void compact();
+
+    /// Move every node to fresh arena memory: the internal nodes level by
+    /// level from the root, and the leaves in key order, so that lookups
+    /// touch few pages near the root and scans read the leaves
+    /// sequentially. Meant to run now and then, like compact().
+    ///
+    /// Only the node objects are placed: the entry arrays are allocated
+    /// anew from the entry arenas (see EntryArenas) in the same order, but
+    /// not next to their nodes, and the records are not moved at all, so
+    /// a scan still follows a pointer out of the laid out leaves for every
+    /// entry array and record.
+    void relayout();
+
+    /// Back the nodes and entry arrays allocated from now on, in every
+    /// tree, with huge pages (see NodeArena::PageMode), so that random
+    /// descents through a large tree miss the TLB less often. relayout()
+    /// moves the nodes of an existing tree and their entry arrays.
+    static void set_page_mode( NodeArena::PageMode mode );
+
+    /// Keep copies of the internal levels on every NUMA node, so that
+    /// search() and scan() descend through memory local to the socket
+    /// they run on; the leaves stay shared. "replica_no" sets the number
+    /// of copies, 0 meaning one per NUMA node. Inserts and removes that
+    /// split or merge nodes update the copies along their path, at the
+    /// cost of another descent; bulk operations such as erase_range(),
+    /// join() or relayout() update all of them.
+    void set_replication( bool replicated, std::size_t replica_no = 0 );
+    std::size_t replica_no() const;
+
+    /// Removals that left a node below its minimum size unbalanced
+    /// since the last compact().
+    std::size_t deferred_underflows() const;
+
+    /// Splits, merges and redistributions, for measuring the write
+    /// amplification of a workload.
+    const RebalanceCounters& rebalance_counters() const;
+    void reset_rebalance_counters();
+
+#ifdef BTREE_STATS
+    /// Operation counters and latencies, kept when the library is built
+    /// with BTREE_STATS. Safe to read and reset while the tree is in use.
+    Metrics& metrics() const;
+#endif
+
+    /// Returns the record holding all values stored under the key.
+    /// Values are changed through the tree, e.g. with update(), so that
+    /// the summaries stay exact.
+    const Record* search( const KeyType& key ) const;
+
+    /// Number of keys in the tree.
+    std::size_t size() const;
+
+    /// Number of keys less than "key".
+    std::size_t rank( const KeyType& key ) const;
+
+    /// The key of rank "index" (counting from 0) and its record.
+    /// Throws if "index" is not less than size().
+    std::pair< KeyType, const Record* > select( std::size_t index ) const;
+
+    /// Number of keys in [lo, hi].
+    std::size_t count( const KeyType& lo, const KeyType& hi ) const;
+
+    /// Count, sum, minimum and maximum of the values of the keys in
+    /// [lo, hi], combined from the summaries kept by internal nodes.
+    Summary aggregate( const KeyType& lo, const KeyType& hi ) const;
+
+    /// Height, nodes, fill and key range per level, and memory use, from
+    /// a walk over the whole tree. The subtrees of the root are split
+    /// among "thread_no" threads; 0 selects one per core. Other threads
+    /// may search the tree meanwhile, but must not change it.
+    TreeStats stats( std::size_t thread_no = 1 ) const;
+
+    /// Call "fn" for every key in [lo, hi] and its record, in key order,
+    /// following the leaf chain. Returns the number of keys visited.
+    std::size_t scan( const KeyType& lo, const KeyType& hi, const std::function< void( const KeyType&, const Record* ) >& fn ) const;
     
     /// Insert a key-value pair into this B+ tree.
+    /// Throws on an existing key unless the tree allows duplicates,
+    /// in which case the value is added to the key's record.
     void insert( const KeyType& key, ValueType value );
     
-    /// Remove a key and its value from this B+ tree.
+    /// Insert the pair unless the key is already present; never throws on
+    /// an existing key. Returns the key's record and whether it was inserted.
+    std::pair< const Record*, bool > try_insert( const KeyType& key, ValueType value );
+
+    /// Insert the pair, or make "value" the only value of an existing key.
+    /// Returns true if the key was inserted.
+    bool insert_or_assign( const KeyType& key, ValueType value );
+
+    /// Replace every value "v" of an existing key by "fn( v )" in place.
+    /// Returns false if the key is not present.
+    bool update( const KeyType& key, const std::function< ValueType( ValueType ) >& fn );
+
+    /// Insert the pair if the key is absent, otherwise update the key's
+    /// values with "fn" as update() does. Returns the key's record.
+    const Record* upsert( const KeyType& key, ValueType value, const std::function< ValueType( ValueType ) >& fn );
+
+    /// Remove a key and all its values from this B+ tree.
     void remove( const KeyType& key );
+
+    /// Remove one occurrence of the value stored under the key.
+    /// The key goes away together with its last value.
+    void remove( const KeyType& key, ValueType value );
+
+    /// Remove every key in [lo, hi] with all its values; returns the
+    /// number of keys removed. Subtrees inside the range are freed
+    /// wholesale and the tree is rebalanced once, along the two
+    /// boundary paths.
+    std::size_t erase_range( const KeyType& lo, const KeyType& hi );
+
+    /// Move every key not less than "key" into the empty tree "right".
+    /// Only the nodes along the path of "key" are split and repaired.
+    void split_at( const KeyType& key, BPlusTree& right );
+
+    /// Take over all keys of "other", whose key range must not overlap
+    /// the range of this tree. The shorter tree is attached to the edge
+    /// of the taller one, so the cost is proportional to the height.
+    void join( BPlusTree& other );
+
+    /// Take over all keys of "other", whose key range may overlap the
+    /// range of this tree. Disjoint trees are joined; otherwise both leaf
+    /// chains are merged in a single pass into a bottom-up build. A key
+    /// present in both trees keeps the record of this tree, which in
+    /// multimap mode receives the values of the other record as well.
+    void merge( BPlusTree& other );
     
 
     /// Remove all elements from the B+ tree. You can then build
@@ -47,30 +212,96 @@ public:
 
 
 private:
-    void start_new_tree( const KeyType& key, ValueType value );
-    void insert_into_leaf( const KeyType& key, ValueType value );
-    void insert_into_parent( Node* old_node, const KeyType& key, Node* new_node );
-    void remove_from_leaf( const KeyType& key );
+    std::pair< Record*, bool > find_or_insert( const KeyType& key, ValueType value, Path& path );
+    Record* start_new_tree( const KeyType& key, ValueType value );
+    Record* insert_into_leaf( LeafNode* leaf, const KeyType& key, ValueType value, Path& path );
+    LeafNode* find_leaf_for_insert( const KeyType& key, Path& path );
+    LeafNode* find_leaf_for_remove( const KeyType& key, Path& path );
+    void split_child( InternalNode* parent, std::size_t index );
+    void refill_child( InternalNode* parent, std::size_t index );
+    bool is_full( const Node* node ) const;
+    void insert_into_parent( Path& path, Node* old_node, const KeyType& key, Node* new_node );
+    void split_if_overfull( Path& path, InternalNode* node );
+    void remove_from_leaf( LeafNode* leaf, const KeyType& key, Path& path );
 
-    void coalesce_or_redistribute( LeafNode* node );
-    void coalesce_or_redistribute( InternalNode* node );
+    void coalesce_or_redistribute( LeafNode* node, Path& path );
+    void coalesce_or_redistribute( InternalNode* node, Path& path );
 
-    void coalesce( LeafNode* neighbor_node, LeafNode* node, InternalNode* parent, std::size_t index );
-    void coalesce( InternalNode* neighbor_node, InternalNode* node, InternalNode* parent, std::size_t index );
+    void coalesce( LeafNode* neighbor_node, LeafNode* node, InternalNode* parent, std::size_t index, Path& path );
+    void coalesce( InternalNode* neighbor_node, InternalNode* node, InternalNode* parent, std::size_t index, Path& path );
 
-    void redistribute( LeafNode* neighbor_node, LeafNode* node, std::size_t index );
-    void redistribute( InternalNode* neighbor_node, InternalNode* node, std::size_t index );
+    void redistribute( LeafNode* neighbor_node, LeafNode* node, InternalNode* parent, std::size_t index );
+    void redistribute( InternalNode* neighbor_node, InternalNode* node, InternalNode* parent, std::size_t index );
 
     void adjust_root();
 
+    Record* append( const KeyType& key, ValueType value );
+    void append_to_parent( Path& path, Node* node, const KeyType& key, const Summary& delta );
+    LeafNode* last_leaf();
+    void invalidate_caches();
+    void repair_right_edge();
+
+    void update_replicas( const KeyType& key );
+    void update_replicas();
+    void drop_replicas();
+
+    void refresh_pair( InternalNode* parent, std::size_t index );
+    void refresh_path( const Path& path );
+    void add_to_path( const Path& path, const Summary& delta );
+    void replace_on_path( const Path& path, const Summary& removed, const Summary& added );
+    void remove_from_path( const Path& path, const Summary& removed );
+    std::size_t count_less( const KeyType& key, bool inclusive ) const;
+    Summary aggregate_in( const Node* node, const KeyType* lo, const KeyType* hi ) const;
+    void stats_in( const Node* node, std::size_t level, TreeStats& stats ) const;
+
+    std::size_t erase_in( Node* node, const KeyType* lo, const KeyType* hi );
+    void fix_children( InternalNode* node );
+    void merge_or_balance( InternalNode* parent, std::size_t index );
+    bool is_underfull( const Node* node ) const;
+    std::size_t rebalance_threshold( const Node* node ) const;
+    void compact_in( InternalNode* node );
+    void collapse_root();
+
+    Node* split_in( Node* node, const KeyType& key );
+    void concatenate( Node* left, Node* right );
+    void check_compatible( const BPlusTree& other ) const;
+    static bool precedes( const Node* left, const Node* right );
+    static std::size_t height( const Node* node );
+    static LeafNode* leftmost_leaf( const Node* node );
+    static LeafNode* rightmost_leaf( const Node* node );
+
 
     LeafNode *find_leaf_node( const KeyType& key );
+    LeafNode *find_leaf_node( const KeyType& key, Path& path );
     const LeafNode *find_leaf_node( const KeyType& key ) const;
 
 // private:
 public:
     const std::size_t m_order;
+    const bool m_allow_duplicates;
+    bool m_top_down;
+    bool m_append_mode;
     Node* m_root;
+
+    // Right edge of the tree in append mode; m_last_leaf is null
+    // until the first append after a change elsewhere in the tree.
+    Path m_last_path;
+    LeafNode* m_last_leaf;
+
+    // Advanced whenever nodes may have been split, merged or freed.
+    std::uint64_t m_epoch;
+
+    UnderflowPolicy m_underflow_policy;
+    std::size_t m_merge_threshold;
+    std::size_t m_deferred_underflows;
+    RebalanceCounters m_counters;
+
+    // Copies of the internal levels, if replication is on.
+    std::unique_ptr< Replicas > m_replicas;
+
+#ifdef BTREE_STATS
+    mutable Metrics m_metrics;
+#endif
 };
 
 #endif
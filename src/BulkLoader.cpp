@@ -0,0 +1,155 @@
+#include <stdexcept>
+#include <cassert>
+#include "BulkLoader.hpp"
+#include "InternalNode.hpp"
+#include "LeafNode.hpp"
+
+//
+//
+//
+BulkLoader::BulkLoader( BPlusTree& tree )
+    : m_tree( tree )
+    , m_last{ nullptr }
+    , m_finished{ false }
+{
+    if( !m_tree.is_empty() )
+    {
+        throw std::runtime_error( "Bulk load requires an empty tree" );
+    }
+}
+
+//
+// Leaves built by an unfinished load are not reachable from the tree.
+//
+BulkLoader::~BulkLoader()
+{
+    if( m_finished )
+    {
+        return;
+    }
+
+    for( auto e : m_leaves )
+    {
+        delete e.m_node->leaf();
+    }
+}
+
+//
+//
+//
+void BulkLoader::append( const KeyType& key, ValueType value )
+{
+    append( key, new Record( value ) );
+}
+
+//
+//
+//
+void BulkLoader::append( const KeyType& key, Record* record )
+{
+    if( m_finished )
+    {
+        delete record;
+        throw std::runtime_error( "Bulk load already finished" );
+    }
+
+    if( m_last && !( m_last->m_elt.back().m_key < key ) )
+    {
+        delete record;
+        throw std::runtime_error( "Keys not in ascending order" );
+    }
+
+    if( !m_last || m_last->size() >= m_tree.leaf_max_size() )
+    {
+        LeafNode* leaf = new LeafNode();
+        if( m_last )
+        {
+            m_last->set_next( leaf );
+        }
+        m_last = leaf;
+        m_leaves.push_back( InternalElt( key, leaf ) );
+    }
+
+    m_last->m_elt.push_back( LeafElt( key, record ) );
+}
+
+//
+//
+//
+void BulkLoader::finish()
+{
+    if( m_finished )
+    {
+        return;
+    }
+    m_finished = true;
+
+    if( m_leaves.empty() )
+    {
+        return;
+    }
+
+    balance_last_leaf();
+
+    std::vector< InternalElt > level = m_leaves;
+    while( level.size() > 1 )
+    {
+        level = build_level( level );
+    }
+
+    m_tree.m_root = level.front().m_node;
+    m_tree.update_replicas();
+}
+
+//
+// Every leaf but the last one is full. If the last one is below the minimum
+// size, share the entries of the last two leaves evenly between them.
+//
+void BulkLoader::balance_last_leaf()
+{
+    if( m_leaves.size() < 2 || m_last->size() >= m_tree.leaf_min_size() )
+    {
+        return;
+    }
+
+    LeafNode* prev = m_leaves[ m_leaves.size() - 2 ].m_node->leaf();
+    const std::size_t total = prev->size() + m_last->size();
+
+    LeafNode::move_all( m_last, prev );
+    LeafNode::move_tail( prev, m_last, total - total / 2 );
+
+    m_leaves.back().m_key = m_last->first_key();
+}
+
+//
+// Group the children evenly into the smallest number of internal nodes.
+// Each returned entry holds the least key of the subtree it points to.
+//
+std::vector< InternalElt > BulkLoader::build_level( const std::vector< InternalElt >& children ) const
+{
+    const std::size_t max_size = m_tree.internal_max_size();
+    const std::size_t node_no = ( children.size() + max_size - 1 ) / max_size;
+    const std::size_t base = children.size() / node_no;
+    const std::size_t extra = children.size() % node_no;
+
+    std::vector< InternalElt > level;
+    level.reserve( node_no );
+
+    auto child = children.begin();
+    for( std::size_t i = 0; i < node_no; i++ )
+    {
+        InternalNode* node = new InternalNode();
+        const std::size_t size = base + ( i < extra ? 1 : 0 );
+        node->m_elt.reserve( size );
+
+        for( std::size_t k = 0; k < size; k++, ++child )
+        {
+            node->m_elt.push_back( InternalElt( child->m_key, child->m_node, child->m_node->summary() ) );
+        }
+
+        assert( node_no == 1 || node->size() >= m_tree.internal_min_size() );
+        level.push_back( InternalElt( node->replace_and_return_first_key(), node ) );
+    }
+
+    return level;
+}
@@ -0,0 +1,49 @@
+#ifndef ROMZ_AMITTAI_BTREE_BULKLOADER_H
+#define ROMZ_AMITTAI_BTREE_BULKLOADER_H
+
+#include <vector>
+#include "Definitions.hpp"
+#include "BPlusTree.hpp"
+#include "InternalElt.h"
+
+class LeafNode;
+
+/// Builds a B+ tree bottom-up from keys supplied in strictly ascending order.
+/// Leaves are packed full and linked as they are filled; the internal levels
+/// are laid out once all leaves are known. No descent or split is performed.
+class BulkLoader
+{
+public:
+    /// The tree must be empty.
+    explicit BulkLoader( BPlusTree& tree );
+    ~BulkLoader();
+
+    BulkLoader( const BulkLoader& ) = delete;
+    BulkLoader& operator=( const BulkLoader& ) = delete;
+
+    /// Append the next key-value pair. Keys must be strictly ascending.
+    void append( const KeyType& key, ValueType value );
+
+    /// Append the next key together with an already allocated record.
+    /// The loader takes ownership of the record.
+    void append( const KeyType& key, Record* record );
+
+    /// Build the internal levels and install the result as the tree root.
+    void finish();
+
+private:
+    void balance_last_leaf();
+    std::vector< InternalElt > build_level( const std::vector< InternalElt >& children ) const;
+
+private:
+    BPlusTree& m_tree;
+
+    // First key and node of every leaf built so far, in key order.
+    std::vector< InternalElt > m_leaves;
+
+    LeafNode* m_last;
+
+    bool m_finished;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include <cassert>
+#include <limits>
+#include "Compactor.hpp"
+#include "InternalNode.hpp"
+#include "LeafNode.hpp"
+
+//
+//
+//
+Compactor::Compactor( BPlusTree& tree )
+    : m_tree( tree )
+    , m_cursor( std::numeric_limits< std::int64_t >::min() )
+    , m_in_pass{ false }
+    , m_relocated{ 0 }
+{
+
+}
+
+//
+//
+//
+bool Compactor::step( std::size_t node_budget )
+{
+    if( !m_in_pass )
+    {
+        m_cursor = KeyType( std::numeric_limits< std::int64_t >::min() );
+        m_in_pass = true;
+    }
+
+    for( std::size_t i = 0; i < node_budget; i++ )
+    {
+        if( !compact_next() )
+        {
+            // Every internal node is on the path of some leaf.
+            m_tree.m_deferred_underflows = 0;
+            m_in_pass = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+//
+//
+void Compactor::run()
+{
+    while( !step( 64 ) )
+    {
+    }
+}
+
+//
+//
+//
+std::uint64_t Compactor::relocated() const
+{
+    return m_relocated;
+}
+
+//
+// Compact the leaves under the bottom-level node of the cursor and move
+// the cursor past them. Returns false if there was nothing left to do.
+//
+bool Compactor::compact_next()
+{
+    if( m_tree.is_empty() || m_tree.m_root->is_leaf() )
+    {
+        return false;
+    }
+
+    Path path;
+    m_tree.find_leaf_node( m_cursor, path );
+    InternalNode* parent = path.parent();
+    path.pop();
+
+    m_tree.invalidate_caches();
+    m_tree.fix_children( parent );
+
+    LeafNode* prev = leaf_before( path );
+    for( std::size_t i = 0; i < parent->size(); i++ )
+    {
+        LeafNode* leaf = LeafNode::relocate( parent->neighbor( i )->leaf() );
+        parent->set_neighbor( i, leaf );
+        if( prev )
+        {
+            prev->set_next( leaf );
+        }
+        prev = leaf;
+    }
+    m_relocated += parent->size();
+
+    // "prev" is now the last leaf under "parent". The repair above may
+    // merge the leaf after it into it, so the leaf where the pass goes on
+    // is looked up afterwards, from the last key handled.
+    const KeyType last = prev->last_key();
+
+    for( std::size_t level = path.size(); level-- > 0; )
+    {
+        m_tree.fix_children( path.node_at( level ) );
+    }
+    m_tree.collapse_root();
+    m_tree.update_replicas( m_cursor );
+
+    const LeafNode* next = m_tree.find_leaf_node( last )->next();
+    if( !next )
+    {
+        return false;
+    }
+    m_cursor = next->first_key();
+    return true;
+}
+
+//
+// The leaf preceding the leaves of the node "path" leads to, or null.
+//
+LeafNode* Compactor::leaf_before( const Path& path ) const
+{
+    std::size_t level = path.size();
+    while( level > 0 && path.index_at( level - 1 ) == 0 )
+    {
+        level--;
+    }
+    if( !level )
+    {
+        return nullptr;
+    }
+
+    const InternalNode* node = path.node_at( level - 1 );
+    Node* child = node->neighbor( path.index_at( level - 1 ) - 1 );
+    while( !child->is_leaf() )
+    {
+        child = child->internal()->neighbor( child->size() - 1 );
+    }
+    return child->leaf();
+}
@@ -0,0 +1,52 @@
+#ifndef ROMZ_AMITTAI_BTREE_COMPACTOR_H
+#define ROMZ_AMITTAI_BTREE_COMPACTOR_H
+
+#include <cstdint>
+#include "BPlusTree.hpp"
+
+//
+// Incremental defragmentation of a B+ tree.
+//
+// A pass walks the leaves in key order, one bottom-level internal node
+// (the parent of a run of leaves) at a time. For each such node the
+// underfull leaves are merged with their neighbors, every leaf is moved
+// to the next fresh slot of the leaf arena, so that a pass lays the leaves
+// out in key order, and the underfull nodes on the path above are merged.
+//
+// Each call to step() handles a bounded number of these nodes and then
+// returns, so the tree is locked for a short time only. The position of
+// a pass is kept as a key, so the tree may change between steps. The
+// tree must not be used concurrently with step().
+//
+class Compactor
+{
+public:
+    explicit Compactor( BPlusTree& tree );
+    ~Compactor() = default;
+
+    /// Handle the leaves of at most "node_budget" bottom-level nodes.
+    /// Returns true once the pass has reached the end of the tree; the
+    /// next call starts a new pass.
+    bool step( std::size_t node_budget = 1 );
+
+    /// Run step() until the pass is complete.
+    void run();
+
+    /// Leaves moved to fresh slots since construction.
+    std::uint64_t relocated() const;
+
+private:
+    bool compact_next();
+    LeafNode* leaf_before( const Path& path ) const;
+
+private:
+    BPlusTree& m_tree;
+
+    // First key of the leaf where the pass continues.
+    KeyType m_cursor;
+    bool m_in_pass;
+
+    std::uint64_t m_relocated;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef ROMZ_AMITTAI_BTREE_ENTRYALLOCATOR_H
+#define ROMZ_AMITTAI_BTREE_ENTRYALLOCATOR_H
+
+#include <cstddef>
+#include "EntryArenas.hpp"
+
+//
+// Allocator of the entry arrays of the nodes, from EntryArenas.
+//
+template < typename T >
+class EntryAllocator
+{
+public:
+    typedef T value_type;
+
+    EntryAllocator() = default;
+
+    template < typename U >
+    EntryAllocator( const EntryAllocator< U >& ) {}
+
+    T* allocate( std::size_t n )
+    {
+        return static_cast< T* >( EntryArenas::allocate( n * sizeof( T ) ) );
+    }
+
+    void deallocate( T* p, std::size_t n )
+    {
+        EntryArenas::deallocate( p, n * sizeof( T ) );
+    }
+};
+
+//
+// Every allocator frees what any other allocated.
+//
+template < typename T, typename U >
+bool operator==( const EntryAllocator< T >&, const EntryAllocator< U >& )
+{
+    return true;
+}
+
+template < typename T, typename U >
+bool operator!=( const EntryAllocator< T >&, const EntryAllocator< U >& )
+{
+    return false;
+}
+
+#endif
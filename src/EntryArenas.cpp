@@ -0,0 +1,104 @@
+#include <new>
+#include "EntryArenas.hpp"
+
+const std::size_t EntryArenas::MIN_SIZE;
+const std::size_t EntryArenas::MAX_SIZE;
+const std::size_t EntryArenas::ARENA_NO;
+
+//
+//
+//
+void* EntryArenas::allocate( std::size_t bytes )
+{
+    NodeArena* a = arena( bytes );
+    return a ? a->allocate() : ::operator new( bytes );
+}
+
+//
+//
+//
+void EntryArenas::deallocate( void* p, std::size_t bytes )
+{
+    NodeArena* a = arena( bytes );
+    if( a )
+    {
+        a->deallocate( p );
+    }
+    else
+    {
+        ::operator delete( p );
+    }
+}
+
+//
+//
+//
+void EntryArenas::set_page_mode( NodeArena::PageMode mode )
+{
+    for( std::size_t i = 0; i < ARENA_NO; i++ )
+    {
+        arenas()[ i ]->set_page_mode( mode );
+    }
+}
+
+//
+//
+//
+std::size_t EntryArenas::bytes()
+{
+    std::size_t total = 0;
+    for( std::size_t i = 0; i < ARENA_NO; i++ )
+    {
+        total += arenas()[ i ]->bytes();
+    }
+    return total;
+}
+
+//
+//
+//
+std::size_t EntryArenas::huge_bytes()
+{
+    std::size_t total = 0;
+    for( std::size_t i = 0; i < ARENA_NO; i++ )
+    {
+        total += arenas()[ i ]->huge_bytes();
+    }
+    return total;
+}
+
+//
+// The arena of the size class of "bytes", or null above MAX_SIZE.
+//
+NodeArena* EntryArenas::arena( std::size_t bytes )
+{
+    if( bytes > MAX_SIZE )
+    {
+        return nullptr;
+    }
+
+    std::size_t index = 0;
+    for( std::size_t size = MIN_SIZE; size < bytes; size *= 2 )
+    {
+        index++;
+    }
+    return arenas()[ index ];
+}
+
+//
+// Like the node arenas, the arenas have to outlive every tree and are
+// never destroyed.
+//
+NodeArena** EntryArenas::arenas()
+{
+    static NodeArena** arenas = []()
+    {
+        NodeArena** a = new NodeArena*[ ARENA_NO ];
+        for( std::size_t i = 0; i < ARENA_NO; i++ )
+        {
+            a[ i ] = new NodeArena( MIN_SIZE << i, true );
+        }
+        return a;
+    }();
+    return arenas;
+}
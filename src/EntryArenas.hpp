@@ -0,0 +1,40 @@
+#ifndef ROMZ_AMITTAI_BTREE_ENTRYARENAS_H
+#define ROMZ_AMITTAI_BTREE_ENTRYARENAS_H
+
+#include <cstddef>
+#include "NodeArena.hpp"
+
+//
+// Memory for the entry arrays of the nodes, the arrays every descent
+// searches.
+//
+// An array is rounded up to a power of two between MIN_SIZE and MAX_SIZE
+// bytes and taken from the arena of that size, so the arrays follow the
+// page mode of the nodes and a huge page mode covers them as well. The
+// arenas have thread caches. Larger arrays come from the C library.
+//
+class EntryArenas
+{
+public:
+    static void* allocate( std::size_t bytes );
+    static void deallocate( void* p, std::size_t bytes );
+
+    static void set_page_mode( NodeArena::PageMode mode );
+
+    /// Bytes reserved in chunks by all arenas.
+    static std::size_t bytes();
+
+    /// Bytes of those chunks backed by huge pages.
+    static std::size_t huge_bytes();
+
+public:
+    static const std::size_t MIN_SIZE = 64;
+    static const std::size_t MAX_SIZE = 64 << 10;
+    static const std::size_t ARENA_NO = 11;
+
+private:
+    static NodeArena* arena( std::size_t bytes );
+    static NodeArena** arenas();
+};
+
+#endif
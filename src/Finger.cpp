@@ -0,0 +1,143 @@
+#include <limits>
+#include "Finger.hpp"
+#include "InternalNode.hpp"
+#include "LeafNode.hpp"
+
+//
+//
+//
+Finger::Finger( const BPlusTree& tree )
+    : m_tree( tree )
+    , m_leaf{ nullptr }
+    , m_epoch{ 0 }
+    , m_lo{ 0 }
+    , m_hi{ 0 }
+    , m_has_lo{ false }
+    , m_has_hi{ false }
+    , m_hits{ 0 }
+    , m_next_hits{ 0 }
+    , m_misses{ 0 }
+{
+
+}
+
+//
+//
+//
+const Record* Finger::search( const KeyType& key )
+{
+    if( m_tree.is_empty() )
+    {
+        return nullptr;
+    }
+
+    if( m_leaf && m_epoch == m_tree.m_epoch )
+    {
+        if( covers( key ) )
+        {
+            m_hits++;
+            return m_leaf->lookup( key );
+        }
+
+        // Keys between the first and the last key of the next leaf lead
+        // to it, whatever the separators above.
+        const LeafNode* next = m_leaf->next();
+        if( next && !( key < next->first_key() ) && !( next->last_key() < key ) )
+        {
+            const std::int64_t last = next->last_key().to_int64();
+            m_leaf = next;
+            m_lo = next->first_key();
+            m_has_lo = true;
+            m_has_hi = last < std::numeric_limits< std::int64_t >::max();
+            m_hi = m_has_hi ? KeyType( last + 1 ) : m_hi;
+
+            m_next_hits++;
+            return m_leaf->lookup( key );
+        }
+    }
+
+    m_misses++;
+    return descend( key )->lookup( key );
+}
+
+//
+//
+//
+std::uint64_t Finger::hits() const
+{
+    return m_hits;
+}
+
+//
+//
+//
+std::uint64_t Finger::next_hits() const
+{
+    return m_next_hits;
+}
+
+//
+//
+//
+std::uint64_t Finger::misses() const
+{
+    return m_misses;
+}
+
+//
+//
+//
+double Finger::hit_rate() const
+{
+    const std::uint64_t total = m_hits + m_next_hits + m_misses;
+    return total ? static_cast< double >( m_hits + m_next_hits ) / static_cast< double >( total ) : 0.0;
+}
+
+//
+//
+//
+void Finger::reset_counters()
+{
+    m_hits = 0;
+    m_next_hits = 0;
+    m_misses = 0;
+}
+
+//
+// Every separator passed on the way down narrows the bounds.
+//
+const LeafNode* Finger::descend( const KeyType& key )
+{
+    m_has_lo = false;
+    m_has_hi = false;
+
+    const Node* node = m_tree.m_root;
+    while( !node->is_leaf() )
+    {
+        const InternalNode* internal = node->internal();
+        const std::size_t index = internal->child_index( key );
+        if( index > 0 )
+        {
+            m_lo = internal->key_at( index );
+            m_has_lo = true;
+        }
+        if( index + 1 < internal->size() )
+        {
+            m_hi = internal->key_at( index + 1 );
+            m_has_hi = true;
+        }
+        node = internal->neighbor( index );
+    }
+
+    m_leaf = node->leaf();
+    m_epoch = m_tree.m_epoch;
+    return m_leaf;
+}
+
+//
+//
+//
+bool Finger::covers( const KeyType& key ) const
+{
+    return ( !m_has_lo || !( key < m_lo ) ) && ( !m_has_hi || key < m_hi );
+}
@@ -0,0 +1,62 @@
+#ifndef ROMZ_AMITTAI_BTREE_FINGER_H
+#define ROMZ_AMITTAI_BTREE_FINGER_H
+
+#include <cstdint>
+#include "BPlusTree.hpp"
+
+//
+// Search cursor remembering the leaf of its last lookup.
+//
+// The descent to a leaf narrows the range of keys routed to it down to
+// [lo, hi). A later key in that range is looked up in the same leaf, and
+// a key within the keys of the next leaf in that leaf, without a descent. The tree keeps
+// an epoch that every split, merge or removal advances; a finger whose
+// epoch is behind descends again.
+//
+// A finger must not outlive its tree. Fingers are not shared between
+// threads; each thread reading the tree uses its own.
+//
+class Finger
+{
+public:
+    explicit Finger( const BPlusTree& tree );
+    ~Finger() = default;
+
+    /// Same as BPlusTree::search().
+    const Record* search( const KeyType& key );
+
+    /// Lookups served by the remembered leaf.
+    std::uint64_t hits() const;
+
+    /// Lookups served by the leaf after the remembered one.
+    std::uint64_t next_hits() const;
+
+    /// Lookups that descended from the root.
+    std::uint64_t misses() const;
+
+    /// Fraction of lookups served without a descent.
+    double hit_rate() const;
+
+    void reset_counters();
+
+private:
+    const LeafNode* descend( const KeyType& key );
+    bool covers( const KeyType& key ) const;
+
+private:
+    const BPlusTree& m_tree;
+    const LeafNode* m_leaf;
+    std::uint64_t m_epoch;
+
+    // Keys in [m_lo, m_hi) lead to m_leaf; a bound is open if its flag is off.
+    KeyType m_lo;
+    KeyType m_hi;
+    bool m_has_lo;
+    bool m_has_hi;
+
+    std::uint64_t m_hits;
+    std::uint64_t m_next_hits;
+    std::uint64_t m_misses;
+};
+
+#endif
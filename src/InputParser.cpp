@@ -0,0 +1,206 @@
+#include <stdexcept>
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include "InputParser.hpp"
+
+namespace
+{
+
+//
+//
+//
+bool is_space( char c )
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+//
+//
+//
+bool is_digit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+}
+
+//
+//
+//
+InputParser::InputParser( std::size_t thread_no, std::size_t min_chunk_size )
+    : m_thread_no{ thread_no ? thread_no : std::max( 1u, std::thread::hardware_concurrency() ) }
+    , m_min_chunk_size{ std::max< std::size_t >( 1, min_chunk_size ) }
+{
+
+}
+
+//
+// Every thread parses, sorts and dedupes its own chunk of the input,
+// then the sorted runs are merged pairwise, again in parallel.
+//
+std::vector< std::int64_t > InputParser::parse( const char* begin, const char* end ) const
+{
+    const std::size_t size = static_cast< std::size_t >( end - begin );
+    const std::size_t thread_no = std::max< std::size_t >( 1, std::min( m_thread_no, size / m_min_chunk_size ) );
+
+    std::vector< const char* > starts{ begin };
+    for( std::size_t i = 1; i < thread_no; i++ )
+    {
+        starts.push_back( std::max( starts.back(), chunk_end( begin + i * ( size / thread_no ), end ) ) );
+    }
+    starts.push_back( end );
+
+    std::vector< std::vector< std::int64_t > > parts( thread_no );
+    std::vector< std::exception_ptr > errors( thread_no );
+    std::vector< std::thread > threads;
+
+    for( std::size_t i = 0; i < thread_no; i++ )
+    {
+        threads.emplace_back( [ &, i ]()
+        {
+            try
+            {
+                std::vector< std::int64_t >& part = parts[ i ];
+                parse_chunk( starts[ i ], starts[ i + 1 ], part );
+                std::sort( part.begin(), part.end() );
+                part.erase( std::unique( part.begin(), part.end() ), part.end() );
+            }
+            catch( ... )
+            {
+                errors[ i ] = std::current_exception();
+            }
+        } );
+    }
+    for( auto& t : threads )
+    {
+        t.join();
+    }
+    for( auto& e : errors )
+    {
+        if( e )
+        {
+            std::rethrow_exception( e );
+        }
+    }
+
+    std::vector< std::size_t > bounds{ 0 };
+    std::size_t total = 0;
+    for( const auto& part : parts )
+    {
+        total += part.size();
+        bounds.push_back( total );
+    }
+
+    std::vector< std::int64_t > keys;
+    keys.reserve( total );
+    for( auto& part : parts )
+    {
+        keys.insert( keys.end(), part.begin(), part.end() );
+        std::vector< std::int64_t >().swap( part );
+    }
+
+    merge_runs( keys, bounds );
+    keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+    return keys;
+}
+
+//
+//
+//
+void InputParser::parse_chunk( const char* begin, const char* end, std::vector< std::int64_t >& out )
+{
+    const std::uint64_t max_positive = static_cast< std::uint64_t >( INT64_MAX );
+
+    const char* p = begin;
+    for( ;; )
+    {
+        while( p != end && is_space( *p ) )
+        {
+            ++p;
+        }
+        if( p == end )
+        {
+            return;
+        }
+
+        bool negative = false;
+        if( *p == '-' || *p == '+' )
+        {
+            negative = ( *p == '-' );
+            ++p;
+        }
+        if( p == end || !is_digit( *p ) )
+        {
+            throw std::runtime_error( "Invalid input" );
+        }
+
+        const std::uint64_t limit = negative ? max_positive + 1 : max_positive;
+        std::uint64_t v = 0;
+        while( p != end && is_digit( *p ) )
+        {
+            const std::uint64_t digit = static_cast< std::uint64_t >( *p - '0' );
+            if( v > ( limit - digit ) / 10 )
+            {
+                throw std::runtime_error( "Integer out of range" );
+            }
+            v = v * 10 + digit;
+            ++p;
+        }
+        if( p != end && !is_space( *p ) )
+        {
+            throw std::runtime_error( "Invalid input" );
+        }
+
+        out.push_back( static_cast< std::int64_t >( negative ? 0 - v : v ) );
+    }
+}
+
+//
+// First whitespace character at or after "pos", so that no chunk
+// boundary splits a number.
+//
+const char* InputParser::chunk_end( const char* pos, const char* end )
+{
+    while( pos != end && !is_space( *pos ) )
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+//
+// "bounds" delimits consecutive sorted runs of "keys".
+//
+void InputParser::merge_runs( std::vector< std::int64_t >& keys, std::vector< std::size_t >& bounds )
+{
+    while( bounds.size() > 2 )
+    {
+        std::vector< std::size_t > merged{ 0 };
+        std::vector< std::thread > threads;
+
+        for( std::size_t k = 0; k + 2 < bounds.size(); k += 2 )
+        {
+            const auto b = keys.begin();
+            const std::size_t first = bounds[ k ];
+            const std::size_t middle = bounds[ k + 1 ];
+            const std::size_t last = bounds[ k + 2 ];
+            threads.emplace_back( [ b, first, middle, last ]()
+            {
+                std::inplace_merge( b + first, b + middle, b + last );
+            } );
+            merged.push_back( last );
+        }
+        if( bounds.size() % 2 == 0 )
+        {
+            merged.push_back( bounds.back() );
+        }
+
+        for( auto& t : threads )
+        {
+            t.join();
+        }
+        bounds.swap( merged );
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef ROMZ_AMITTAI_BTREE_INPUTPARSER_H
+#define ROMZ_AMITTAI_BTREE_INPUTPARSER_H
+
+#include <cstdint>
+#include <vector>
+
+/// Parses whitespace separated decimal integers on several threads and
+/// returns them sorted, with duplicates removed.
+class InputParser
+{
+public:
+    /// @param[in] thread_no Number of worker threads; 0 selects one per core.
+    /// @param[in] min_chunk_size Fewer threads are used when the input
+    ///            would give any of them less than this many bytes.
+    explicit InputParser( std::size_t thread_no = 0, std::size_t min_chunk_size = 1 << 20 );
+    ~InputParser() = default;
+
+    std::vector< std::int64_t > parse( const char* begin, const char* end ) const;
+
+    /// Append every integer found in [begin, end) to "out".
+    static void parse_chunk( const char* begin, const char* end, std::vector< std::int64_t >& out );
+
+private:
+    static const char* chunk_end( const char* pos, const char* end );
+    static void merge_runs( std::vector< std::int64_t >& keys, std::vector< std::size_t >& bounds );
+
+private:
+    std::size_t m_thread_no;
+    std::size_t m_min_chunk_size;
+};
+
+#endif
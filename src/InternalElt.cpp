@@ -1,8 +1,9 @@
 #include "InternalElt.h"
 
-InternalElt::InternalElt( const KeyType& key, Node* node )
+InternalElt::InternalElt( const KeyType& key, Node* node, const Summary& summary )
     : m_key( key )
     , m_node( node )
+    , m_summary( summary )
 {
 
 }
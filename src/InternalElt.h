@@ -3,17 +3,21 @@
 
 #include "KeyType.h"
 #include "Node.hpp"
+#include "Summary.hpp"
 
 class InternalElt
 {
 public:
-    InternalElt( const KeyType &key, Node* node );
+    InternalElt( const KeyType &key, Node* node, const Summary& summary = Summary() );
     ~InternalElt() = default;
 
 public:
     KeyType m_key;
 
     Node* m_node;
+
+    // Aggregate of the keys and values in the subtree of "m_node".
+    Summary m_summary;
 };
 
 
@@ -1,19 +1,56 @@
 #include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <new>
 #include "InternalNode.hpp"
+#include "Replicas.hpp"
 
 
 
 //
 //
 //
-InternalNode::InternalNode( BPlusTree *tree, InternalNode *parent )
-    : Node( tree, parent )
+InternalNode::InternalNode()
 {
 
 }
 
+//
+//
+//
+void* InternalNode::operator new( std::size_t size )
+{
+    assert( size == sizeof( InternalNode ) );
+    ( void )size;
+    return arena().allocate();
+}
+
+//
+//
+//
+void InternalNode::operator delete( void* node )
+{
+    arena().deallocate( node );
+}
+
+//
+// The arena has to outlive every tree, static ones included,
+// so it is never destroyed.
+//
+NodeArena& InternalNode::arena()
+{
+    static NodeArena* arena = new NodeArena( sizeof( InternalNode ), true );
+    return *arena;
+}
+
+//
+// A new empty node, preferably in the arena chunk of "sibling".
+//
+InternalNode* InternalNode::create_near( const InternalNode* sibling )
+{
+    return ::new( arena().allocate_near( sibling ) ) InternalNode();
+}
+
 //
 //
 //
@@ -23,6 +60,7 @@ InternalNode::~InternalNode()
     {
         delete mapping.m_node;
     }
+    Replicas::release( m_replicas );
 }
 
 //
@@ -41,6 +79,27 @@ std::size_t InternalNode::size() const
     return m_elt.size();
 }
 
+//
+//
+//
+std::size_t InternalNode::entry_bytes() const
+{
+    return m_elt.capacity() * sizeof( InternalElt );
+}
+
+//
+//
+//
+Summary InternalNode::summary() const
+{
+    Summary s;
+    for( const auto& e : m_elt )
+    {
+        s.add( e.m_summary );
+    }
+    return s;
+}
+
 //
 //
 //
@@ -55,10 +114,92 @@ KeyType InternalNode::key_at( std::size_t index ) const
 //
 void InternalNode::set_key_at( std::size_t index, const KeyType& key )
 {
+    changed();
     assert( index < m_elt.size() );
     m_elt[ index ].m_key = key;
 }
 
+//
+//
+//
+const Summary& InternalNode::summary_at( std::size_t index ) const
+{
+    assert( index < m_elt.size() );
+    return m_elt[ index ].m_summary;
+}
+
+//
+//
+//
+std::size_t InternalNode::count_at( std::size_t index ) const
+{
+    assert( index < m_elt.size() );
+    return m_elt[ index ].m_summary.m_count;
+}
+
+//
+// Number of keys in the subtrees of the children before "index".
+//
+std::size_t InternalNode::count_before( std::size_t index ) const
+{
+    assert( index <= m_elt.size() );
+
+    std::size_t count = 0;
+    for( std::size_t i = 0; i < index; i++ )
+    {
+        count += m_elt[ i ].m_summary.m_count;
+    }
+    return count;
+}
+
+//
+// Refresh the summary of child "index" from the child itself.
+//
+void InternalNode::refresh( std::size_t index )
+{
+    assert( index < m_elt.size() );
+    m_elt[ index ].m_summary = m_elt[ index ].m_node->summary();
+}
+
+//
+// Account for "delta" added to the subtree of child "index".
+//
+void InternalNode::add_summary( std::size_t index, const Summary& delta )
+{
+    assert( index < m_elt.size() );
+    m_elt[ index ].m_summary.add( delta );
+}
+
+//
+// Account for "removed" taken out of the subtree of child "index"; the
+// child is only rescanned if its minimum or maximum may have gone.
+//
+void InternalNode::remove_summary( std::size_t index, const Summary& removed )
+{
+    assert( index < m_elt.size() );
+    if( !m_elt[ index ].m_summary.remove( removed ) )
+    {
+        refresh( index );
+    }
+}
+
+//
+// Account for "removed" replaced by "added" in the subtree of child
+// "index". A rescan sees "added" already, so it is not added again.
+//
+void InternalNode::replace_summary( std::size_t index, const Summary& removed, const Summary& added )
+{
+    assert( index < m_elt.size() );
+    if( m_elt[ index ].m_summary.remove( removed ) )
+    {
+        m_elt[ index ].m_summary.add( added );
+    }
+    else
+    {
+        refresh( index );
+    }
+}
+
 //
 //
 //
@@ -73,36 +214,65 @@ Node* InternalNode::first_child() const
 //
 void InternalNode::populate_new_root( Node *old_node, const KeyType& new_key, Node *new_node )
 {
+    changed();
     // assert( is_sorted() );
 
     assert( m_elt.empty() );
-    m_elt.push_back( InternalElt( DUMMY_KEY, old_node ) );
-    m_elt.push_back( InternalElt( new_key, new_node ) );
+    m_elt.push_back( InternalElt( DUMMY_KEY, old_node, old_node->summary() ) );
+    m_elt.push_back( InternalElt( new_key, new_node, new_node->summary() ) );
 
     // assert( is_sorted() );
 }
 
 //
+// Insert "new_node" right after the child "index", which the caller knows
+// from its descent, so the entries are not searched.
 //
-//
-void InternalNode::insert_after( Node *old_node, const KeyType& new_key, Node *new_node )
+void InternalNode::insert_after( std::size_t index, const KeyType& new_key, Node *new_node )
 {
+    changed();
     // assert( is_sorted() );
 
-    const auto pred = [ old_node ]( const InternalElt& e ){ return e.m_node == old_node; };
-    const auto iter = std::find_if( m_elt.begin(), m_elt.end(), pred );
-    assert( iter != m_elt.end() );
+    assert( index < m_elt.size() );
+    const auto iter = m_elt.begin() + static_cast< std::ptrdiff_t >( index );
 
-    m_elt.insert( iter + 1, InternalElt( new_key, new_node ) );
+    // The old node has just been split, so its summary is refreshed too.
+    iter->m_summary = iter->m_node->summary();
+    m_elt.insert( iter + 1, InternalElt( new_key, new_node, new_node->summary() ) );
 
     // assert( is_sorted() );
 }
 
+//
+// Append "node" as the last child; "key" separates it from its left
+// neighbor and is not stored if "node" becomes the first child.
+//
+void InternalNode::push_back( const KeyType& key, Node* node )
+{
+    changed();
+    m_elt.push_back( InternalElt( m_elt.empty() ? DUMMY_KEY : key, node, node->summary() ) );
+}
+
+//
+// Insert "node" as the first child; "key" separates it from the
+// current first child.
+//
+void InternalNode::push_front( Node* node, const KeyType& key )
+{
+    changed();
+    if( !m_elt.empty() )
+    {
+        m_elt.front().m_key = key;
+    }
+    m_elt.insert( m_elt.begin(), InternalElt( DUMMY_KEY, node, node->summary() ) );
+}
+
 //
 //
 //
 void InternalNode::remove( std::size_t index )
 {
+    changed();
     // assert( is_sorted() );
 
     assert( index < m_elt.size() );
@@ -111,11 +281,29 @@ void InternalNode::remove( std::size_t index )
     // assert( is_sorted() );
 }
 
+//
+// Delete the subtrees of the children in [first, last) and their entries.
+//
+void InternalNode::erase_children( std::size_t first, std::size_t last )
+{
+    changed();
+    assert( first <= last && last <= m_elt.size() );
+
+    const auto b = m_elt.begin() + first;
+    const auto e = m_elt.begin() + last;
+    for( auto it = b; it != e; ++it )
+    {
+        delete it->m_node;
+    }
+    m_elt.erase( b, e );
+}
+
 //
 //
 //
 Node* InternalNode::remove_and_return_only_child()
 {
+    changed();
     // assert( is_sorted() );
 
     assert( m_elt.size() == 1 );
@@ -132,6 +320,7 @@ Node* InternalNode::remove_and_return_only_child()
 //
 KeyType InternalNode::replace_and_return_first_key()
 {
+    changed();
     // assert( is_sorted() );
 
     const KeyType new_key = m_elt[ 0 ].m_key;
@@ -142,57 +331,71 @@ KeyType InternalNode::replace_and_return_first_key()
 }
 
 //
+// Append all but the first "keep" entries of "from" to "to".
+// The first moved entry keeps its key, which the caller has to
+// lift into the parent with replace_and_return_first_key().
 //
-//
-void InternalNode::move_half( InternalNode *from, InternalNode *to )
+void InternalNode::move_tail( InternalNode *from, InternalNode *to, std::size_t keep )
 {
-    assert( from->m_tree == to->m_tree );
+    from->changed();
+    to->changed();
+    assert( keep <= from->m_elt.size() );
 
-    const auto m = from->m_elt.begin() + from->m_tree->internal_min_size();
+    const auto m = from->m_elt.begin() + keep;
     const auto e = from->m_elt.end();
 
-    for( auto it = m; it != e; ++it )
-    {
-        assert( it->m_node->get_parent() == from );
-        it->m_node->set_parent( to );
-    }
-
     to->m_elt.insert( to->m_elt.end(), std::make_move_iterator( m ), std::make_move_iterator( e ) );
 
     from->m_elt.erase( m, e );
 }
 
 //
+// Append all entries of "from" to "to"; "separator" is the key of
+// "from" in the common parent.
 //
-//
-void InternalNode::move_all( InternalNode *from, InternalNode *to, std::size_t index_in_parent )
+void InternalNode::move_all( InternalNode *from, InternalNode *to, const KeyType& separator )
 {
-    from->m_elt[ 0 ].m_key = from->get_parent()->key_at( index_in_parent );
+    from->changed();
+    to->changed();
+    from->m_elt[ 0 ].m_key = separator;
 
     const auto b = from->m_elt.begin();
     const auto e = from->m_elt.end();
 
-    for( auto it = b; it != e; ++it )
-    {
-        assert( it->m_node->get_parent() == from );
-        it->m_node->set_parent( to );
-    }
-
     to->m_elt.insert( to->m_elt.end(), std::make_move_iterator( b ), std::make_move_iterator( e ) );
 
     from->m_elt.clear();
 }
 
 //
+// Move the entries of "node" to a new node in the next fresh slot of the
+// arena, with an entry array allocated anew from the entry arenas, and
+// free "node". The caller relinks the new node in its parent.
 //
+InternalNode* InternalNode::relocate( InternalNode* node )
+{
+    InternalNode* copy = ::new( arena().allocate_fresh() ) InternalNode();
+    copy->m_elt.reserve( node->m_elt.size() );
+    copy->m_elt.insert( copy->m_elt.end(), std::make_move_iterator( node->m_elt.begin() ), std::make_move_iterator( node->m_elt.end() ) );
+    node->m_elt.clear();
+    delete node;
+    return copy;
+}
+
 //
-void InternalNode::move_first_to_end_of( InternalNode *recipient )
+//
+//
+void InternalNode::move_first_to_end_of( InternalNode *recipient, InternalNode* parent )
 {
+    changed();
     // assert( is_sorted() );
 
-    recipient->copy_last_from( m_elt.front() );
+    // The first entry carries DUMMY_KEY; in the recipient it is
+    // keyed by the separator taken from the parent.
+    recipient->copy_last_from( InternalElt( parent->key_at( 1 ), m_elt.front().m_node, m_elt.front().m_summary ) );
     m_elt.erase( m_elt.begin() );
-    get_parent()->set_key_at( 1, m_elt.front().m_key );
+    parent->set_key_at( 1, m_elt.front().m_key );
+    m_elt.front().m_key = KeyType( DUMMY_KEY );
 
     // assert( is_sorted() );
 }
@@ -202,10 +405,10 @@ void InternalNode::move_first_to_end_of( InternalNode *recipient )
 //
 void InternalNode::copy_last_from( const InternalElt& pair )
 {
+    changed();
     // assert( is_sorted() );
 
     m_elt.push_back( pair );
-    m_elt.back().m_node->set_parent( this );
 
     // assert( is_sorted() );
 }
@@ -213,11 +416,12 @@ void InternalNode::copy_last_from( const InternalElt& pair )
 //
 //
 //
-void InternalNode::move_last_to_front_of( InternalNode *recipient, std::size_t parent_index )
+void InternalNode::move_last_to_front_of( InternalNode *recipient, InternalNode* parent, std::size_t parent_index )
 {
+    changed();
     // assert( is_sorted() );
 
-    recipient->copy_first_from( m_elt.back(), parent_index );
+    recipient->copy_first_from( m_elt.back(), parent, parent_index );
     m_elt.pop_back();
 
     // assert( is_sorted() );
@@ -226,15 +430,15 @@ void InternalNode::move_last_to_front_of( InternalNode *recipient, std::size_t p
 //
 //
 //
-void InternalNode::copy_first_from( const InternalElt& pair, std::size_t parent_index )
+void InternalNode::copy_first_from( const InternalElt& pair, InternalNode* parent, std::size_t parent_index )
 {
+    changed();
     // assert( is_sorted() );
 
-    m_elt.front().m_key = get_parent()->key_at( parent_index );
+    m_elt.front().m_key = parent->key_at( parent_index );
     m_elt.insert( m_elt.begin(), pair );
+    parent->set_key_at( parent_index, m_elt.front().m_key );
     m_elt.front().m_key = KeyType( DUMMY_KEY );
-    m_elt.front().m_node->set_parent( this );
-    get_parent()->set_key_at( parent_index, m_elt.front().m_key );
 
     // assert( is_sorted() );
 }
@@ -257,7 +461,7 @@ Node* InternalNode::lookup( const KeyType& key ) const
 */
 
 
-    assert( m_elt.front().m_key <= key );
+    assert( !m_elt.empty() );
     // assert( is_sorted() );
 
 
@@ -265,12 +469,13 @@ Node* InternalNode::lookup( const KeyType& key ) const
     // Is this equivalent to what is below ??
     //
 
+    // The first entry holds DUMMY_KEY and stands for "minus infinity",
+    // so it must not take part in the comparison.
     const auto pred = [ key ]( const InternalElt& v ){ return v.m_key > key; };
-    auto locator = std::find_if( m_elt.begin(), m_elt.end(), pred );
+    auto locator = std::find_if( m_elt.begin() + 1, m_elt.end(), pred );
     // locator->m_key is now the least key "k" such that key < k.
     // One before is the greatest key k such that key >= k.
 
-    assert( locator != m_elt.begin() );
     --locator;
     return locator->m_node;
 
@@ -286,20 +491,16 @@ Node* InternalNode::lookup( const KeyType& key ) const
 }
 
 //
+// Index of the child whose subtree covers "key".
 //
-//
-std::size_t InternalNode::node_index( Node *node ) const
+std::size_t InternalNode::child_index( const KeyType& key ) const
 {
-    // assert( is_sorted() );
-
-    const auto pred = [ node ]( const InternalElt& v ){ return( v.m_node == node ); };
-    const auto ff = std::find_if( m_elt.begin(), m_elt.end(), pred );
-    assert( ff != m_elt.end() );
+    assert( !m_elt.empty() );
 
-    const auto index = std::distance( m_elt.begin(), ff );
-    assert( index >= 0 );
+    const auto pred = [ key ]( const InternalElt& v ){ return v.m_key > key; };
+    const auto locator = std::find_if( m_elt.begin() + 1, m_elt.end(), pred );
 
-    return static_cast< std::size_t >( index );
+    return static_cast< std::size_t >( locator - m_elt.begin() ) - 1;
 }
 
 //
@@ -312,6 +513,16 @@ Node* InternalNode::neighbor( std::size_t index ) const
     return m_elt[ index ].m_node;
 }
 
+//
+// Replace child "index" by "node", which holds the same entries.
+//
+void InternalNode::set_neighbor( std::size_t index, Node* node )
+{
+    changed();
+    assert( index < m_elt.size() );
+    m_elt[ index ].m_node = node;
+}
+
 //
 //
 //
@@ -322,6 +533,14 @@ bool InternalNode::is_sorted() const
     return std::is_sorted( m_elt.begin(), m_elt.end(), pred );
 }
 
+//
+// The copies in the replicas no longer match the node.
+//
+void InternalNode::changed()
+{
+    m_stale = true;
+}
+
 //
 //
 //
@@ -337,5 +556,3 @@ const InternalNode* InternalNode::internal() const
 {
     return this;
 }
-
-
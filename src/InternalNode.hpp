@@ -24,59 +24,95 @@
 
 #include <vector>
 #include "Definitions.hpp"
+#include "EntryAllocator.hpp"
 #include "Node.hpp"
+#include "NodeArena.hpp"
 #include "KeyType.h"
 #include "InternalElt.h"
 
+class ReplicaNode;
+
 class InternalNode : public Node
 {
     friend class Io;
     friend class Printer;
+    friend class BulkLoader;
+    friend class Replicas;
 
 public:
-    InternalNode( BPlusTree *tree, InternalNode* parent );
+    InternalNode();
+
+    // Nodes are allocated from arena().
+    static void* operator new( std::size_t size );
+    static void operator delete( void* node );
+    static NodeArena& arena();
+    static InternalNode* create_near( const InternalNode* sibling );
     ~InternalNode();
 
     bool is_leaf() const override;
     std::size_t size() const override;
+    Summary summary() const override;
+
+    /// Bytes of the entry array, by capacity.
+    std::size_t entry_bytes() const;
 
 
     KeyType key_at( std::size_t index ) const;
     void set_key_at( std::size_t index, const KeyType& key );
 
+    const Summary& summary_at( std::size_t index ) const;
+    std::size_t count_at( std::size_t index ) const;
+    std::size_t count_before( std::size_t index ) const;
+    void refresh( std::size_t index );
+    void add_summary( std::size_t index, const Summary& delta );
+    void remove_summary( std::size_t index, const Summary& removed );
+    void replace_summary( std::size_t index, const Summary& removed, const Summary& added );
+
     Node* first_child() const;
 
     void populate_new_root( Node* old_node, const KeyType& new_key, Node* new_node );
-    void insert_after( Node* old_node, const KeyType& new_key, Node* new_node );
+    void insert_after( std::size_t index, const KeyType& new_key, Node* new_node );
+    void push_back( const KeyType& key, Node* node );
+    void push_front( Node* node, const KeyType& key );
 
     void remove( std::size_t index );
+    void erase_children( std::size_t first, std::size_t last );
     Node* remove_and_return_only_child();
     KeyType replace_and_return_first_key();
 
 
-    void move_first_to_end_of( InternalNode* recipient );
-    void move_last_to_front_of( InternalNode* recipient, std::size_t parent_index );
+    void move_first_to_end_of( InternalNode* recipient, InternalNode* parent );
+    void move_last_to_front_of( InternalNode* recipient, InternalNode* parent, std::size_t parent_index );
 
 
     Node* lookup( const KeyType& key ) const;
-    std::size_t node_index( Node* node ) const;
+    std::size_t child_index( const KeyType& key ) const;
     Node* neighbor( std::size_t index ) const;
+    void set_neighbor( std::size_t index, Node* node );
 
     InternalNode* internal() override;
     const InternalNode* internal() const override;
 
-    static void move_half( InternalNode *from, InternalNode *to );
-    static void move_all ( InternalNode *from, InternalNode *to, std::size_t index_in_parent );
+    static void move_all ( InternalNode *from, InternalNode *to, const KeyType& separator );
+    static void move_tail( InternalNode *from, InternalNode *to, std::size_t keep );
+    static InternalNode* relocate( InternalNode* node );
 
 
 private:
     void copy_last_from( const InternalElt& pair );
-    void copy_first_from( const InternalElt& pair, std::size_t parent_index );
+    void copy_first_from( const InternalElt& pair, InternalNode* parent, std::size_t parent_index );
 
     bool is_sorted() const;
+    void changed();
 
 private:
-    std::vector< InternalElt > m_elt;
+    std::vector< InternalElt, EntryAllocator< InternalElt > > m_elt;
+
+    // Copies of the node in the replicas of the internal levels, if the
+    // tree keeps any; "m_stale" is set by every change of a key or a
+    // child and cleared when the copies are updated.
+    std::vector< ReplicaNode* > m_replicas;
+    bool m_stale = false;
 
     // Key used where only the entry's pointer has meaning.
     const KeyType DUMMY_KEY{-1};
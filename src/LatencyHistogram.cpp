@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cmath>
+#include "LatencyHistogram.hpp"
+
+const std::size_t LatencyHistogram::SUB_BUCKET_NO;
+const std::size_t LatencyHistogram::BUCKET_NO;
+
+//
+//
+//
+LatencyHistogram::LatencyHistogram()
+    : m_count{ 0 }
+    , m_max{ 0 }
+    , m_sum{ 0 }
+{
+    m_buckets.fill( 0 );
+}
+
+//
+//
+//
+void LatencyHistogram::record( std::uint64_t ns )
+{
+    m_buckets[ bucket_of( ns ) ]++;
+    m_count++;
+    m_max = std::max( m_max, ns );
+    m_sum += static_cast< double >( ns );
+}
+
+//
+//
+//
+void LatencyHistogram::merge( const LatencyHistogram& other )
+{
+    for( std::size_t i = 0; i < BUCKET_NO; i++ )
+    {
+        m_buckets[ i ] += other.m_buckets[ i ];
+    }
+    m_count += other.m_count;
+    m_max = std::max( m_max, other.m_max );
+    m_sum += other.m_sum;
+}
+
+//
+//
+//
+std::uint64_t LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+//
+//
+//
+std::uint64_t LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+//
+//
+//
+double LatencyHistogram::mean() const
+{
+    return m_count ? m_sum / static_cast< double >( m_count ) : 0.0;
+}
+
+//
+//
+//
+std::uint64_t LatencyHistogram::percentile( double p ) const
+{
+    if( !m_count )
+    {
+        return 0;
+    }
+
+    const std::uint64_t rank = std::max< std::uint64_t >( 1, static_cast< std::uint64_t >( std::ceil( p * static_cast< double >( m_count ) ) ) );
+    std::uint64_t seen = 0;
+    for( std::size_t i = 0; i < BUCKET_NO; i++ )
+    {
+        seen += m_buckets[ i ];
+        if( seen >= rank )
+        {
+            return std::min( upper_bound_of( i ), m_max );
+        }
+    }
+    return m_max;
+}
+
+//
+// Below 2 * SUB_BUCKET_NO the bucket is the value. Above, the value is
+// shifted right until it lies in [SUB_BUCKET_NO, 2 * SUB_BUCKET_NO).
+//
+std::size_t LatencyHistogram::bucket_of( std::uint64_t ns )
+{
+    if( ns < 2 * SUB_BUCKET_NO )
+    {
+        return static_cast< std::size_t >( ns );
+    }
+
+    std::size_t shift = 0;
+    while( ( ns >> shift ) >= 2 * SUB_BUCKET_NO )
+    {
+        shift++;
+    }
+    return ( shift + 1 ) * SUB_BUCKET_NO + static_cast< std::size_t >( ns >> shift ) - SUB_BUCKET_NO;
+}
+
+//
+//
+//
+std::uint64_t LatencyHistogram::upper_bound_of( std::size_t bucket )
+{
+    if( bucket < 2 * SUB_BUCKET_NO )
+    {
+        return bucket;
+    }
+
+    const std::size_t shift = bucket / SUB_BUCKET_NO - 1;
+    const std::uint64_t mantissa = bucket % SUB_BUCKET_NO + SUB_BUCKET_NO;
+    return ( ( mantissa + 1 ) << shift ) - 1;
+}
@@ -0,0 +1,46 @@
+#ifndef ROMZ_AMITTAI_BTREE_LATENCYHISTOGRAM_H
+#define ROMZ_AMITTAI_BTREE_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+//
+// Histogram of latencies in nanoseconds with a bounded relative error.
+//
+// Values below 32 have a bucket each. Above, every power of two is split
+// into 16 buckets, so a bucket spans at most 1/16 of its lower bound.
+// Percentiles report the upper bound of their bucket.
+//
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    ~LatencyHistogram() = default;
+
+    void record( std::uint64_t ns );
+    void merge( const LatencyHistogram& other );
+
+    std::uint64_t count() const;
+    std::uint64_t max() const;
+    double mean() const;
+
+    /// Smallest bucket bound not exceeded by the fraction "p" of the
+    /// values, for "p" in [0, 1]; 0 if the histogram is empty.
+    std::uint64_t percentile( double p ) const;
+
+public:
+    static const std::size_t SUB_BUCKET_NO = 16;
+    static const std::size_t BUCKET_NO = 976;
+
+private:
+    static std::size_t bucket_of( std::uint64_t ns );
+    static std::uint64_t upper_bound_of( std::size_t bucket );
+
+private:
+    std::array< std::uint64_t, BUCKET_NO > m_buckets;
+    std::uint64_t m_count;
+    std::uint64_t m_max;
+    double m_sum;
+};
+
+#endif
@@ -1,20 +1,57 @@
 #include <stdexcept>
 #include <algorithm>
 #include <cassert>
+#include <new>
 #include "LeafNode.hpp"
 #include "InternalNode.hpp"
+#include "PerfProfile.hpp"
 
 
 //
 //
 //
-LeafNode::LeafNode( BPlusTree *tree, InternalNode* parent )
-    : Node( tree, parent )
-    , m_next{ nullptr }
+LeafNode::LeafNode()
+    : m_next{ nullptr }
 {
 
 }
 
+//
+//
+//
+void* LeafNode::operator new( std::size_t size )
+{
+    assert( size == sizeof( LeafNode ) );
+    ( void )size;
+    return arena().allocate();
+}
+
+//
+//
+//
+void LeafNode::operator delete( void* node )
+{
+    arena().deallocate( node );
+}
+
+//
+// The arena has to outlive every tree, static ones included,
+// so it is never destroyed.
+//
+NodeArena& LeafNode::arena()
+{
+    static NodeArena* arena = new NodeArena( sizeof( LeafNode ), true );
+    return *arena;
+}
+
+//
+// A new empty node, preferably in the arena chunk of "sibling".
+//
+LeafNode* LeafNode::create_near( const LeafNode* sibling )
+{
+    return ::new( arena().allocate_near( sibling ) ) LeafNode();
+}
+
 //
 //
 //
@@ -42,6 +79,27 @@ std::size_t LeafNode::size() const
     return m_elt.size();
 }
 
+//
+//
+//
+std::size_t LeafNode::entry_bytes() const
+{
+    return m_elt.capacity() * sizeof( LeafElt );
+}
+
+
+//
+//
+//
+Summary LeafNode::summary() const
+{
+    Summary s;
+    for( const auto& e : m_elt )
+    {
+        s.add( e.m_record->summary() );
+    }
+    return s;
+}
 
 //
 //
@@ -62,7 +120,7 @@ void LeafNode::set_next( LeafNode* next )
 //
 //
 //
-void LeafNode::insert( const KeyType& key, ValueType value )
+Record* LeafNode::insert( const KeyType& key, ValueType value )
 {
     assert( is_sorted() );
 
@@ -78,6 +136,7 @@ void LeafNode::insert( const KeyType& key, ValueType value )
     m_elt.insert( it, LeafElt( key, record ) );
 
     assert( is_sorted() );
+    return record;
 }
 
 
@@ -86,6 +145,7 @@ void LeafNode::insert( const KeyType& key, ValueType value )
 //
 Record* LeafNode::lookup( const KeyType& key ) const
 {
+    BTREE_PERF_SCOPE( LEAF_LOOKUP );
     const auto pred = [ key ]( const LeafElt& m ){ return m.m_key == key; };
     const auto it = std::find_if( m_elt.begin(), m_elt.end(), pred );
 
@@ -118,6 +178,28 @@ void LeafNode::remove( const KeyType& key )
     assert( is_sorted() );
 }
 
+//
+// Remove the keys in [lo, hi]; returns the number of keys removed.
+//
+std::size_t LeafNode::remove_range( const KeyType& lo, const KeyType& hi )
+{
+    assert( is_sorted() );
+
+    const auto b = std::find_if( m_elt.begin(), m_elt.end(), [ lo ]( const LeafElt& m ){ return m.m_key >= lo; } );
+    const auto e = std::find_if( b, m_elt.end(), [ hi ]( const LeafElt& m ){ return m.m_key > hi; } );
+
+    for( auto it = b; it != e; ++it )
+    {
+        delete it->m_record;
+    }
+
+    const std::size_t count = static_cast< std::size_t >( e - b );
+    m_elt.erase( b, e );
+
+    assert( is_sorted() );
+    return count;
+}
+
 //
 //
 //
@@ -130,11 +212,57 @@ KeyType LeafNode::first_key() const
 //
 //
 //
-void LeafNode::move_half( LeafNode *from, LeafNode *to )
+KeyType LeafNode::key_at( std::size_t index ) const
 {
-    assert( from->m_tree == to->m_tree );
+    assert( index < m_elt.size() );
+    return m_elt[ index ].m_key;
+}
+
+//
+//
+//
+Record* LeafNode::record_at( std::size_t index ) const
+{
+    assert( index < m_elt.size() );
+    return m_elt[ index ].m_record;
+}
+
+//
+//
+//
+KeyType LeafNode::last_key() const
+{
+    assert( !m_elt.empty() );
+    return m_elt.back().m_key;
+}
 
-    const auto m = from->m_elt.begin() + from->m_tree->leaf_min_size();
+//
+// Index of the first element whose key is not less than "key".
+//
+std::size_t LeafNode::lower_bound( const KeyType& key ) const
+{
+    const auto pred = [ key ]( const LeafElt& m ){ return m.m_key >= key; };
+    return static_cast< std::size_t >( std::find_if( m_elt.begin(), m_elt.end(), pred ) - m_elt.begin() );
+}
+
+//
+// Move the elements out of the leaf; the caller takes over their records.
+//
+LeafNode::Entries LeafNode::release()
+{
+    Entries elt;
+    elt.swap( m_elt );
+    return elt;
+}
+
+//
+// Append all but the first "keep" elements of "from" to "to".
+//
+void LeafNode::move_tail( LeafNode *from, LeafNode *to, std::size_t keep )
+{
+    assert( keep <= from->m_elt.size() );
+
+    const auto m = from->m_elt.begin() + keep;
     const auto e = from->m_elt.end();
 
     to->m_elt.insert( to->m_elt.end(), std::make_move_iterator( m ), std::make_move_iterator( e ) );
@@ -142,6 +270,22 @@ void LeafNode::move_half( LeafNode *from, LeafNode *to )
     from->m_elt.erase( m, e );
 }
 
+//
+// Move the entries of "leaf" to a new leaf in the next fresh slot of the
+// arena, with an entry array allocated anew from the entry arenas, and
+// free "leaf". The records stay where they are. The caller relinks the new
+// leaf in its parent and in the leaf chain.
+//
+LeafNode* LeafNode::relocate( LeafNode* leaf )
+{
+    LeafNode* copy = ::new( arena().allocate_fresh() ) LeafNode();
+    copy->m_elt.reserve( leaf->m_elt.size() );
+    move_all( leaf, copy );
+    copy->m_next = leaf->m_next;
+    delete leaf;
+    return copy;
+}
+
 //
 //
 //
@@ -159,13 +303,13 @@ void LeafNode::move_all( LeafNode *from, LeafNode *to )
 //
 //
 //
-void LeafNode::move_first_to_end_of( LeafNode* recipient )
+void LeafNode::move_first_to_end_of( LeafNode* recipient, InternalNode* parent )
 {
     assert( is_sorted() );
 
     recipient->copy_last_from( m_elt.front() );
     m_elt.erase( m_elt.begin() );
-    get_parent()->set_key_at( 1, m_elt.front().m_key );
+    parent->set_key_at( 1, m_elt.front().m_key );
 
     assert( is_sorted() );
 }
@@ -185,11 +329,11 @@ void LeafNode::copy_last_from( const LeafElt& pair )
 //
 //
 //
-void LeafNode::move_last_to_front_of( LeafNode *recipient, std::size_t parent_index )
+void LeafNode::move_last_to_front_of( LeafNode *recipient, InternalNode* parent, std::size_t parent_index )
 {
     assert( is_sorted() );
 
-    recipient->copy_first_from( m_elt.back(), parent_index );
+    recipient->copy_first_from( m_elt.back(), parent, parent_index );
     m_elt.pop_back();
 
     assert( is_sorted() );
@@ -198,12 +342,12 @@ void LeafNode::move_last_to_front_of( LeafNode *recipient, std::size_t parent_in
 //
 //
 //
-void LeafNode::copy_first_from( const LeafElt& pair, std::size_t parent_index )
+void LeafNode::copy_first_from( const LeafElt& pair, InternalNode* parent, std::size_t parent_index )
 {
     assert( is_sorted() );
 
     m_elt.insert( m_elt.begin(), pair );
-    get_parent()->set_key_at( parent_index, m_elt.front().m_key );
+    parent->set_key_at( parent_index, m_elt.front().m_key );
 
     assert( is_sorted() );
 }
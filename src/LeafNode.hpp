@@ -3,7 +3,9 @@
 
 
 #include <vector>
+#include "EntryAllocator.hpp"
 #include "Node.hpp"
+#include "NodeArena.hpp"
 #include "Record.hpp"
 #include "KeyType.h"
 #include "LeafElt.h"
@@ -12,39 +14,62 @@ class LeafNode : public Node
 {
     friend class Io;
     friend class Printer;
+    friend class BulkLoader;
+    friend class Snapshot;
 
 public:
-    LeafNode( BPlusTree *tree, InternalNode* parent );
+    // Entries in key order, in memory of the entry arenas.
+    typedef std::vector< LeafElt, EntryAllocator< LeafElt > > Entries;
+
+public:
+    LeafNode();
+
+    // Nodes are allocated from arena().
+    static void* operator new( std::size_t size );
+    static void operator delete( void* node );
+    static NodeArena& arena();
+    static LeafNode* create_near( const LeafNode* sibling );
     ~LeafNode();
 
     bool is_leaf() const override;
     std::size_t size() const override;
+    Summary summary() const override;
+
+    /// Bytes of the entry array, by capacity.
+    std::size_t entry_bytes() const;
 
     LeafNode* next() const;
     void set_next( LeafNode* next );
-    void insert( const KeyType& key, ValueType value );
+    Record* insert( const KeyType& key, ValueType value );
 
     Record* lookup( const KeyType& key ) const;
     void remove( const KeyType& key );
+    std::size_t remove_range( const KeyType& lo, const KeyType& hi );
     KeyType first_key() const;
+    KeyType key_at( std::size_t index ) const;
+    Record* record_at( std::size_t index ) const;
+    KeyType last_key() const;
+    std::size_t lower_bound( const KeyType& key ) const;
+    Entries release();
 
-    void move_first_to_end_of( LeafNode* recipient );
-    void move_last_to_front_of( LeafNode* recipient, std::size_t parent_index );
+    void move_first_to_end_of( LeafNode* recipient, InternalNode* parent );
+    void move_last_to_front_of( LeafNode* recipient, InternalNode* parent, std::size_t parent_index );
 
     LeafNode* leaf() override;
     const LeafNode* leaf() const override;
 
-    static void move_half( LeafNode *from, LeafNode *to );
     static void move_all ( LeafNode *from, LeafNode *to );
+    static void move_tail( LeafNode *from, LeafNode *to, std::size_t keep );
+    static LeafNode* relocate( LeafNode* leaf );
 
 private:
     void copy_last_from( const LeafElt &pair );
-    void copy_first_from( const LeafElt &pair, std::size_t parent_index );
+    void copy_first_from( const LeafElt &pair, InternalNode* parent, std::size_t parent_index );
 
     bool is_sorted() const;
 
 private:
-    std::vector< LeafElt > m_elt;
+    Entries m_elt;
 
     LeafNode* m_next;
 };
@@ -0,0 +1,77 @@
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MappedFile.hpp"
+
+//
+//
+//
+MappedFile::MappedFile( const std::string& file_name )
+    : m_data{ nullptr }
+    , m_size{ 0 }
+{
+    const int fd = ::open( file_name.c_str(), O_RDONLY );
+    if( fd < 0 )
+    {
+        throw std::runtime_error( "Cannot open " + file_name );
+    }
+
+    struct stat st;
+    if( ::fstat( fd, &st ) != 0 )
+    {
+        ::close( fd );
+        throw std::runtime_error( "Cannot stat " + file_name );
+    }
+
+    m_size = static_cast< std::size_t >( st.st_size );
+    if( m_size )
+    {
+        void* data = ::mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( data == MAP_FAILED )
+        {
+            ::close( fd );
+            throw std::runtime_error( "Cannot map " + file_name );
+        }
+        ::madvise( data, m_size, MADV_WILLNEED );
+        m_data = static_cast< const char* >( data );
+    }
+
+    ::close( fd );
+}
+
+//
+//
+//
+MappedFile::~MappedFile()
+{
+    if( m_data )
+    {
+        ::munmap( const_cast< char* >( m_data ), m_size );
+    }
+}
+
+//
+//
+//
+const char* MappedFile::begin() const
+{
+    return m_data;
+}
+
+//
+//
+//
+const char* MappedFile::end() const
+{
+    return m_data + m_size;
+}
+
+//
+//
+//
+std::size_t MappedFile::size() const
+{
+    return m_size;
+}
@@ -0,0 +1,26 @@
+#ifndef ROMZ_AMITTAI_BTREE_MAPPEDFILE_H
+#define ROMZ_AMITTAI_BTREE_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    explicit MappedFile( const std::string& file_name );
+    ~MappedFile();
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    const char* begin() const;
+    const char* end() const;
+    std::size_t size() const;
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+};
+
+#endif
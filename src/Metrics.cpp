@@ -0,0 +1,161 @@
+#include <ios>
+#include "Metrics.hpp"
+
+const std::size_t Metrics::SHARD_NO;
+
+//
+//
+//
+Metrics::Scope::Scope( Metrics& metrics, Counter counter, Latency latency )
+    : m_metrics( metrics )
+    , m_latency{ latency }
+    , m_start{ std::chrono::steady_clock::now() }
+{
+    m_metrics.add( counter );
+}
+
+//
+//
+//
+Metrics::Scope::~Scope()
+{
+    const auto ns = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - m_start ).count();
+    m_metrics.record( m_latency, static_cast< std::uint64_t >( ns ) );
+}
+
+//
+//
+//
+Metrics::Metrics()
+    : m_shards{ new Shard[ SHARD_NO ] }
+{
+    reset();
+}
+
+//
+//
+//
+void Metrics::add( Counter counter, std::uint64_t n )
+{
+    m_shards[ shard_index() ].m_counters[ counter ].fetch_add( n, std::memory_order_relaxed );
+}
+
+//
+//
+//
+void Metrics::record( Latency latency, std::uint64_t ns )
+{
+    Shard& shard = m_shards[ shard_index() ];
+    std::lock_guard< std::mutex > lock( shard.m_mutex );
+    shard.m_latency[ latency ].record( ns );
+}
+
+//
+//
+//
+std::uint64_t Metrics::count( Counter counter ) const
+{
+    std::uint64_t total = 0;
+    for( std::size_t i = 0; i < SHARD_NO; i++ )
+    {
+        total += m_shards[ i ].m_counters[ counter ].load( std::memory_order_relaxed );
+    }
+    return total;
+}
+
+//
+//
+//
+LatencyHistogram Metrics::latency( Latency latency ) const
+{
+    LatencyHistogram total;
+    for( std::size_t i = 0; i < SHARD_NO; i++ )
+    {
+        Shard& shard = m_shards[ i ];
+        std::lock_guard< std::mutex > lock( shard.m_mutex );
+        total.merge( shard.m_latency[ latency ] );
+    }
+    return total;
+}
+
+//
+//
+//
+void Metrics::reset()
+{
+    for( std::size_t i = 0; i < SHARD_NO; i++ )
+    {
+        Shard& shard = m_shards[ i ];
+        for( auto& counter : shard.m_counters )
+        {
+            counter.store( 0, std::memory_order_relaxed );
+        }
+
+        std::lock_guard< std::mutex > lock( shard.m_mutex );
+        shard.m_latency.fill( LatencyHistogram() );
+    }
+}
+
+//
+//
+//
+void Metrics::write_prometheus( std::ostream& out, const std::string& prefix ) const
+{
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision( 9 );
+    out.unsetf( std::ios_base::floatfield );
+
+    for( int c = 0; c < COUNTER_NO; c++ )
+    {
+        const Counter counter = static_cast< Counter >( c );
+        const std::string metric = prefix + "_" + name( counter ) + "_total";
+        out << "# TYPE " << metric << " counter\n";
+        out << metric << " " << count( counter ) << "\n";
+    }
+
+    for( int l = 0; l < LATENCY_NO; l++ )
+    {
+        const Latency which = static_cast< Latency >( l );
+        const LatencyHistogram h = latency( which );
+        const std::string metric = prefix + "_" + name( which ) + "_latency_seconds";
+        out << "# TYPE " << metric << " summary\n";
+        for( const char* q : { "0.5", "0.99", "0.999" } )
+        {
+            out << metric << "{quantile=\"" << q << "\"} " << static_cast< double >( h.percentile( std::stod( q ) ) ) * 1e-9 << "\n";
+        }
+        out << metric << "_sum " << h.mean() * static_cast< double >( h.count() ) * 1e-9 << "\n";
+        out << metric << "_count " << h.count() << "\n";
+    }
+
+    out.flags( flags );
+    out.precision( precision );
+}
+
+//
+//
+//
+const char* Metrics::name( Counter counter )
+{
+    static const char* const names[ COUNTER_NO ] = {
+        "searches", "inserts", "removes", "leaf_splits", "internal_splits", "coalesces", "redistributions" };
+    return names[ counter ];
+}
+
+//
+//
+//
+const char* Metrics::name( Latency latency )
+{
+    static const char* const names[ LATENCY_NO ] = { "search", "insert", "remove" };
+    return names[ latency ];
+}
+
+//
+// Threads take the shards in turn, in the order of their first use.
+//
+std::size_t Metrics::shard_index()
+{
+    static std::atomic< std::size_t > next{ 0 };
+    thread_local const std::size_t index = next.fetch_add( 1, std::memory_order_relaxed ) % SHARD_NO;
+    return index;
+}
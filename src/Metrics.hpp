@@ -0,0 +1,118 @@
+#ifndef ROMZ_AMITTAI_BTREE_METRICS_H
+#define ROMZ_AMITTAI_BTREE_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "LatencyHistogram.hpp"
+
+//
+// Operation counters and latency histograms of a tree.
+//
+// The tree keeps them only when built with BTREE_STATS defined (the CMake
+// option of the same name); otherwise the hooks below expand to nothing.
+//
+// The data is sharded: every thread updates the shard picked by its own
+// index, so concurrent readers rarely touch the same cache lines. The
+// counters are relaxed atomics; a histogram is guarded by the mutex of
+// its shard, which is uncontended unless more threads than shards are
+// running. Readings sum up the shards.
+//
+class Metrics
+{
+public:
+    enum Counter
+    {
+        SEARCHES,
+
+        // Calls of insert(), try_insert(), insert_or_assign(), update()
+        // and upsert().
+        INSERTS,
+        REMOVES,
+        LEAF_SPLITS,
+        INTERNAL_SPLITS,
+        COALESCES,
+        REDISTRIBUTIONS,
+        COUNTER_NO
+    };
+
+    enum Latency
+    {
+        SEARCH_LATENCY,
+        INSERT_LATENCY,
+        REMOVE_LATENCY,
+        LATENCY_NO
+    };
+
+    //
+    // Counts an operation and records its latency when it goes out of scope.
+    //
+    class Scope
+    {
+    public:
+        Scope( Metrics& metrics, Counter counter, Latency latency );
+        ~Scope();
+
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+
+    private:
+        Metrics& m_metrics;
+        const Latency m_latency;
+        const std::chrono::steady_clock::time_point m_start;
+    };
+
+public:
+    Metrics();
+    ~Metrics() = default;
+
+    Metrics( const Metrics& ) = delete;
+    Metrics& operator=( const Metrics& ) = delete;
+
+    void add( Counter counter, std::uint64_t n = 1 );
+    void record( Latency latency, std::uint64_t ns );
+
+    std::uint64_t count( Counter counter ) const;
+    LatencyHistogram latency( Latency latency ) const;
+
+    void reset();
+
+    /// Write the counters, and the quantiles 0.5, 0.99 and 0.999 of the
+    /// latencies in seconds, in the Prometheus text exposition format.
+    /// Every metric name starts with "prefix" and an underscore.
+    void write_prometheus( std::ostream& out, const std::string& prefix = "btree" ) const;
+
+    static const char* name( Counter counter );
+    static const char* name( Latency latency );
+
+public:
+    static const std::size_t SHARD_NO = 16;
+
+private:
+    struct Shard
+    {
+        std::array< std::atomic< std::uint64_t >, COUNTER_NO > m_counters;
+        std::array< LatencyHistogram, LATENCY_NO > m_latency;
+        std::mutex m_mutex;
+    };
+
+    static std::size_t shard_index();
+
+private:
+    std::unique_ptr< Shard[] > m_shards;
+};
+
+#ifdef BTREE_STATS
+#define BTREE_STATS_COUNT( counter ) m_metrics.add( Metrics::counter )
+#define BTREE_STATS_SCOPE( counter, latency ) const Metrics::Scope stats_scope( m_metrics, Metrics::counter, Metrics::latency )
+#else
+#define BTREE_STATS_COUNT( counter ) ( void )0
+#define BTREE_STATS_SCOPE( counter, latency ) ( void )0
+#endif
+
+#endif
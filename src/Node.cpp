@@ -1,50 +1,6 @@
 #include <cassert>
 #include "Node.hpp"
 
-//
-//
-//
-Node::Node( BPlusTree *tree, InternalNode* parent )
-    : m_tree{ tree }
-    , m_parent{ parent }
-{
-    assert( m_tree );
-}
-
-//
-//
-//
-InternalNode *Node::get_parent()
-{
-    return m_parent;
-}
-
-/*
-//
-//
-//
-const InternalNode *Node::get_parent() const
-{
-    return m_parent;
-}
-*/
-
-//
-//
-//
-void Node::set_parent( InternalNode *parent )
-{
-    m_parent = parent;
-}
-
-//
-//
-//
-bool Node::is_root() const
-{
-    return !m_parent;
-}
-
 //
 //
 //
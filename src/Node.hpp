@@ -3,6 +3,7 @@
 
 #include "Definitions.hpp"
 #include "BPlusTree.hpp"
+#include "Summary.hpp"
 
 class InternalNode;
 class LeafNode;
@@ -10,15 +11,9 @@ class LeafNode;
 class Node
 {
 public:
-    Node( BPlusTree *tree, InternalNode *parent );
+    Node() = default;
     virtual ~Node() = default;
 
-    InternalNode* get_parent();
-    // const InternalNode* get_parent() const;
-    void set_parent( InternalNode* parent );
-
-    bool is_root() const;
-
     virtual InternalNode* internal();
     virtual const InternalNode* internal() const;
 
@@ -29,12 +24,8 @@ public:
     virtual bool is_leaf() const = 0;
     virtual std::size_t size() const = 0;
 
-protected:
-    BPlusTree *m_tree;
-
-private:
-    InternalNode* m_parent;
-
+    // Aggregate of the subtree rooted at this node.
+    virtual Summary summary() const = 0;
 
 };
 
@@ -0,0 +1,548 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "NodeArena.hpp"
+#include "Numa.hpp"
+
+const std::size_t NodeArena::CHUNK_SIZE;
+const std::size_t NodeArena::NO_NODE;
+const std::size_t NodeArena::CACHE_BATCH;
+const std::size_t NodeArena::CACHE_BYTES;
+const std::size_t NodeArena::CACHED_ARENA_NO;
+const std::size_t NodeArena::NO_CACHE;
+
+//
+// Slots of one arena taken by one thread; the newest on top.
+//
+struct NodeArena::Cache
+{
+    ~Cache();
+
+    NodeArena* m_arena = nullptr;
+    std::size_t m_size = 0;
+    void* m_slots[ 2 * CACHE_BATCH ];
+};
+
+//
+// A thread that ends returns its slots.
+//
+NodeArena::Cache::~Cache()
+{
+    if( !m_arena )
+    {
+        return;
+    }
+
+    std::lock_guard< std::mutex > lock( m_arena->m_mutex );
+    for( std::size_t i = 0; i < m_size; i++ )
+    {
+        m_arena->give( m_slots[ i ] );
+    }
+}
+
+//
+//
+//
+static std::size_t align_up( std::size_t size )
+{
+    const std::size_t a = alignof( std::max_align_t );
+    return ( size + a - 1 ) / a * a;
+}
+
+//
+//
+//
+NodeArena::NodeArena( std::size_t slot_size, bool thread_cache )
+    : m_slot_size{ align_up( std::max( slot_size, sizeof( void* ) ) ) }
+    , m_header_size{ align_up( sizeof( Chunk ) ) }
+    , m_chunks{ nullptr }
+    , m_free_chunks{ nullptr }
+    , m_chunk_no{ 0 }
+    , m_huge_chunk_no{ 0 }
+    , m_page_mode{ SMALL_PAGES }
+    , m_numa_node{ NO_NODE }
+    , m_current{ nullptr }
+    , m_next{ nullptr }
+    , m_end{ nullptr }
+    , m_cache_index{ NO_CACHE }
+    , m_batch{ std::max< std::size_t >( 1, std::min( CACHE_BATCH, CACHE_BYTES / m_slot_size ) ) }
+{
+    assert( m_header_size + m_slot_size <= CHUNK_SIZE );
+
+    if( thread_cache )
+    {
+        static std::atomic< std::size_t > next{ 0 };
+        m_cache_index = next.fetch_add( 1, std::memory_order_relaxed );
+        if( m_cache_index >= CACHED_ARENA_NO )
+        {
+            throw std::runtime_error( "Too many arenas with a thread cache" );
+        }
+    }
+}
+
+//
+//
+//
+NodeArena::~NodeArena()
+{
+    while( m_chunks )
+    {
+        Chunk* chunk = m_chunks;
+        m_chunks = chunk->m_next;
+        unmap_chunk( chunk );
+    }
+}
+
+//
+//
+//
+void* NodeArena::allocate()
+{
+    Cache* local = cache();
+    if( !local )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        return take_any();
+    }
+
+    if( !local->m_size )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        while( local->m_size < m_batch )
+        {
+            local->m_slots[ local->m_size++ ] = take_any();
+        }
+
+        // Handed out in the order taken, which is address order for
+        // slots of a fresh chunk.
+        std::reverse( local->m_slots, local->m_slots + local->m_size );
+    }
+    return local->m_slots[ --local->m_size ];
+}
+
+//
+// A cached slot in the chunk of "slot", else any cached slot; an empty
+// cache is refilled from the chunk of "slot" first.
+//
+void* NodeArena::allocate_near( const void* slot )
+{
+    Chunk* chunk = chunk_of( slot );
+    Cache* local = cache();
+    if( !local )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        return take_near( chunk );
+    }
+
+    for( std::size_t i = local->m_size; i-- > 0; )
+    {
+        if( chunk_of( local->m_slots[ i ] ) == chunk )
+        {
+            void* near = local->m_slots[ i ];
+            std::move( local->m_slots + i + 1, local->m_slots + local->m_size, local->m_slots + i );
+            local->m_size--;
+            return near;
+        }
+    }
+
+    if( !local->m_size )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        while( local->m_size < m_batch )
+        {
+            local->m_slots[ local->m_size++ ] = take_near( chunk );
+        }
+        std::reverse( local->m_slots, local->m_slots + local->m_size );
+    }
+    return local->m_slots[ --local->m_size ];
+}
+
+//
+//
+//
+void* NodeArena::allocate_fresh()
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return bump();
+}
+
+//
+//
+//
+void NodeArena::deallocate( void* slot )
+{
+    if( !slot )
+    {
+        return;
+    }
+
+    Cache* local = cache();
+    if( !local )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        give( slot );
+        return;
+    }
+
+    if( local->m_size == 2 * m_batch )
+    {
+        // The oldest half goes back to the chunks.
+        std::lock_guard< std::mutex > lock( m_mutex );
+        for( std::size_t i = 0; i < m_batch; i++ )
+        {
+            give( local->m_slots[ i ] );
+        }
+        std::move( local->m_slots + m_batch, local->m_slots + local->m_size, local->m_slots );
+        local->m_size -= m_batch;
+    }
+    local->m_slots[ local->m_size++ ] = slot;
+}
+
+//
+// The thread cache of this arena for the calling thread, if it has one.
+//
+NodeArena::Cache* NodeArena::cache()
+{
+    if( m_cache_index == NO_CACHE )
+    {
+        return nullptr;
+    }
+
+    thread_local Cache caches[ CACHED_ARENA_NO ];
+    Cache* local = &caches[ m_cache_index ];
+    local->m_arena = this;
+    return local;
+}
+
+//
+// The caller holds the mutex.
+//
+void* NodeArena::take_any()
+{
+    if( m_free_chunks )
+    {
+        return take( m_free_chunks );
+    }
+    return bump();
+}
+
+//
+// A freed slot in "chunk", then the unused rest of that chunk if it is
+// the newest one, then any slot. The caller holds the mutex.
+//
+void* NodeArena::take_near( Chunk* chunk )
+{
+    if( chunk->m_free )
+    {
+        return take( chunk );
+    }
+    if( chunk != m_current && m_free_chunks )
+    {
+        return take( m_free_chunks );
+    }
+    return bump();
+}
+
+//
+// The caller holds the mutex.
+//
+void NodeArena::give( void* slot )
+{
+    Chunk* chunk = chunk_of( slot );
+    assert( chunk->m_used > 0 );
+    chunk->m_used--;
+
+    if( !chunk->m_used && chunk != m_current )
+    {
+        release( chunk );
+        return;
+    }
+
+    if( !chunk->m_free )
+    {
+        link_free( chunk );
+    }
+    *static_cast< void** >( slot ) = chunk->m_free;
+    chunk->m_free = slot;
+}
+
+//
+//
+//
+std::size_t NodeArena::bytes() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_chunk_no * CHUNK_SIZE;
+}
+
+//
+//
+//
+void NodeArena::set_page_mode( PageMode mode )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_page_mode = mode;
+}
+
+//
+//
+//
+NodeArena::PageMode NodeArena::page_mode() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_page_mode;
+}
+
+//
+//
+//
+std::size_t NodeArena::huge_bytes() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_huge_chunk_no * CHUNK_SIZE;
+}
+
+//
+//
+//
+void NodeArena::set_numa_node( std::size_t node )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_numa_node = node;
+}
+
+//
+//
+//
+std::size_t NodeArena::numa_node() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_numa_node;
+}
+
+//
+//
+//
+NodeArena::Chunk* NodeArena::chunk_of( const void* slot )
+{
+    const std::uintptr_t p = reinterpret_cast< std::uintptr_t >( slot );
+    return reinterpret_cast< Chunk* >( p & ~std::uintptr_t( CHUNK_SIZE - 1 ) );
+}
+
+//
+// The caller holds the mutex; "chunk" has a freed slot.
+//
+void* NodeArena::take( Chunk* chunk )
+{
+    void* slot = chunk->m_free;
+    chunk->m_free = *static_cast< void** >( slot );
+    chunk->m_used++;
+    if( !chunk->m_free )
+    {
+        unlink_free( chunk );
+    }
+    return slot;
+}
+
+//
+// The caller holds the mutex.
+//
+void* NodeArena::bump()
+{
+    if( m_next == m_end )
+    {
+        PageMode pages = m_page_mode;
+        bool mapped = false;
+        void* memory = map_chunk( pages, m_numa_node, mapped );
+
+        // The previous chunk was kept while it was the newest one.
+        if( m_current && !m_current->m_used )
+        {
+            release( m_current );
+        }
+
+        Chunk* chunk = static_cast< Chunk* >( memory );
+        chunk->m_prev = nullptr;
+        chunk->m_next = m_chunks;
+        chunk->m_prev_free = nullptr;
+        chunk->m_next_free = nullptr;
+        chunk->m_free = nullptr;
+        chunk->m_used = 0;
+        chunk->m_pages = pages;
+        chunk->m_mapped = mapped;
+        if( pages != SMALL_PAGES )
+        {
+            m_huge_chunk_no++;
+        }
+        if( m_chunks )
+        {
+            m_chunks->m_prev = chunk;
+        }
+        m_chunks = chunk;
+        m_chunk_no++;
+
+        m_current = chunk;
+        m_next = static_cast< char* >( memory ) + m_header_size;
+        m_end = m_next + ( CHUNK_SIZE - m_header_size ) / m_slot_size * m_slot_size;
+    }
+
+    void* slot = m_next;
+    m_next += m_slot_size;
+    m_current->m_used++;
+    return slot;
+}
+
+//
+// The caller holds the mutex; no slot of "chunk" is in use.
+//
+void NodeArena::release( Chunk* chunk )
+{
+    if( chunk->m_free )
+    {
+        unlink_free( chunk );
+    }
+    if( chunk->m_prev )
+    {
+        chunk->m_prev->m_next = chunk->m_next;
+    }
+    else
+    {
+        m_chunks = chunk->m_next;
+    }
+    if( chunk->m_next )
+    {
+        chunk->m_next->m_prev = chunk->m_prev;
+    }
+    if( chunk == m_current )
+    {
+        m_current = nullptr;
+        m_next = m_end = nullptr;
+    }
+    m_chunk_no--;
+    if( chunk->m_pages != SMALL_PAGES )
+    {
+        m_huge_chunk_no--;
+    }
+    unmap_chunk( chunk );
+}
+
+//
+// A chunk aligned to its size, allocated as "mode" asks or as the system
+// allows; "mode" is set to what was used. Chunks placed on a NUMA node are
+// mapped directly, so that none of their pages has been touched before
+// they are bound.
+//
+void* NodeArena::map_chunk( PageMode& mode, std::size_t node, bool& mapped )
+{
+#ifdef MAP_HUGETLB
+    if( mode == HUGE_PAGES )
+    {
+        // Huge pages are aligned to their size.
+        void* memory = mmap( nullptr, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        if( memory != MAP_FAILED )
+        {
+            if( node != NO_NODE )
+            {
+                Numa::bind( memory, CHUNK_SIZE, node );
+            }
+            mapped = true;
+            return memory;
+        }
+        mode = TRANSPARENT_HUGE_PAGES;
+    }
+#endif
+
+    if( mode != SMALL_PAGES || node != NO_NODE )
+    {
+        // Map twice the size and trim the ends to reach the alignment.
+        void* region = mmap( nullptr, 2 * CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if( region == MAP_FAILED )
+        {
+            throw std::bad_alloc();
+        }
+        char* begin = static_cast< char* >( region );
+        char* memory = reinterpret_cast< char* >( ( reinterpret_cast< std::uintptr_t >( begin ) + CHUNK_SIZE - 1 ) & ~std::uintptr_t( CHUNK_SIZE - 1 ) );
+        if( memory != begin )
+        {
+            munmap( begin, static_cast< std::size_t >( memory - begin ) );
+        }
+        munmap( memory + CHUNK_SIZE, static_cast< std::size_t >( begin + CHUNK_SIZE - memory ) );
+
+#ifdef MADV_HUGEPAGE
+        // Kernels without transparent huge pages reject the advice.
+        if( mode != SMALL_PAGES && madvise( memory, CHUNK_SIZE, MADV_HUGEPAGE ) )
+        {
+            mode = SMALL_PAGES;
+        }
+#else
+        mode = SMALL_PAGES;
+#endif
+        if( node != NO_NODE )
+        {
+            Numa::bind( memory, CHUNK_SIZE, node );
+        }
+        mapped = true;
+        return memory;
+    }
+
+    void* memory = nullptr;
+    if( posix_memalign( &memory, CHUNK_SIZE, CHUNK_SIZE ) )
+    {
+        throw std::bad_alloc();
+    }
+    mapped = false;
+    return memory;
+}
+
+//
+//
+//
+void NodeArena::unmap_chunk( Chunk* chunk )
+{
+    if( chunk->m_mapped )
+    {
+        munmap( chunk, CHUNK_SIZE );
+    }
+    else
+    {
+        std::free( chunk );
+    }
+}
+
+//
+//
+//
+void NodeArena::link_free( Chunk* chunk )
+{
+    chunk->m_prev_free = nullptr;
+    chunk->m_next_free = m_free_chunks;
+    if( m_free_chunks )
+    {
+        m_free_chunks->m_prev_free = chunk;
+    }
+    m_free_chunks = chunk;
+}
+
+//
+//
+//
+void NodeArena::unlink_free( Chunk* chunk )
+{
+    if( chunk->m_prev_free )
+    {
+        chunk->m_prev_free->m_next_free = chunk->m_next_free;
+    }
+    else
+    {
+        m_free_chunks = chunk->m_next_free;
+    }
+    if( chunk->m_next_free )
+    {
+        chunk->m_next_free->m_prev_free = chunk->m_prev_free;
+    }
+}
@@ -0,0 +1,153 @@
+#ifndef ROMZ_AMITTAI_BTREE_NODEARENA_H
+#define ROMZ_AMITTAI_BTREE_NODEARENA_H
+
+#include <cstddef>
+#include <mutex>
+
+//
+// Fixed-size slots carved out of 2 MB chunks aligned to their size.
+//
+// Every chunk keeps its own list of freed slots and a count of the slots
+// in use; a chunk whose last slot is freed is returned to the system.
+// allocate() reuses a freed slot if there is one, allocate_near() prefers
+// the chunk of a given slot, which keeps a split node next to its sibling,
+// and allocate_fresh() only takes slots that were never used, so that a
+// sequence of its calls returns adjacent slots. The relayout pass and the
+// compactor use it to lay nodes out in key order.
+//
+// An arena built with a thread cache hands slots out from small per-thread
+// caches, which take and return slots in batches under the mutex, so that
+// threads allocating at the same time rarely meet on it. The leaf and
+// internal node arenas have one, so that trees changed by different
+// threads, like the partitions of a PartitionedTree, rarely meet on a
+// lock when they split or merge nodes either. Such an arena must live
+// as long as the process, like the node arenas do.
+//
+// A chunk is as large as a huge page on x86-64, so with a huge page mode
+// every chunk maps to a single TLB entry instead of 512. The mode applies
+// to the chunks allocated after it is set; when the system has no huge
+// pages to give, the chunks fall back to normal pages. Likewise the chunks
+// can be bound to a NUMA node.
+//
+class NodeArena
+{
+public:
+    enum PageMode
+    {
+        // Normal pages, from the C library.
+        SMALL_PAGES,
+
+        // Anonymous mappings advised with MADV_HUGEPAGE, which the kernel
+        // backs with transparent huge pages when it can.
+        TRANSPARENT_HUGE_PAGES,
+
+        // MAP_HUGETLB mappings from the reserved huge page pool
+        // (vm.nr_hugepages); transparent huge pages when the pool is empty.
+        HUGE_PAGES
+    };
+
+public:
+    explicit NodeArena( std::size_t slot_size, bool thread_cache = false );
+    ~NodeArena();
+
+    NodeArena( const NodeArena& ) = delete;
+    NodeArena& operator=( const NodeArena& ) = delete;
+
+    void* allocate();
+    void* allocate_near( const void* slot );
+    void* allocate_fresh();
+    void deallocate( void* slot );
+
+    /// Bytes reserved in chunks.
+    std::size_t bytes() const;
+
+    void set_page_mode( PageMode mode );
+    PageMode page_mode() const;
+
+    /// Bytes in chunks taken from the huge page pool or advised as
+    /// transparent huge pages.
+    std::size_t huge_bytes() const;
+
+    /// Place the chunks allocated from now on on a NUMA node; NO_NODE
+    /// leaves the placement to the kernel.
+    void set_numa_node( std::size_t node );
+    std::size_t numa_node() const;
+
+public:
+    static const std::size_t CHUNK_SIZE = std::size_t( 2 ) << 20;
+    static const std::size_t NO_NODE = ~std::size_t( 0 );
+
+    /// Slots moved between a thread cache and the chunks at a time; a
+    /// cache holds up to twice as many. Arenas of large slots move fewer,
+    /// about CACHE_BYTES worth but at least one.
+    static const std::size_t CACHE_BATCH = 16;
+    static const std::size_t CACHE_BYTES = 16 << 10;
+
+    /// Number of arenas that can have a thread cache.
+    static const std::size_t CACHED_ARENA_NO = 16;
+
+private:
+    struct Chunk
+    {
+        // All chunks.
+        Chunk* m_prev;
+        Chunk* m_next;
+
+        // Chunks with freed slots.
+        Chunk* m_prev_free;
+        Chunk* m_next_free;
+
+        // Freed slots, linked through their first word.
+        void* m_free;
+        std::size_t m_used;
+
+        // How the chunk was allocated.
+        PageMode m_pages;
+        bool m_mapped;
+    };
+
+    struct Cache;
+
+    static Chunk* chunk_of( const void* slot );
+    static void* map_chunk( PageMode& mode, std::size_t node, bool& mapped );
+    static void unmap_chunk( Chunk* chunk );
+
+    Cache* cache();
+    void* take_any();
+    void* take_near( Chunk* chunk );
+    void give( void* slot );
+
+    void* take( Chunk* chunk );
+    void* bump();
+    void release( Chunk* chunk );
+    void link_free( Chunk* chunk );
+    void unlink_free( Chunk* chunk );
+
+private:
+    const std::size_t m_slot_size;
+    const std::size_t m_header_size;
+
+    Chunk* m_chunks;
+    Chunk* m_free_chunks;
+    std::size_t m_chunk_no;
+    std::size_t m_huge_chunk_no;
+
+    PageMode m_page_mode;
+    std::size_t m_numa_node;
+
+    // Unused part of the newest chunk.
+    Chunk* m_current;
+    char* m_next;
+    char* m_end;
+
+    // Index of the thread caches of this arena, or NO_CACHE, and the
+    // number of slots a cache takes or returns at a time.
+    std::size_t m_cache_index;
+    const std::size_t m_batch;
+
+    mutable std::mutex m_mutex;
+
+    static const std::size_t NO_CACHE = ~std::size_t( 0 );
+};
+
+#endif
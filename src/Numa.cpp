@@ -0,0 +1,100 @@
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include "Numa.hpp"
+
+namespace
+{
+
+//
+// NUMA node of every CPU, from the "cpulist" files of the nodes,
+// e.g. "0-7,16-23".
+//
+struct Topology
+{
+    Topology()
+    {
+        for( std::size_t node = 0; ; node++ )
+        {
+            std::ifstream in( "/sys/devices/system/node/node" + std::to_string( node ) + "/cpulist" );
+            std::string list;
+            if( !std::getline( in, list ) )
+            {
+                break;
+            }
+            m_node_no = node + 1;
+
+            std::size_t pos = 0;
+            while( pos < list.size() )
+            {
+                std::size_t end = list.find( ',', pos );
+                if( end == std::string::npos )
+                {
+                    end = list.size();
+                }
+                const std::string range = list.substr( pos, end - pos );
+                const std::size_t dash = range.find( '-' );
+                const std::size_t first = std::stoul( range.substr( 0, dash ) );
+                const std::size_t last = ( dash == std::string::npos ) ? first : std::stoul( range.substr( dash + 1 ) );
+                if( m_node_of_cpu.size() <= last )
+                {
+                    m_node_of_cpu.resize( last + 1, 0 );
+                }
+                for( std::size_t cpu = first; cpu <= last; cpu++ )
+                {
+                    m_node_of_cpu[ cpu ] = node;
+                }
+                pos = end + 1;
+            }
+        }
+    }
+
+    std::size_t m_node_no = 1;
+    std::vector< std::size_t > m_node_of_cpu;
+};
+
+const Topology& topology()
+{
+    static const Topology t;
+    return t;
+}
+
+}
+
+//
+//
+//
+std::size_t Numa::node_no()
+{
+    return topology().m_node_no;
+}
+
+//
+// sched_getcpu() is served by the vDSO, so this costs no system call.
+//
+std::size_t Numa::current_node()
+{
+    const Topology& t = topology();
+    const int cpu = sched_getcpu();
+    if( cpu < 0 || static_cast< std::size_t >( cpu ) >= t.m_node_of_cpu.size() )
+    {
+        return 0;
+    }
+    return t.m_node_of_cpu[ static_cast< std::size_t >( cpu ) ];
+}
+
+//
+// MPOL_PREFERRED falls back to other nodes when "node" runs out of
+// memory instead of failing the allocation.
+//
+bool Numa::bind( void* memory, std::size_t bytes, std::size_t node )
+{
+    const std::size_t bits = 8 * sizeof( unsigned long );
+    std::vector< unsigned long > mask( node / bits + 1, 0 );
+    mask[ node / bits ] |= 1UL << ( node % bits );
+    return !syscall( SYS_mbind, memory, bytes, MPOL_PREFERRED, mask.data(), mask.size() * bits, 0 );
+}
@@ -0,0 +1,25 @@
+#ifndef ROMZ_AMITTAI_BTREE_NUMA_H
+#define ROMZ_AMITTAI_BTREE_NUMA_H
+
+#include <cstddef>
+
+//
+// NUMA topology of the machine, read from sysfs once, and memory
+// placement through the mbind system call, so that no NUMA library is
+// needed. A machine without NUMA support has a single node 0.
+//
+class Numa
+{
+public:
+    /// Number of NUMA nodes.
+    static std::size_t node_no();
+
+    /// NUMA node of the CPU the calling thread runs on.
+    static std::size_t current_node();
+
+    /// Ask the kernel to place the pages of [memory, memory + bytes),
+    /// not touched yet, on "node". Returns false if the kernel refuses.
+    static bool bind( void* memory, std::size_t bytes, std::size_t node );
+};
+
+#endif
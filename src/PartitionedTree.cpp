@@ -0,0 +1,555 @@
+#include <algorithm>
+#include <limits>
+#include <pthread.h>
+#include <stdexcept>
+#include "BPlusTree.hpp"
+#include "PartitionedTree.hpp"
+#include "Record.hpp"
+
+const std::size_t PartitionedTree::SLOT_NO;
+
+//
+// A tree covering the keys [m_lo, m_hi]. The range changes only while
+// the partition is locked exclusively. A merged partition is retired:
+// it covers no key until a split reuses it.
+//
+class PartitionedTree::Partition
+{
+public:
+    Partition( std::size_t order, std::int64_t lo, std::int64_t hi )
+        : m_tree( order )
+        , m_lo{ lo }
+        , m_hi{ hi }
+        , m_retired{ false }
+        , m_ops{ 0 }
+    {
+        pthread_rwlock_init( &m_lock, nullptr );
+    }
+
+    ~Partition() { pthread_rwlock_destroy( &m_lock ); }
+
+    bool covers( std::int64_t key ) const { return !m_retired && m_lo <= key && key <= m_hi; }
+
+public:
+    BPlusTree m_tree;
+    mutable pthread_rwlock_t m_lock;
+    std::int64_t m_lo;
+    std::int64_t m_hi;
+    bool m_retired;
+
+    // Operations since the last rebalance().
+    mutable std::atomic< std::uint64_t > m_ops;
+};
+
+//
+// Lower bounds and partitions, in key order.
+//
+class PartitionedTree::Table
+{
+public:
+    std::size_t find( std::int64_t key ) const
+    {
+        return static_cast< std::size_t >( std::upper_bound( m_lo.begin(), m_lo.end(), key ) - m_lo.begin() ) - 1;
+    }
+
+public:
+    std::vector< std::int64_t > m_lo;
+    std::vector< Partition* > m_partitions;
+};
+
+//
+// Unlocks a partition returned by acquire().
+//
+class PartitionedTree::Guard
+{
+public:
+    explicit Guard( Partition* partition ) : m_partition( partition ) {}
+    ~Guard() { pthread_rwlock_unlock( &m_partition->m_lock ); }
+
+    Guard( const Guard& ) = delete;
+    Guard& operator=( const Guard& ) = delete;
+
+    Partition* operator->() const { return m_partition; }
+
+private:
+    Partition* m_partition;
+};
+
+//
+// Holds the current routing table in a slot, so that it is not freed
+// while the thread routes with it.
+//
+class PartitionedTree::Reader
+{
+public:
+    explicit Reader( const PartitionedTree& tree );
+    ~Reader() { m_slot->m_table.store( nullptr, std::memory_order_release ); }
+
+    Reader( const Reader& ) = delete;
+    Reader& operator=( const Reader& ) = delete;
+
+    const Table* operator->() const { return m_table; }
+
+private:
+    static std::size_t home_slot();
+
+private:
+    Slot* m_slot;
+    const Table* m_table;
+};
+
+//
+// Once the slot holds the table, the table is checked to be still the
+// current one: a table replaced before that may have been freed already.
+//
+PartitionedTree::Reader::Reader( const PartitionedTree& tree )
+    : m_slot{ nullptr }
+    , m_table{ tree.m_table.load() }
+{
+    for( std::size_t i = home_slot(); ; i = ( i + 1 ) % SLOT_NO )
+    {
+        const Table* empty = nullptr;
+        if( tree.m_slots[ i ].m_table.compare_exchange_strong( empty, m_table ) )
+        {
+            m_slot = &tree.m_slots[ i ];
+            break;
+        }
+    }
+
+    while( true )
+    {
+        const Table* current = tree.m_table.load();
+        if( current == m_table )
+        {
+            return;
+        }
+        m_table = current;
+        m_slot->m_table.store( m_table );
+    }
+}
+
+//
+// Threads take the slots in turn, in the order of their first use.
+//
+std::size_t PartitionedTree::Reader::home_slot()
+{
+    static std::atomic< std::size_t > next{ 0 };
+    thread_local const std::size_t index = next.fetch_add( 1, std::memory_order_relaxed ) % SLOT_NO;
+    return index;
+}
+
+//
+//
+//
+PartitionedTree::PartitionedTree( std::size_t order, const std::vector< KeyType >& split_keys )
+    : m_order{ order }
+    , m_table{ nullptr }
+{
+    Table* table = new Table();
+    m_tables.emplace_back( table );
+
+    std::int64_t lo = std::numeric_limits< std::int64_t >::min();
+    for( std::size_t i = 0; i <= split_keys.size(); i++ )
+    {
+        const std::int64_t next = ( i < split_keys.size() ) ? split_keys[ i ].to_int64() : std::numeric_limits< std::int64_t >::max();
+        if( i < split_keys.size() && next <= lo )
+        {
+            throw std::runtime_error( "Split keys must be ascending" );
+        }
+
+        const std::int64_t hi = ( i < split_keys.size() ) ? next - 1 : next;
+        m_partitions.emplace_back( new Partition( order, lo, hi ) );
+        table->m_lo.push_back( lo );
+        table->m_partitions.push_back( m_partitions.back().get() );
+        lo = next;
+    }
+
+    m_table.store( table, std::memory_order_release );
+}
+
+//
+// The split keys are spread evenly over the span of [lo, hi], computed
+// without overflow.
+//
+PartitionedTree::PartitionedTree( std::size_t order, std::size_t partition_no, std::int64_t lo, std::int64_t hi )
+    : PartitionedTree( order, [ partition_no, lo, hi ]()
+    {
+        if( !partition_no || hi < lo )
+        {
+            throw std::runtime_error( "Invalid partitioning" );
+        }
+
+        const std::uint64_t span = static_cast< std::uint64_t >( hi ) - static_cast< std::uint64_t >( lo );
+        std::vector< KeyType > split_keys;
+        for( std::size_t i = 1; i < partition_no; i++ )
+        {
+            const std::uint64_t offset = span / partition_no * i + span % partition_no * i / partition_no;
+            const std::int64_t key = static_cast< std::int64_t >( static_cast< std::uint64_t >( lo ) + offset + 1 );
+            if( split_keys.empty() || split_keys.back() < key )
+            {
+                split_keys.push_back( key );
+            }
+        }
+        return split_keys;
+    }() )
+{
+
+}
+
+//
+//
+//
+PartitionedTree::~PartitionedTree()
+{
+
+}
+
+//
+//
+//
+std::size_t PartitionedTree::partition_no() const
+{
+    Reader table( *this );
+    return table->m_partitions.size();
+}
+
+//
+//
+//
+std::size_t PartitionedTree::partition_of( const KeyType& key ) const
+{
+    Reader table( *this );
+    return table->find( key.to_int64() );
+}
+
+//
+//
+//
+std::vector< KeyType > PartitionedTree::bounds() const
+{
+    Reader table( *this );
+    return std::vector< KeyType >( table->m_lo.begin(), table->m_lo.end() );
+}
+
+//
+// The partitions do not change meanwhile, but the keys in them may.
+//
+std::vector< std::size_t > PartitionedTree::sizes() const
+{
+    std::lock_guard< std::mutex > lock( m_repartition );
+    const Table* table = m_table.load();
+    std::vector< std::size_t > result;
+    for( Partition* partition : table->m_partitions )
+    {
+        pthread_rwlock_rdlock( &partition->m_lock );
+        Guard guard( partition );
+        result.push_back( partition->m_tree.size() );
+    }
+    return result;
+}
+
+//
+//
+//
+std::size_t PartitionedTree::size() const
+{
+    const std::vector< std::size_t > s = sizes();
+    std::size_t total = 0;
+    for( auto n : s )
+    {
+        total += n;
+    }
+    return total;
+}
+
+//
+//
+//
+void PartitionedTree::insert( const KeyType& key, ValueType value )
+{
+    Guard partition( acquire( key.to_int64(), true ) );
+    partition->m_tree.insert( key, value );
+}
+
+//
+//
+//
+bool PartitionedTree::insert_or_assign( const KeyType& key, ValueType value )
+{
+    Guard partition( acquire( key.to_int64(), true ) );
+    return partition->m_tree.insert_or_assign( key, value );
+}
+
+//
+//
+//
+bool PartitionedTree::find( const KeyType& key, ValueType& value ) const
+{
+    Guard partition( acquire( key.to_int64(), false ) );
+    const Record* record = partition->m_tree.search( key );
+    if( !record )
+    {
+        return false;
+    }
+    value = record->value();
+    return true;
+}
+
+//
+//
+//
+void PartitionedTree::remove( const KeyType& key )
+{
+    Guard partition( acquire( key.to_int64(), true ) );
+    partition->m_tree.remove( key );
+}
+
+//
+// Partition by partition, each from the first key not yet visited up
+// to the end of its range.
+//
+std::size_t PartitionedTree::scan( const KeyType& lo, const KeyType& hi, const std::function< void( const KeyType&, ValueType ) >& fn ) const
+{
+    if( hi < lo )
+    {
+        return 0;
+    }
+
+    std::size_t count = 0;
+    std::int64_t from = lo.to_int64();
+    while( true )
+    {
+        Guard partition( acquire( from, false ) );
+        const std::int64_t to = std::min( hi.to_int64(), partition->m_hi );
+        count += partition->m_tree.scan( from, to, [ &fn ]( const KeyType& key, const Record* record ){ fn( key, record->value() ); } );
+        if( to == hi.to_int64() )
+        {
+            return count;
+        }
+        from = to + 1;
+    }
+}
+
+//
+//
+//
+bool PartitionedTree::split( std::size_t index )
+{
+    std::lock_guard< std::mutex > lock( m_repartition );
+    return split_locked( index );
+}
+
+//
+//
+//
+void PartitionedTree::merge( std::size_t index )
+{
+    std::lock_guard< std::mutex > lock( m_repartition );
+    merge_locked( index );
+}
+
+//
+// The counters are read and reset one by one, so operations running
+// meanwhile may count towards either call.
+//
+bool PartitionedTree::rebalance( double factor )
+{
+    std::lock_guard< std::mutex > lock( m_repartition );
+
+    const Table* table = m_table.load();
+    const std::size_t n = table->m_partitions.size();
+    std::vector< std::uint64_t > ops( n );
+    std::uint64_t total = 0;
+    for( std::size_t i = 0; i < n; i++ )
+    {
+        ops[ i ] = table->m_partitions[ i ]->m_ops.exchange( 0, std::memory_order_relaxed );
+        total += ops[ i ];
+    }
+
+    std::size_t hot = static_cast< std::size_t >( std::max_element( ops.begin(), ops.end() ) - ops.begin() );
+    if( !total || static_cast< double >( ops[ hot ] ) * static_cast< double >( n ) <= factor * static_cast< double >( total ) )
+    {
+        return false;
+    }
+
+    if( !split_locked( hot ) )
+    {
+        return false;
+    }
+
+    // The coldest pair of neighbors, not including either half of the
+    // split partition.
+    std::size_t cold = n;
+    for( std::size_t i = 0; i + 1 < n; i++ )
+    {
+        if( i + 1 == hot || i == hot )
+        {
+            continue;
+        }
+        if( cold == n || ops[ i ] + ops[ i + 1 ] < ops[ cold ] + ops[ cold + 1 ] )
+        {
+            cold = i;
+        }
+    }
+    if( cold != n )
+    {
+        // Indices after the split partition have moved up by one.
+        merge_locked( cold < hot ? cold : cold + 1 );
+    }
+    return true;
+}
+
+//
+// Lock the partition covering "key", following a newer routing table if
+// the partition found changed before it was locked. Partitions are never
+// freed before the tree, so the table is needed only to find it.
+//
+PartitionedTree::Partition* PartitionedTree::acquire( std::int64_t key, bool exclusive ) const
+{
+    while( true )
+    {
+        Partition* partition = nullptr;
+        {
+            Reader table( *this );
+            partition = table->m_partitions[ table->find( key ) ];
+        }
+        if( exclusive )
+        {
+            pthread_rwlock_wrlock( &partition->m_lock );
+        }
+        else
+        {
+            pthread_rwlock_rdlock( &partition->m_lock );
+        }
+
+        if( partition->covers( key ) )
+        {
+            partition->m_ops.fetch_add( 1, std::memory_order_relaxed );
+            return partition;
+        }
+        pthread_rwlock_unlock( &partition->m_lock );
+    }
+}
+
+//
+// The caller holds m_repartition and the locks of the partitions whose
+// ranges changed, so a thread that finds its key gone after taking such
+// a lock sees "table" when it looks again.
+//
+void PartitionedTree::publish( Table* table )
+{
+    m_tables.emplace_back( table );
+    m_table.store( table );
+    reclaim();
+}
+
+//
+// Free the old tables no slot holds. A thread that puts one of them in
+// its slot after this looked finds it replaced and does not use it.
+//
+void PartitionedTree::reclaim()
+{
+    std::vector< const Table* > held;
+    for( const Slot& slot : m_slots )
+    {
+        const Table* table = slot.m_table.load();
+        if( table )
+        {
+            held.push_back( table );
+        }
+    }
+
+    const Table* current = m_table.load();
+    m_tables.erase( std::remove_if( m_tables.begin(), m_tables.end(), [ current, &held ]( const std::unique_ptr< Table >& table )
+    {
+        return table.get() != current && std::find( held.begin(), held.end(), table.get() ) == held.end();
+    } ), m_tables.end() );
+}
+
+//
+// A retired partition with an empty tree, reused if there is one.
+//
+PartitionedTree::Partition* PartitionedTree::take_spare()
+{
+    if( m_spares.empty() )
+    {
+        m_partitions.emplace_back( new Partition( m_order, 0, 0 ) );
+        m_partitions.back()->m_retired = true;
+        return m_partitions.back().get();
+    }
+
+    Partition* spare = m_spares.back();
+    m_spares.pop_back();
+    return spare;
+}
+
+//
+//
+//
+bool PartitionedTree::split_locked( std::size_t index )
+{
+    const Table* table = m_table.load();
+    if( index >= table->m_partitions.size() )
+    {
+        throw std::runtime_error( "No such partition" );
+    }
+
+    Partition* left = table->m_partitions[ index ];
+    pthread_rwlock_wrlock( &left->m_lock );
+    Guard guard( left );
+
+    const std::size_t key_no = left->m_tree.size();
+    if( key_no < 2 )
+    {
+        return false;
+    }
+
+    // A thread may still lock a reused spare through an old table; it
+    // finds the range changed only once the keys have moved.
+    const std::int64_t median = left->m_tree.select( key_no / 2 ).first.to_int64();
+    Partition* right = take_spare();
+    pthread_rwlock_wrlock( &right->m_lock );
+    Guard right_guard( right );
+    left->m_tree.split_at( median, right->m_tree );
+    right->m_lo = median;
+    right->m_hi = left->m_hi;
+    right->m_retired = false;
+    right->m_ops.store( 0, std::memory_order_relaxed );
+    left->m_hi = median - 1;
+
+    Table* next = new Table( *table );
+    next->m_lo.insert( next->m_lo.begin() + static_cast< std::ptrdiff_t >( index ) + 1, median );
+    next->m_partitions.insert( next->m_partitions.begin() + static_cast< std::ptrdiff_t >( index ) + 1, right );
+    publish( next );
+    return true;
+}
+
+//
+// Only split_locked() and merge_locked() hold two partition locks, both
+// under m_repartition, so their order does not matter.
+//
+void PartitionedTree::merge_locked( std::size_t index )
+{
+    const Table* table = m_table.load();
+    if( index + 1 >= table->m_partitions.size() )
+    {
+        throw std::runtime_error( "No such partition" );
+    }
+
+    Partition* left = table->m_partitions[ index ];
+    Partition* right = table->m_partitions[ index + 1 ];
+    pthread_rwlock_wrlock( &left->m_lock );
+    Guard left_guard( left );
+    pthread_rwlock_wrlock( &right->m_lock );
+    Guard right_guard( right );
+
+    left->m_tree.join( right->m_tree );
+    left->m_hi = right->m_hi;
+    right->m_retired = true;
+    m_spares.push_back( right );
+
+    Table* next = new Table( *table );
+    next->m_lo.erase( next->m_lo.begin() + static_cast< std::ptrdiff_t >( index ) + 1 );
+    next->m_partitions.erase( next->m_partitions.begin() + static_cast< std::ptrdiff_t >( index ) + 1 );
+    publish( next );
+}
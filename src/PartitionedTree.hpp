@@ -0,0 +1,140 @@
+#ifndef ROMZ_AMITTAI_BTREE_PARTITIONEDTREE_H
+#define ROMZ_AMITTAI_BTREE_PARTITIONEDTREE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Definitions.hpp"
+#include "KeyType.h"
+
+//
+// Key space sharded over independent B+ trees, for writers that scale
+// with the number of cores.
+//
+// Every partition covers a range of keys and has a tree and a
+// readers-writer lock of its own, so threads working on different
+// partitions share no lock; a thread that owns a partition inserts
+// without contention. The lower bounds of the partitions form a small
+// routing table, which is immutable and replaced as a whole when
+// partitions are split or merged, so routing takes no lock either.
+// An operation that reaches a partition no longer covering its key,
+// because a concurrent split() or merge() moved the key, retries with
+// the new table.
+//
+// A thread announces the table it routes with in a slot of its own, and
+// an old table is freed once no slot holds it. Merged partitions are
+// kept as spares and reused by later splits, so a thread never locks
+// freed memory; the memory held stays bounded by the largest number of
+// partitions and of threads routing at the same time.
+//
+class PartitionedTree
+{
+public:
+    /// One partition more than "split_keys", which must be ascending:
+    /// partition "i" holds the keys from split_keys[ i - 1 ] up to, but
+    /// not including, split_keys[ i ].
+    PartitionedTree( std::size_t order, const std::vector< KeyType >& split_keys );
+
+    /// "partition_no" partitions of equal width over [lo, hi]; smaller
+    /// and greater keys go to the first and to the last partition.
+    PartitionedTree( std::size_t order, std::size_t partition_no, std::int64_t lo, std::int64_t hi );
+    ~PartitionedTree();
+
+    PartitionedTree( const PartitionedTree& ) = delete;
+    PartitionedTree& operator=( const PartitionedTree& ) = delete;
+
+    std::size_t partition_no() const;
+
+    /// The partition holding "key".
+    std::size_t partition_of( const KeyType& key ) const;
+
+    /// Lower bounds of the partitions; the first is the smallest key.
+    std::vector< KeyType > bounds() const;
+
+    /// Number of keys in each partition.
+    std::vector< std::size_t > sizes() const;
+
+    /// Number of keys in all partitions.
+    std::size_t size() const;
+
+    /// As BPlusTree::insert(); throws on an existing key.
+    void insert( const KeyType& key, ValueType value );
+
+    /// As BPlusTree::insert_or_assign().
+    bool insert_or_assign( const KeyType& key, ValueType value );
+
+    /// Copy the value of "key" to "value"; returns false if the key is
+    /// not present.
+    bool find( const KeyType& key, ValueType& value ) const;
+
+    void remove( const KeyType& key );
+
+    /// Call "fn" for every key in [lo, hi] and its value, in key order
+    /// across the partitions. Each partition is scanned under its lock,
+    /// one after the other, so the scan is not a snapshot of the whole
+    /// tree. Returns the number of keys visited.
+    std::size_t scan( const KeyType& lo, const KeyType& hi, const std::function< void( const KeyType&, ValueType ) >& fn ) const;
+
+    /// Split partition "index" at its median key, while operations on
+    /// other partitions go on. Returns false if it holds fewer than two
+    /// keys.
+    bool split( std::size_t index );
+
+    /// Merge partition "index" with the next one.
+    void merge( std::size_t index );
+
+    /// If the partition with the most operations since the last call had
+    /// more than "factor" times the average, split it, and merge the two
+    /// adjacent partitions with the fewest operations to keep the number
+    /// of partitions. Returns true if the partitions changed.
+    bool rebalance( double factor = 2.0 );
+
+public:
+    /// Number of threads that can route at the same time without waiting.
+    static const std::size_t SLOT_NO = 64;
+
+private:
+    class Partition;
+    class Table;
+    class Guard;
+    class Reader;
+
+    // The table a thread routes with; padded to a cache line, so that
+    // threads do not write to each other's lines.
+    struct Slot
+    {
+        std::atomic< const Table* > m_table{ nullptr };
+        char m_padding[ 64 - sizeof( std::atomic< const Table* > ) ];
+    };
+
+    Partition* acquire( std::int64_t key, bool exclusive ) const;
+    void publish( Table* table );
+    void reclaim();
+    Partition* take_spare();
+    bool split_locked( std::size_t index );
+    void merge_locked( std::size_t index );
+
+private:
+    const std::size_t m_order;
+
+    // The current routing table.
+    std::atomic< const Table* > m_table;
+
+    // The current table and the old ones still held by a slot.
+    std::vector< std::unique_ptr< Table > > m_tables;
+
+    // Every partition, current or spare, and the spares.
+    std::vector< std::unique_ptr< Partition > > m_partitions;
+    std::vector< Partition* > m_spares;
+
+    mutable Slot m_slots[ SLOT_NO ];
+
+    // Serializes split(), merge(), rebalance() and sizes(), and guards
+    // the three vectors above.
+    mutable std::mutex m_repartition;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include <cassert>
+#include "Path.hpp"
+
+const std::size_t Path::MAX_DEPTH;
+
+//
+//
+//
+Path::Path()
+    : m_size{ 0 }
+{
+
+}
+
+//
+//
+//
+void Path::push( InternalNode* node, std::size_t index )
+{
+    assert( m_size < MAX_DEPTH );
+    m_step[ m_size ].m_node = node;
+    m_step[ m_size ].m_index = index;
+    m_size++;
+}
+
+//
+//
+//
+void Path::pop()
+{
+    assert( m_size );
+    m_size--;
+}
+
+//
+//
+//
+void Path::clear()
+{
+    m_size = 0;
+}
+
+//
+//
+//
+bool Path::empty() const
+{
+    return !m_size;
+}
+
+//
+//
+//
+std::size_t Path::size() const
+{
+    return m_size;
+}
+
+//
+//
+//
+InternalNode* Path::parent() const
+{
+    assert( m_size );
+    return m_step[ m_size - 1 ].m_node;
+}
+
+//
+//
+//
+std::size_t Path::index() const
+{
+    assert( m_size );
+    return m_step[ m_size - 1 ].m_index;
+}
+
+//
+//
+//
+InternalNode* Path::node_at( std::size_t level ) const
+{
+    assert( level < m_size );
+    return m_step[ level ].m_node;
+}
+
+//
+//
+//
+std::size_t Path::index_at( std::size_t level ) const
+{
+    assert( level < m_size );
+    return m_step[ level ].m_index;
+}
@@ -0,0 +1,52 @@
+#ifndef ROMZ_AMITTAI_BTREE_PATH_H
+#define ROMZ_AMITTAI_BTREE_PATH_H
+
+#include <array>
+#include <cstddef>
+
+class InternalNode;
+
+//
+// Internal nodes passed by a descent from the root, each together with the
+// index of the child taken. Nodes keep no parent pointers: operations that
+// work their way back up (splits, merges, summary refreshes) pop this stack.
+//
+class Path
+{
+public:
+    Path();
+    ~Path() = default;
+
+    void push( InternalNode* node, std::size_t index );
+    void pop();
+    void clear();
+
+    bool empty() const;
+    std::size_t size() const;
+
+    /// The deepest node on the path, i.e. the parent of the node reached.
+    InternalNode* parent() const;
+
+    /// Index of the node reached within parent().
+    std::size_t index() const;
+
+    InternalNode* node_at( std::size_t level ) const;
+    std::size_t index_at( std::size_t level ) const;
+
+public:
+    // Every internal node but the root has at least two children,
+    // so no tree is deeper than this.
+    static const std::size_t MAX_DEPTH = 64;
+
+private:
+    struct Step
+    {
+        InternalNode* m_node;
+        std::size_t m_index;
+    };
+
+    std::array< Step, MAX_DEPTH > m_step;
+    std::size_t m_size;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include <array>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "PerfCounters.hpp"
+
+namespace
+{
+
+struct EventSpec
+{
+    std::uint32_t m_type;
+    std::uint64_t m_config;
+};
+
+const std::uint64_t READ_MISS = ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+
+const EventSpec SPECS[ PerfCounters::EVENT_NO ] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | READ_MISS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | READ_MISS },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+int open_event( const EventSpec& spec, int group_fd )
+{
+    perf_event_attr attr;
+    std::memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = spec.m_type;
+    attr.config = spec.m_config;
+    attr.disabled = ( group_fd == -1 ) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast< int >( syscall( SYS_perf_event_open, &attr, 0, -1, group_fd, 0 ) );
+}
+
+}
+
+//
+// The first event that opens leads the group.
+//
+PerfCounters::PerfCounters()
+    : m_leader{ -1 }
+    , m_open_no{ 0 }
+{
+    m_fd.fill( -1 );
+    m_slot.fill( -1 );
+
+    for( std::size_t i = 0; i < EVENT_NO; i++ )
+    {
+        const int fd = open_event( SPECS[ i ], m_leader );
+        if( fd < 0 )
+        {
+            continue;
+        }
+        if( m_leader < 0 )
+        {
+            m_leader = fd;
+        }
+        m_fd[ i ] = fd;
+        m_slot[ i ] = static_cast< int >( m_open_no++ );
+    }
+}
+
+//
+//
+//
+PerfCounters::~PerfCounters()
+{
+    for( int fd : m_fd )
+    {
+        if( fd >= 0 )
+        {
+            close( fd );
+        }
+    }
+}
+
+//
+//
+//
+bool PerfCounters::available() const
+{
+    return m_leader >= 0;
+}
+
+//
+//
+//
+bool PerfCounters::available( Event event ) const
+{
+    return m_fd[ event ] >= 0;
+}
+
+//
+//
+//
+void PerfCounters::start()
+{
+    if( available() )
+    {
+        ioctl( m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+    }
+}
+
+//
+//
+//
+void PerfCounters::stop()
+{
+    if( available() )
+    {
+        ioctl( m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+    }
+}
+
+//
+//
+//
+void PerfCounters::reset()
+{
+    if( available() )
+    {
+        ioctl( m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+    }
+}
+
+//
+// Layout of a group read: the number of events, the times enabled and
+// running, then one value per event in the order they were opened.
+//
+PerfCounters::Values PerfCounters::read() const
+{
+    Values values;
+    values.fill( 0 );
+    if( !available() )
+    {
+        return values;
+    }
+
+    // On the stack: the closing read of a PerfProfile::Scope must not
+    // count an allocation towards its region.
+    std::array< std::uint64_t, 3 + EVENT_NO > buffer;
+    const std::size_t size = ( 3 + m_open_no ) * sizeof( std::uint64_t );
+    if( ::read( m_leader, buffer.data(), size ) != static_cast< ssize_t >( size ) )
+    {
+        return values;
+    }
+
+    const std::uint64_t enabled = buffer[ 1 ];
+    const std::uint64_t running = buffer[ 2 ];
+    if( !running )
+    {
+        return values;
+    }
+
+    for( std::size_t i = 0; i < EVENT_NO; i++ )
+    {
+        if( m_slot[ i ] < 0 )
+        {
+            continue;
+        }
+        const std::uint64_t raw = buffer[ 3 + static_cast< std::size_t >( m_slot[ i ] ) ];
+        values[ i ] = ( running < enabled )
+            ? static_cast< std::uint64_t >( static_cast< double >( raw ) * static_cast< double >( enabled ) / static_cast< double >( running ) )
+            : raw;
+    }
+    return values;
+}
+
+//
+//
+//
+const char* PerfCounters::name( Event event )
+{
+    static const char* const names[ EVENT_NO ] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses", "task_clock", "page_faults" };
+    return names[ event ];
+}
@@ -0,0 +1,69 @@
+#ifndef ROMZ_AMITTAI_BTREE_PERFCOUNTERS_H
+#define ROMZ_AMITTAI_BTREE_PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+
+//
+// Hardware and software event counters of the calling thread, read
+// through perf_event_open(2).
+//
+// Only user-space events of the own thread are counted, which the
+// default perf_event_paranoid setting of 2 allows without root. Events
+// the kernel or the CPU does not offer are skipped: in a virtual machine
+// without a PMU only the software events remain, and where perf events
+// are blocked altogether none is available and all values stay zero.
+//
+// The events form one group, so they are counted over the same
+// intervals. If the group had to share the PMU with other groups, the
+// values are scaled up to the whole time it was enabled.
+//
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        DTLB_MISSES,
+        TASK_CLOCK,
+        PAGE_FAULTS,
+        EVENT_NO
+    };
+
+    using Values = std::array< std::uint64_t, EVENT_NO >;
+
+public:
+    /// Open the counters, stopped.
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters( const PerfCounters& ) = delete;
+    PerfCounters& operator=( const PerfCounters& ) = delete;
+
+    bool available() const;
+    bool available( Event event ) const;
+
+    void start();
+    void stop();
+    void reset();
+
+    /// Counts accumulated while started since the last reset.
+    Values read() const;
+
+    /// Event name, e.g. "llc_misses"; TASK_CLOCK counts nanoseconds.
+    static const char* name( Event event );
+
+private:
+    int m_leader;
+    std::array< int, EVENT_NO > m_fd;
+
+    // Position of every open event in a group read.
+    std::array< int, EVENT_NO > m_slot;
+    std::size_t m_open_no;
+};
+
+#endif
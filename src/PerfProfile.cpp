@@ -0,0 +1,96 @@
+#include "PerfProfile.hpp"
+
+namespace
+{
+
+//
+//
+//
+class ThreadProfile
+{
+public:
+    ThreadProfile()
+    {
+        m_depth.fill( 0 );
+        m_counters.start();
+    }
+
+    PerfCounters m_counters;
+    std::array< PerfProfile::Totals, PerfProfile::REGION_NO > m_totals;
+    std::array< unsigned, PerfProfile::REGION_NO > m_depth;
+};
+
+ThreadProfile& thread_profile()
+{
+    thread_local ThreadProfile profile;
+    return profile;
+}
+
+}
+
+//
+//
+//
+PerfProfile::Scope::Scope( Region region )
+    : m_region{ region }
+    , m_outermost{ thread_profile().m_depth[ region ]++ == 0 }
+{
+    if( m_outermost )
+    {
+        m_start = thread_profile().m_counters.read();
+    }
+}
+
+//
+//
+//
+PerfProfile::Scope::~Scope()
+{
+    ThreadProfile& profile = thread_profile();
+    profile.m_depth[ m_region ]--;
+    if( !m_outermost )
+    {
+        return;
+    }
+
+    const PerfCounters::Values end = profile.m_counters.read();
+    Totals& totals = profile.m_totals[ m_region ];
+    totals.m_calls++;
+    for( std::size_t i = 0; i < PerfCounters::EVENT_NO; i++ )
+    {
+        totals.m_values[ i ] += end[ i ] - m_start[ i ];
+    }
+}
+
+//
+//
+//
+PerfProfile::Totals PerfProfile::totals( Region region )
+{
+    return thread_profile().m_totals[ region ];
+}
+
+//
+//
+//
+void PerfProfile::reset()
+{
+    thread_profile().m_totals.fill( Totals() );
+}
+
+//
+//
+//
+const PerfCounters& PerfProfile::counters()
+{
+    return thread_profile().m_counters;
+}
+
+//
+//
+//
+const char* PerfProfile::name( Region region )
+{
+    static const char* const names[ REGION_NO ] = { "find_leaf", "leaf_lookup", "split", "merge" };
+    return names[ region ];
+}
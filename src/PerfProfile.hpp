@@ -0,0 +1,76 @@
+#ifndef ROMZ_AMITTAI_BTREE_PERFPROFILE_H
+#define ROMZ_AMITTAI_BTREE_PERFPROFILE_H
+
+#include <array>
+#include <cstdint>
+#include "PerfCounters.hpp"
+
+//
+// Event counts of the hot paths of the tree, per thread.
+//
+// The tree marks its regions only when built with BTREE_PERF defined
+// (the CMake option of the same name); otherwise the hook below expands
+// to nothing. Every thread counts with its own PerfCounters, opened on
+// its first marked region. A region entered again from within itself,
+// as merges cascading up the tree are, is counted once.
+//
+// Each region costs two reads of the counters, i.e. two system calls.
+// Kernel time is not counted, but the caches and TLB feel them, so the
+// counts are meant for comparing node sizes and layouts rather than as
+// absolute costs.
+//
+class PerfProfile
+{
+public:
+    enum Region
+    {
+        FIND_LEAF,
+        LEAF_LOOKUP,
+        SPLIT,
+        MERGE,
+        REGION_NO
+    };
+
+    class Totals
+    {
+    public:
+        std::uint64_t m_calls = 0;
+        PerfCounters::Values m_values{};
+    };
+
+    //
+    // Adds the events counted during its lifetime to its region.
+    //
+    class Scope
+    {
+    public:
+        explicit Scope( Region region );
+        ~Scope();
+
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+
+    private:
+        const Region m_region;
+        bool m_outermost;
+        PerfCounters::Values m_start;
+    };
+
+public:
+    /// Totals of the calling thread since its last reset().
+    static Totals totals( Region region );
+    static void reset();
+
+    /// Counters of the calling thread; tells which events are counted.
+    static const PerfCounters& counters();
+
+    static const char* name( Region region );
+};
+
+#ifdef BTREE_PERF
+#define BTREE_PERF_SCOPE( region ) const PerfProfile::Scope perf_scope( PerfProfile::region )
+#else
+#define BTREE_PERF_SCOPE( region ) ( void )0
+#endif
+
+#endif
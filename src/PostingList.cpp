@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cassert>
+#include "PostingList.hpp"
+
+const std::size_t PostingList::BLOCK_SIZE;
+
+//
+//
+//
+std::size_t PostingList::size() const
+{
+    return m_size;
+}
+
+//
+//
+//
+bool PostingList::empty() const
+{
+    return !m_size;
+}
+
+//
+//
+//
+ValueType PostingList::front() const
+{
+    assert( !empty() );
+    return m_blocks.empty() ? m_tail.front() : m_blocks.front().m_first;
+}
+
+//
+//
+//
+ValueType PostingList::back() const
+{
+    assert( !empty() );
+    return m_tail.empty() ? m_blocks.back().m_last : m_tail.back();
+}
+
+//
+//
+//
+ValueType PostingList::sum() const
+{
+    return static_cast< ValueType >( m_sum );
+}
+
+//
+//
+//
+void PostingList::insert( ValueType value )
+{
+    ++m_size;
+    m_sum += static_cast< std::uint64_t >( value );
+
+    // The tail holds every value not smaller than the last block's values.
+    if( m_blocks.empty() || !( value < m_blocks.back().m_last ) )
+    {
+        if( m_tail.empty() || !( value < m_tail.back() ) )
+        {
+            m_tail.push_back( value );
+        }
+        else
+        {
+            m_tail.insert( std::upper_bound( m_tail.begin(), m_tail.end(), value ), value );
+        }
+
+        if( m_tail.size() == BLOCK_SIZE )
+        {
+            seal_tail();
+        }
+        return;
+    }
+
+    const auto pred = []( ValueType v, const Block& b ){ return v < b.m_last; };
+    const auto it = std::upper_bound( m_blocks.begin(), m_blocks.end(), value, pred );
+    assert( it != m_blocks.end() );
+
+    std::vector< ValueType > values( it->m_count );
+    decode( *it, values.data() );
+    values.insert( std::upper_bound( values.begin(), values.end(), value ), value );
+
+    reencode( static_cast< std::size_t >( it - m_blocks.begin() ), values );
+}
+
+//
+//
+//
+bool PostingList::remove( ValueType value )
+{
+    if( !m_tail.empty() && !( value < m_tail.front() ) )
+    {
+        const auto it = std::lower_bound( m_tail.begin(), m_tail.end(), value );
+        if( it == m_tail.end() || *it != value )
+        {
+            return false;
+        }
+        m_tail.erase( it );
+        --m_size;
+        m_sum -= static_cast< std::uint64_t >( value );
+        return true;
+    }
+
+    const auto pred = []( const Block& b, ValueType v ){ return b.m_last < v; };
+    const auto it = std::lower_bound( m_blocks.begin(), m_blocks.end(), value, pred );
+    if( it == m_blocks.end() || value < it->m_first )
+    {
+        return false;
+    }
+
+    std::vector< ValueType > values( it->m_count );
+    decode( *it, values.data() );
+    const auto pos = std::lower_bound( values.begin(), values.end(), value );
+    if( pos == values.end() || *pos != value )
+    {
+        return false;
+    }
+    values.erase( pos );
+
+    reencode( static_cast< std::size_t >( it - m_blocks.begin() ), values );
+    --m_size;
+    m_sum -= static_cast< std::uint64_t >( value );
+    return true;
+}
+
+//
+//
+//
+std::size_t PostingList::bytes() const
+{
+    std::size_t total = m_blocks.capacity() * sizeof( Block ) + m_tail.capacity() * sizeof( ValueType );
+    for( const Block& block : m_blocks )
+    {
+        total += block.m_bits.capacity() * sizeof( std::uint64_t );
+    }
+    return total;
+}
+
+//
+//
+//
+void PostingList::seal_tail()
+{
+    m_blocks.push_back( encode( m_tail.data(), m_tail.size() ) );
+    m_tail.clear();
+}
+
+//
+// Replace block "index" by the encoding of "values", splitting it in two
+// if it has grown past BLOCK_SIZE and dropping it if it is empty.
+//
+void PostingList::reencode( std::size_t index, const std::vector< ValueType >& values )
+{
+    const auto it = m_blocks.begin() + static_cast< std::ptrdiff_t >( index );
+
+    if( values.empty() )
+    {
+        m_blocks.erase( it );
+    }
+    else if( values.size() <= BLOCK_SIZE )
+    {
+        *it = encode( values.data(), values.size() );
+    }
+    else
+    {
+        const std::size_t half = values.size() / 2;
+        *it = encode( values.data(), half );
+        m_blocks.insert( it + 1, encode( values.data() + half, values.size() - half ) );
+    }
+}
+
+//
+// Gaps are computed modulo 2^64, so any sorted sequence of signed values
+// encodes into gaps of at most 64 bits.
+//
+PostingList::Block PostingList::encode( const ValueType* values, std::size_t count )
+{
+    assert( count && count <= BLOCK_SIZE );
+
+    Block block;
+    block.m_first = values[ 0 ];
+    block.m_last = values[ count - 1 ];
+    block.m_count = static_cast< std::uint32_t >( count );
+
+    std::uint64_t max_gap = 0;
+    for( std::size_t i = 1; i < count; i++ )
+    {
+        max_gap = std::max( max_gap, static_cast< std::uint64_t >( values[ i ] ) - static_cast< std::uint64_t >( values[ i - 1 ] ) );
+    }
+
+    std::uint32_t width = 0;
+    while( width < 64 && ( max_gap >> width ) )
+    {
+        width++;
+    }
+    block.m_width = width;
+
+    if( !width )
+    {
+        return block;
+    }
+
+    // One extra word lets decode() read the next word unconditionally.
+    block.m_bits.assign( ( ( count - 1 ) * width + 63 ) / 64 + 1, 0 );
+    for( std::size_t i = 1; i < count; i++ )
+    {
+        const std::uint64_t gap = static_cast< std::uint64_t >( values[ i ] ) - static_cast< std::uint64_t >( values[ i - 1 ] );
+        const std::size_t pos = ( i - 1 ) * width;
+        const std::size_t word = pos / 64;
+        const std::size_t offset = pos % 64;
+
+        block.m_bits[ word ] |= gap << offset;
+        if( offset + width > 64 )
+        {
+            block.m_bits[ word + 1 ] |= gap >> ( 64 - offset );
+        }
+    }
+
+    return block;
+}
+
+//
+// The unpacking loop is branch-free with a fixed stride; the prefix sum
+// then restores the values. GCC vectorizes the loop only at -O3 with
+// AVX2 (-march=haswell), not at the -O2 of the default build.
+//
+void PostingList::decode( const Block& block, ValueType* out )
+{
+    const std::uint32_t count = block.m_count;
+    const std::uint32_t width = block.m_width;
+
+    if( !width )
+    {
+        std::fill( out, out + count, block.m_first );
+        return;
+    }
+
+    const std::uint64_t* bits = block.m_bits.data();
+    const std::uint64_t mask = ( width == 64 ) ? ~std::uint64_t( 0 ) : ( std::uint64_t( 1 ) << width ) - 1;
+
+    std::uint64_t gaps[ BLOCK_SIZE ];
+    for( std::uint32_t i = 1; i < count; i++ )
+    {
+        const std::size_t pos = std::size_t( i - 1 ) * width;
+        const std::size_t word = pos >> 6;
+        const std::size_t offset = pos & 63;
+        // Two shifts, so that an offset of 0 yields 0 instead of a 64-bit shift.
+        const std::uint64_t high = ( bits[ word + 1 ] << 1 ) << ( 63 - offset );
+        gaps[ i ] = ( ( bits[ word ] >> offset ) | high ) & mask;
+    }
+
+    std::uint64_t value = static_cast< std::uint64_t >( block.m_first );
+    out[ 0 ] = block.m_first;
+    for( std::uint32_t i = 1; i < count; i++ )
+    {
+        value += gaps[ i ];
+        out[ i ] = static_cast< ValueType >( value );
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef ROMZ_AMITTAI_BTREE_POSTINGLIST_H
+#define ROMZ_AMITTAI_BTREE_POSTINGLIST_H
+
+#include <cstdint>
+#include <vector>
+#include "Definitions.hpp"
+
+//
+// Sorted multiset of values stored under a single key.
+//
+// Values are kept in blocks of up to BLOCK_SIZE. A sealed block stores its
+// first value and the gaps to each predecessor, bit-packed with the width of
+// the largest gap. New values that are not smaller than the last one go to an
+// uncompressed tail, which is sealed into a block once it is full; only
+// out-of-order inserts and removals decode and re-encode a single block.
+//
+class PostingList
+{
+public:
+    PostingList() = default;
+    ~PostingList() = default;
+
+    std::size_t size() const;
+    bool empty() const;
+
+    ValueType front() const;
+    ValueType back() const;
+
+    /// Sum of all values, modulo 2^64.
+    ValueType sum() const;
+
+    /// Insert "value" after any equal values already present.
+    void insert( ValueType value );
+
+    /// Remove one occurrence of "value"; returns false if it is not present.
+    bool remove( ValueType value );
+
+    /// Call "f" for every value in ascending order.
+    template < typename F >
+    void for_each( F f ) const;
+
+    /// Bytes of heap memory held by the list.
+    std::size_t bytes() const;
+
+public:
+    static const std::size_t BLOCK_SIZE = 128;
+
+private:
+    struct Block
+    {
+        ValueType m_first;
+        ValueType m_last;
+        std::uint32_t m_count;
+        std::uint32_t m_width;
+        std::vector< std::uint64_t > m_bits;
+    };
+
+    static Block encode( const ValueType* values, std::size_t count );
+    static void decode( const Block& block, ValueType* out );
+
+    void seal_tail();
+    void reencode( std::size_t index, const std::vector< ValueType >& values );
+
+private:
+    std::vector< Block > m_blocks;
+
+    // Values following the last block, uncompressed and sorted.
+    std::vector< ValueType > m_tail;
+
+    std::size_t m_size = 0;
+
+    std::uint64_t m_sum = 0;
+};
+
+//
+//
+//
+template < typename F >
+void PostingList::for_each( F f ) const
+{
+    ValueType buffer[ BLOCK_SIZE ];
+    for( const Block& block : m_blocks )
+    {
+        decode( block, buffer );
+        for( std::uint32_t i = 0; i < block.m_count; i++ )
+        {
+            f( buffer[ i ] );
+        }
+    }
+
+    for( auto v : m_tail )
+    {
+        f( v );
+    }
+}
+
+#endif
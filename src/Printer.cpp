@@ -155,7 +155,12 @@ std::string Printer::to_string( const InternalNode* internal, bool verbose )
 std::string Printer::to_string( const Record& rec )
 {
     std::ostringstream oss;
-    oss << rec.value();
+    bool first = true;
+    rec.for_each( [ & ]( ValueType value )
+    {
+        oss << ( first ? "" : " " ) << value;
+        first = false;
+    } );
     return oss.str();
 }
 
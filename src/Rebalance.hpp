@@ -0,0 +1,43 @@
+#ifndef ROMZ_AMITTAI_BTREE_REBALANCE_H
+#define ROMZ_AMITTAI_BTREE_REBALANCE_H
+
+#include <cstdint>
+
+//
+// When a removal rebalances a node left with fewer entries than the
+// minimum of its kind.
+//
+enum class UnderflowPolicy
+{
+    // As soon as it drops below the minimum.
+    EAGER,
+
+    // Only once it drops below a lower threshold.
+    THRESHOLD,
+
+    // Only once it is empty; an internal node once it has a single child.
+    AT_EMPTY
+};
+
+//
+// Structural changes made by the tree since the counters were reset.
+//
+class RebalanceCounters
+{
+public:
+    // Nodes split in two by inserts, and nodes started by appends in
+    // append mode when the last node of a level is full.
+    std::uint64_t m_splits = 0;
+
+    // Pairs of nodes merged into one.
+    std::uint64_t m_merges = 0;
+
+    // Pairs of neighbors rebalanced by moving entries instead of merging
+    // them; the entries moved are counted in m_moved.
+    std::uint64_t m_redistributions = 0;
+
+    // Entries moved between nodes by all of the above.
+    std::uint64_t m_moved = 0;
+};
+
+#endif
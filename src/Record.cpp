@@ -1,14 +1,143 @@
+#include <algorithm>
 #include "Record.hpp"
 
+//
+//
+//
 Record::Record( ValueType value )
     : m_value( value )
 {
 
 }
 
+//
+//
+//
 ValueType Record::value() const
 {
     return m_value;
 }
 
+//
+//
+//
+std::size_t Record::size() const
+{
+    return 1 + ( m_more ? m_more->size() : 0 );
+}
+
+//
+//
+//
+std::vector< ValueType > Record::values() const
+{
+    std::vector< ValueType > v;
+    v.reserve( size() );
+    for_each( [ &v ]( ValueType x ){ v.push_back( x ); } );
+    return v;
+}
+
+//
+//
+//
+void Record::add( ValueType value )
+{
+    if( !m_more )
+    {
+        m_more.reset( new PostingList );
+    }
+
+    if( value < m_value )
+    {
+        m_more->insert( m_value );
+        m_value = value;
+    }
+    else
+    {
+        m_more->insert( value );
+    }
+}
+
+//
+//
+//
+void Record::set_value( ValueType value )
+{
+    m_value = value;
+    m_more.reset();
+}
+
+//
+//
+//
+void Record::transform( const std::function< ValueType( ValueType ) >& fn )
+{
+    if( !m_more )
+    {
+        m_value = fn( m_value );
+        return;
+    }
 
+    std::vector< ValueType > v = values();
+    for( auto& x : v )
+    {
+        x = fn( x );
+    }
+    std::sort( v.begin(), v.end() );
+
+    m_value = v.front();
+    m_more.reset( new PostingList );
+    for( auto it = v.begin() + 1; it != v.end(); ++it )
+    {
+        m_more->insert( *it );
+    }
+}
+
+//
+//
+//
+bool Record::remove( ValueType value )
+{
+    if( !m_more || m_more->empty() )
+    {
+        return false;
+    }
+
+    if( value == m_value )
+    {
+        m_value = m_more->front();
+        m_more->remove( m_value );
+    }
+    else if( !m_more->remove( value ) )
+    {
+        return false;
+    }
+
+    if( m_more->empty() )
+    {
+        m_more.reset();
+    }
+    return true;
+}
+
+//
+// m_value is the smallest value and the posting list holds the others.
+//
+Summary Record::summary() const
+{
+    if( !m_more )
+    {
+        return Summary( 1, m_value, m_value, m_value );
+    }
+
+    const ValueType sum = static_cast< ValueType >( static_cast< std::uint64_t >( m_value ) + static_cast< std::uint64_t >( m_more->sum() ) );
+    return Summary( size(), sum, m_value, m_more->back() );
+}
+
+//
+//
+//
+std::size_t Record::bytes() const
+{
+    return sizeof( Record ) + ( m_more ? sizeof( PostingList ) + m_more->bytes() : 0 );
+}
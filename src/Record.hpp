@@ -1,19 +1,74 @@
 #ifndef ROMZ_AMITTAI_BTREE_RECORD_H
 #define ROMZ_AMITTAI_BTREE_RECORD_H
 
+#include <functional>
+#include <memory>
+#include <vector>
 #include "Definitions.hpp"
+#include "PostingList.hpp"
+#include "Summary.hpp"
 
+//
+// Values stored under one key. A tree with unique keys keeps exactly one
+// value per record; a tree allowing duplicates keeps them here as a
+// compressed posting list sorted in ascending order.
+//
 class Record
 {
 public:
     explicit Record( ValueType value );
     ~Record() = default;
 
+    /// The smallest value of the record.
     ValueType value() const;
 
+    /// Number of values held by the record.
+    std::size_t size() const;
+
+    /// All values of the record in ascending order.
+    std::vector< ValueType > values() const;
+
+    /// Call "f" for every value in ascending order.
+    template < typename F >
+    void for_each( F f ) const;
+
+    void add( ValueType value );
+
+    /// Make "value" the only value of the record.
+    void set_value( ValueType value );
+
+    /// Replace every value "v" by "fn( v )", keeping the values sorted.
+    void transform( const std::function< ValueType( ValueType ) >& fn );
+
+    /// Remove one occurrence of "value".
+    /// Returns false if the record does not hold it. The last value of a
+    /// record cannot be removed; the record itself has to be dropped.
+    bool remove( ValueType value );
+
+    /// Summary of the values of the record, counted as one key.
+    Summary summary() const;
+
+    /// Bytes of heap memory held by the record, itself included.
+    std::size_t bytes() const;
+
 private:
     ValueType m_value;
+
+    // Values following m_value; allocated only once a second value arrives.
+    std::unique_ptr< PostingList > m_more;
 };
 
-#endif
+//
+//
+//
+template < typename F >
+void Record::for_each( F f ) const
+{
+    f( m_value );
+    if( m_more )
+    {
+        m_more->for_each( f );
+    }
+}
 
+#endif
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include "InternalNode.hpp"
+#include "LeafNode.hpp"
+#include "Numa.hpp"
+#include "Replicas.hpp"
+
+//
+// Header of a copy; the slot continues with "m_capacity" keys and then
+// "m_capacity" children. The first key is not used, as in InternalNode.
+//
+class ReplicaNode
+{
+public:
+    std::int64_t* keys() { return reinterpret_cast< std::int64_t* >( this + 1 ); }
+    const std::int64_t* keys() const { return reinterpret_cast< const std::int64_t* >( this + 1 ); }
+
+    const void** children() { return reinterpret_cast< const void** >( keys() + m_capacity ); }
+    const void* const* children() const { return reinterpret_cast< const void* const* >( keys() + m_capacity ); }
+
+public:
+    NodeArena* m_arena;
+    std::uint32_t m_capacity;
+    std::uint32_t m_size;
+    bool m_leaf_children;
+};
+
+//
+//
+//
+Replicas::Replicas( std::size_t replica_no, std::size_t capacity )
+    : m_capacity{ capacity }
+{
+    assert( replica_no > 0 );
+    static_assert( sizeof( ReplicaNode ) % sizeof( std::int64_t ) == 0, "keys follow the header" );
+
+    const std::size_t node_no = Numa::node_no();
+    for( std::size_t i = 0; i < replica_no; i++ )
+    {
+        m_arenas.emplace_back( new NodeArena( sizeof( ReplicaNode ) + capacity * ( sizeof( std::int64_t ) + sizeof( void* ) ) ) );
+        m_arenas.back()->set_numa_node( i % node_no );
+    }
+}
+
+//
+//
+//
+std::size_t Replicas::size() const
+{
+    return m_arenas.size();
+}
+
+//
+//
+//
+std::size_t Replicas::local() const
+{
+    return Numa::current_node() % m_arenas.size();
+}
+
+//
+// The search matches InternalNode::lookup(): the child left of the
+// first key greater than "key".
+//
+const LeafNode* Replicas::find_leaf( const Node* root, const KeyType& key, std::size_t replica ) const
+{
+    if( root->is_leaf() )
+    {
+        return root->leaf();
+    }
+
+    const std::int64_t k = key.to_int64();
+    const ReplicaNode* node = root->internal()->m_replicas[ replica ];
+    while( true )
+    {
+        const std::int64_t* keys = node->keys();
+        const std::int64_t* pos = std::upper_bound( keys + 1, keys + node->m_size, k );
+        const void* child = node->children()[ pos - keys - 1 ];
+        if( node->m_leaf_children )
+        {
+            return static_cast< const LeafNode* >( child );
+        }
+        node = static_cast< const ReplicaNode* >( child );
+    }
+}
+
+//
+//
+//
+void Replicas::update( Node* root, const KeyType& key )
+{
+    Node* node = root;
+    while( node && !node->is_leaf() )
+    {
+        InternalNode* internal = node->internal();
+        if( internal->m_stale || internal->m_replicas.empty() )
+        {
+            refresh( internal );
+        }
+        node = internal->lookup( key );
+    }
+}
+
+//
+//
+//
+void Replicas::update( Node* root )
+{
+    if( !root || root->is_leaf() )
+    {
+        return;
+    }
+
+    InternalNode* internal = root->internal();
+    if( internal->m_stale || internal->m_replicas.empty() )
+    {
+        copy( internal );
+    }
+    for( const auto& e : internal->m_elt )
+    {
+        update( e.m_node );
+    }
+}
+
+//
+//
+//
+bool Replicas::check( const Node* root ) const
+{
+    if( !root || root->is_leaf() )
+    {
+        return true;
+    }
+
+    const InternalNode* internal = root->internal();
+    if( internal->m_stale || internal->m_replicas.size() != m_arenas.size() )
+    {
+        return false;
+    }
+
+    for( std::size_t r = 0; r < m_arenas.size(); r++ )
+    {
+        const ReplicaNode* replica = internal->m_replicas[ r ];
+        if( replica->m_arena != m_arenas[ r ].get() || replica->m_size != internal->size() )
+        {
+            return false;
+        }
+        for( std::size_t i = 0; i < internal->size(); i++ )
+        {
+            const Node* child = internal->m_elt[ i ].m_node;
+            const void* expected = child->is_leaf() ? static_cast< const void* >( child->leaf() ) : static_cast< const void* >( child->internal()->m_replicas[ r ] );
+            if( replica->children()[ i ] != expected || replica->m_leaf_children != child->is_leaf() )
+            {
+                return false;
+            }
+            if( i && replica->keys()[ i ] != internal->m_elt[ i ].m_key.to_int64() )
+            {
+                return false;
+            }
+        }
+    }
+
+    for( const auto& e : internal->m_elt )
+    {
+        if( !check( e.m_node ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+//
+//
+std::size_t Replicas::bytes() const
+{
+    std::size_t total = 0;
+    for( const auto& arena : m_arenas )
+    {
+        total += arena->bytes();
+    }
+    return total;
+}
+
+//
+//
+//
+void Replicas::clear( Node* root )
+{
+    if( !root || root->is_leaf() )
+    {
+        return;
+    }
+
+    InternalNode* internal = root->internal();
+    release( internal->m_replicas );
+    for( const auto& e : internal->m_elt )
+    {
+        clear( e.m_node );
+    }
+}
+
+//
+//
+//
+void Replicas::release( std::vector< ReplicaNode* >& copies )
+{
+    for( ReplicaNode* replica : copies )
+    {
+        replica->m_arena->deallocate( replica );
+    }
+    copies.clear();
+}
+
+//
+// Copy "node" into every replica, first making copies of any children
+// that have none yet, e.g. the nodes of a subtree just built.
+//
+void Replicas::copy( InternalNode* node )
+{
+    if( node->size() > m_capacity )
+    {
+        throw std::runtime_error( "Node too large for its replicas" );
+    }
+
+    if( node->m_replicas.empty() )
+    {
+        for( const auto& arena : m_arenas )
+        {
+            ReplicaNode* replica = static_cast< ReplicaNode* >( arena->allocate() );
+            replica->m_arena = arena.get();
+            replica->m_capacity = static_cast< std::uint32_t >( m_capacity );
+            node->m_replicas.push_back( replica );
+        }
+    }
+    assert( node->m_replicas.size() == m_arenas.size() );
+
+    const bool leaf_children = node->size() && node->first_child()->is_leaf();
+    if( !leaf_children )
+    {
+        for( const auto& e : node->m_elt )
+        {
+            if( e.m_node->internal()->m_replicas.empty() )
+            {
+                copy( e.m_node->internal() );
+            }
+        }
+    }
+
+    for( std::size_t r = 0; r < m_arenas.size(); r++ )
+    {
+        ReplicaNode* replica = node->m_replicas[ r ];
+        replica->m_size = static_cast< std::uint32_t >( node->size() );
+        replica->m_leaf_children = leaf_children;
+
+        std::int64_t* keys = replica->keys();
+        const void** children = replica->children();
+        for( std::size_t i = 0; i < node->size(); i++ )
+        {
+            const InternalElt& e = node->m_elt[ i ];
+            keys[ i ] = e.m_key.to_int64();
+            children[ i ] = leaf_children ? static_cast< const void* >( e.m_node->leaf() ) : static_cast< const void* >( e.m_node->internal()->m_replicas[ r ] );
+        }
+    }
+    node->m_stale = false;
+}
+
+//
+// Copy "node" after its stale descendants. Off the path of a change a
+// node only changes together with its parent, so the stale nodes below
+// "node" hang from it in stale chains.
+//
+void Replicas::refresh( InternalNode* node )
+{
+    for( const auto& e : node->m_elt )
+    {
+        if( e.m_node->is_leaf() )
+        {
+            break;
+        }
+        InternalNode* child = e.m_node->internal();
+        if( child->m_stale || child->m_replicas.empty() )
+        {
+            refresh( child );
+        }
+    }
+    copy( node );
+}
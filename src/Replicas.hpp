@@ -0,0 +1,79 @@
+#ifndef ROMZ_AMITTAI_BTREE_REPLICAS_H
+#define ROMZ_AMITTAI_BTREE_REPLICAS_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "KeyType.h"
+#include "NodeArena.hpp"
+
+class InternalNode;
+class LeafNode;
+class Node;
+class ReplicaNode;
+
+//
+// Copies of the internal levels of a tree, one per NUMA node, so that a
+// descent reads only memory local to the socket it runs on.
+//
+// A copy holds the keys and children of an internal node in two packed
+// arrays, in a slot of an arena bound to the NUMA node of its replica.
+// The children of a copy are the copies of the node's children in the
+// same replica; on the lowest internal level they are the leaves, which
+// all replicas share. Every internal node lists its copies and is marked
+// stale by any change of its keys or children. After a change the tree
+// calls update(), which rewrites the copies of stale nodes in place and
+// makes copies of new nodes. Copies are freed together with their node.
+//
+class Replicas
+{
+public:
+    /// "replica_no" replicas of internal nodes with up to "capacity"
+    /// children; replica "i" lives on NUMA node "i" modulo the node count.
+    Replicas( std::size_t replica_no, std::size_t capacity );
+    ~Replicas() = default;
+
+    Replicas( const Replicas& ) = delete;
+    Replicas& operator=( const Replicas& ) = delete;
+
+    std::size_t size() const;
+
+    /// The replica for threads on the NUMA node of the calling thread.
+    std::size_t local() const;
+
+    /// The leaf covering "key", reached through replica "replica".
+    const LeafNode* find_leaf( const Node* root, const KeyType& key, std::size_t replica ) const;
+
+    /// Bring the copies up to date after a change confined to the path
+    /// of "key" and the neighbors of the nodes on it, as made by a single
+    /// insert or remove. A node that changes together with a neighbor
+    /// always changes their parent as well, so only the children of
+    /// stale nodes are visited.
+    void update( Node* root, const KeyType& key );
+
+    /// Bring every copy up to date.
+    void update( Node* root );
+
+    /// True if the copies of every internal node match it.
+    bool check( const Node* root ) const;
+
+    /// Bytes reserved for copies.
+    std::size_t bytes() const;
+
+    /// Free the copies of all internal nodes under "root", before the
+    /// nodes move to another tree.
+    static void clear( Node* root );
+
+    /// Free the copies of a node.
+    static void release( std::vector< ReplicaNode* >& copies );
+
+private:
+    void copy( InternalNode* node );
+    void refresh( InternalNode* node );
+
+private:
+    const std::size_t m_capacity;
+    std::vector< std::unique_ptr< NodeArena > > m_arenas;
+};
+
+#endif
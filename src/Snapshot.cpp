@@ -0,0 +1,472 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include "Snapshot.hpp"
+#include "BulkLoader.hpp"
+#include "InternalNode.hpp"
+#include "LeafNode.hpp"
+
+const std::uint32_t Snapshot::VERSION;
+const std::uint32_t Snapshot::FLAG_COMPRESSED;
+const std::uint32_t Snapshot::FLAG_DUPLICATES;
+const std::uint32_t Snapshot::BLOCK_ENTRIES;
+
+namespace
+{
+
+const char MAGIC[ 4 ] = { 'A', 'B', 'T', 'S' };
+const std::size_t HEADER_SIZE = 40;
+const std::size_t BLOCK_HEADER_SIZE = 12;
+const std::size_t MAX_VARINT_SIZE = 10;
+
+// Blocks are cut early once long posting lists make them this large.
+const std::size_t MAX_BLOCK_SIZE = 1 << 26;
+
+//
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320).
+//
+std::uint32_t crc32( const std::uint8_t* data, std::size_t size )
+{
+    static const std::vector< std::uint32_t > table = []()
+    {
+        std::vector< std::uint32_t > t( 256 );
+        for( std::uint32_t i = 0; i < 256; i++ )
+        {
+            std::uint32_t c = i;
+            for( int k = 0; k < 8; k++ )
+            {
+                c = ( c & 1 ) ? ( 0xEDB88320u ^ ( c >> 1 ) ) : ( c >> 1 );
+            }
+            t[ i ] = c;
+        }
+        return t;
+    }();
+
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for( std::size_t i = 0; i < size; i++ )
+    {
+        crc = table[ ( crc ^ data[ i ] ) & 0xFF ] ^ ( crc >> 8 );
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+//
+//
+//
+void put_u32( std::vector< std::uint8_t >& buf, std::uint32_t v )
+{
+    for( int i = 0; i < 4; i++ )
+    {
+        buf.push_back( static_cast< std::uint8_t >( v >> ( 8 * i ) ) );
+    }
+}
+
+//
+//
+//
+void put_u64( std::vector< std::uint8_t >& buf, std::uint64_t v )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        buf.push_back( static_cast< std::uint8_t >( v >> ( 8 * i ) ) );
+    }
+}
+
+//
+//
+//
+std::uint32_t get_u32( const std::uint8_t* p )
+{
+    std::uint32_t v = 0;
+    for( int i = 0; i < 4; i++ )
+    {
+        v |= static_cast< std::uint32_t >( p[ i ] ) << ( 8 * i );
+    }
+    return v;
+}
+
+//
+//
+//
+std::uint64_t get_u64( const std::uint8_t* p )
+{
+    std::uint64_t v = 0;
+    for( int i = 0; i < 8; i++ )
+    {
+        v |= static_cast< std::uint64_t >( p[ i ] ) << ( 8 * i );
+    }
+    return v;
+}
+
+//
+//
+//
+void put_varint( std::vector< std::uint8_t >& buf, std::uint64_t v )
+{
+    while( v >= 0x80 )
+    {
+        buf.push_back( static_cast< std::uint8_t >( v | 0x80 ) );
+        v >>= 7;
+    }
+    buf.push_back( static_cast< std::uint8_t >( v ) );
+}
+
+//
+//
+//
+std::uint64_t get_varint( const std::uint8_t*& p, const std::uint8_t* end )
+{
+    std::uint64_t v = 0;
+    for( int shift = 0; shift < 64; shift += 7 )
+    {
+        if( p == end )
+        {
+            break;
+        }
+        const std::uint8_t byte = *p++;
+        v |= static_cast< std::uint64_t >( byte & 0x7F ) << shift;
+        if( !( byte & 0x80 ) )
+        {
+            return v;
+        }
+    }
+    throw std::runtime_error( "Snapshot corrupted: bad varint" );
+}
+
+//
+//
+//
+std::uint64_t zigzag( std::int64_t v )
+{
+    return ( static_cast< std::uint64_t >( v ) << 1 ) ^ static_cast< std::uint64_t >( v >> 63 );
+}
+
+//
+//
+//
+std::int64_t unzigzag( std::uint64_t v )
+{
+    return static_cast< std::int64_t >( ( v >> 1 ) ^ ( ~( v & 1 ) + 1 ) );
+}
+
+//
+//
+//
+std::uint64_t get_u64( const std::uint8_t*& p, const std::uint8_t* end )
+{
+    if( end - p < 8 )
+    {
+        throw std::runtime_error( "Snapshot corrupted: short block" );
+    }
+    const std::uint64_t v = get_u64( p );
+    p += 8;
+    return v;
+}
+
+//
+//
+//
+void read_exactly( std::istream& in, std::uint8_t* data, std::size_t size )
+{
+    in.read( reinterpret_cast< char* >( data ), static_cast< std::streamsize >( size ) );
+    if( static_cast< std::size_t >( in.gcount() ) != size )
+    {
+        throw std::runtime_error( "Snapshot truncated" );
+    }
+}
+
+//
+//
+//
+const LeafNode* leftmost_leaf( const Node* node )
+{
+    if( !node )
+    {
+        return nullptr;
+    }
+
+    while( !node->is_leaf() )
+    {
+        node = node->internal()->first_child();
+    }
+    return node->leaf();
+}
+
+}
+
+//
+//
+//
+Snapshot::Snapshot( BPlusTree& tree )
+    : m_tree( tree )
+{
+
+}
+
+//
+//
+//
+void Snapshot::save( std::ostream& out, bool compress ) const
+{
+    const LeafNode* first = leftmost_leaf( m_tree.m_root );
+
+    std::uint64_t count = 0;
+    for( const LeafNode* leaf = first; leaf; leaf = leaf->next() )
+    {
+        count += leaf->size();
+    }
+
+    const bool duplicates = m_tree.allows_duplicates();
+
+    Buffer header( MAGIC, MAGIC + 4 );
+    put_u32( header, VERSION );
+    put_u32( header, ( compress ? FLAG_COMPRESSED : 0 ) | ( duplicates ? FLAG_DUPLICATES : 0 ) );
+    put_u32( header, BLOCK_ENTRIES );
+    put_u64( header, m_tree.m_order );
+    put_u64( header, count );
+    put_u32( header, crc32( header.data(), header.size() ) );
+    put_u32( header, 0 );
+    out.write( reinterpret_cast< const char* >( header.data() ), static_cast< std::streamsize >( header.size() ) );
+
+    Buffer payload;
+    payload.reserve( BLOCK_ENTRIES * 2 * ( compress ? MAX_VARINT_SIZE : 8 ) );
+    std::uint32_t entry_no = 0;
+    std::uint64_t prev_key = 0;
+
+    for( const LeafNode* leaf = first; leaf; leaf = leaf->next() )
+    {
+        for( const LeafElt& e : leaf->m_elt )
+        {
+            const std::uint64_t key = static_cast< std::uint64_t >( e.m_key.to_int64() );
+
+            if( compress )
+            {
+                put_varint( payload, entry_no ? key - prev_key : zigzag( e.m_key.to_int64() ) );
+            }
+            else
+            {
+                put_u64( payload, key );
+            }
+
+            if( duplicates )
+            {
+                encode_values( payload, key, *e.m_record, compress );
+            }
+            else
+            {
+                const std::uint64_t value = static_cast< std::uint64_t >( e.m_record->value() );
+                if( compress )
+                {
+                    put_varint( payload, zigzag( static_cast< std::int64_t >( value - key ) ) );
+                }
+                else
+                {
+                    put_u64( payload, value );
+                }
+            }
+            prev_key = key;
+
+            if( ++entry_no == BLOCK_ENTRIES || payload.size() >= MAX_BLOCK_SIZE )
+            {
+                write_block( out, payload, entry_no );
+                payload.clear();
+                entry_no = 0;
+            }
+        }
+    }
+
+    if( entry_no )
+    {
+        write_block( out, payload, entry_no );
+    }
+
+    if( !out )
+    {
+        throw std::runtime_error( "Snapshot write failed" );
+    }
+}
+
+//
+//
+//
+void Snapshot::write_block( std::ostream& out, const Buffer& payload, std::uint32_t entry_no ) const
+{
+    if( payload.size() > UINT32_MAX )
+    {
+        throw std::runtime_error( "Snapshot block too large" );
+    }
+
+    Buffer header;
+    put_u32( header, entry_no );
+    put_u32( header, static_cast< std::uint32_t >( payload.size() ) );
+    put_u32( header, crc32( payload.data(), payload.size() ) );
+
+    out.write( reinterpret_cast< const char* >( header.data() ), static_cast< std::streamsize >( header.size() ) );
+    out.write( reinterpret_cast< const char* >( payload.data() ), static_cast< std::streamsize >( payload.size() ) );
+}
+
+//
+//
+//
+void Snapshot::encode_values( Buffer& payload, std::uint64_t key, const Record& record, bool compress )
+{
+    if( compress )
+    {
+        put_varint( payload, record.size() );
+    }
+    else
+    {
+        put_u64( payload, record.size() );
+    }
+
+    bool first = true;
+    std::uint64_t prev = key;
+    record.for_each( [ & ]( ValueType v )
+    {
+        const std::uint64_t value = static_cast< std::uint64_t >( v );
+        if( !compress )
+        {
+            put_u64( payload, value );
+        }
+        else if( first )
+        {
+            put_varint( payload, zigzag( static_cast< std::int64_t >( value - key ) ) );
+        }
+        else
+        {
+            put_varint( payload, value - prev );
+        }
+        first = false;
+        prev = value;
+    } );
+}
+
+//
+//
+//
+Record* Snapshot::decode_values( const std::uint8_t*& p, const std::uint8_t* end, std::uint64_t key, bool compress )
+{
+    const std::uint64_t count = compress ? get_varint( p, end ) : get_u64( p, end );
+    if( !count || count > static_cast< std::uint64_t >( end - p ) )
+    {
+        throw std::runtime_error( "Snapshot corrupted: bad value count" );
+    }
+
+    std::uint64_t value = compress
+        ? key + static_cast< std::uint64_t >( unzigzag( get_varint( p, end ) ) )
+        : get_u64( p, end );
+    std::unique_ptr< Record > record( new Record( static_cast< ValueType >( value ) ) );
+
+    for( std::uint64_t i = 1; i < count; i++ )
+    {
+        const std::uint64_t next = compress ? value + get_varint( p, end ) : get_u64( p, end );
+        if( static_cast< ValueType >( next ) < static_cast< ValueType >( value ) )
+        {
+            throw std::runtime_error( "Snapshot corrupted: values not sorted" );
+        }
+        value = next;
+        record->add( static_cast< ValueType >( value ) );
+    }
+
+    return record.release();
+}
+
+//
+//
+//
+void Snapshot::load( std::istream& in )
+{
+    std::uint8_t header[ HEADER_SIZE ];
+    read_exactly( in, header, HEADER_SIZE );
+
+    if( std::memcmp( header, MAGIC, sizeof( MAGIC ) ) != 0 )
+    {
+        throw std::runtime_error( "Not a B+ tree snapshot" );
+    }
+    if( get_u32( header + 32 ) != crc32( header, 32 ) )
+    {
+        throw std::runtime_error( "Snapshot corrupted: header checksum mismatch" );
+    }
+
+    const std::uint32_t version = get_u32( header + 4 );
+    const std::uint32_t flags = get_u32( header + 8 );
+    if( version > VERSION || ( flags & ~( FLAG_COMPRESSED | FLAG_DUPLICATES ) ) )
+    {
+        throw std::runtime_error( "Unsupported snapshot version" );
+    }
+
+    const bool compress = ( flags & FLAG_COMPRESSED );
+    const bool duplicates = ( flags & FLAG_DUPLICATES );
+    if( duplicates && !m_tree.allows_duplicates() )
+    {
+        throw std::runtime_error( "Snapshot holds duplicate keys" );
+    }
+
+    // Entries of a tree with duplicates have no fixed upper size.
+    const std::size_t max_entry_size = duplicates ? UINT32_MAX : ( compress ? 2 * MAX_VARINT_SIZE : 16 );
+    std::uint64_t remaining = get_u64( header + 24 );
+
+    BulkLoader loader( m_tree );
+    Buffer payload;
+    std::uint64_t prev_key = 0;
+
+    while( remaining )
+    {
+        std::uint8_t block_header[ BLOCK_HEADER_SIZE ];
+        read_exactly( in, block_header, BLOCK_HEADER_SIZE );
+
+        const std::uint32_t entry_no = get_u32( block_header );
+        const std::uint32_t size = get_u32( block_header + 4 );
+        if( !entry_no || entry_no > remaining || size > std::min< std::uint64_t >( UINT32_MAX, std::uint64_t( entry_no ) * max_entry_size ) )
+        {
+            throw std::runtime_error( "Snapshot corrupted: bad block header" );
+        }
+
+        payload.resize( size );
+        read_exactly( in, payload.data(), size );
+        if( get_u32( block_header + 8 ) != crc32( payload.data(), size ) )
+        {
+            throw std::runtime_error( "Snapshot corrupted: block checksum mismatch" );
+        }
+
+        const std::uint8_t* p = payload.data();
+        const std::uint8_t* end = p + size;
+        for( std::uint32_t i = 0; i < entry_no; i++ )
+        {
+            std::uint64_t key;
+            if( compress )
+            {
+                const std::uint64_t k = get_varint( p, end );
+                key = i ? prev_key + k : static_cast< std::uint64_t >( unzigzag( k ) );
+            }
+            else
+            {
+                key = get_u64( p, end );
+            }
+            prev_key = key;
+
+            Record* record;
+            if( duplicates )
+            {
+                record = decode_values( p, end, key, compress );
+            }
+            else
+            {
+                const std::uint64_t value = compress
+                    ? key + static_cast< std::uint64_t >( unzigzag( get_varint( p, end ) ) )
+                    : get_u64( p, end );
+                record = new Record( static_cast< ValueType >( value ) );
+            }
+
+            loader.append( KeyType( static_cast< std::int64_t >( key ) ), record );
+        }
+
+        if( p != end )
+        {
+            throw std::runtime_error( "Snapshot corrupted: trailing bytes in block" );
+        }
+        remaining -= entry_no;
+    }
+
+    loader.finish();
+}
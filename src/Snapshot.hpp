@@ -0,0 +1,63 @@
+#ifndef ROMZ_AMITTAI_BTREE_SNAPSHOT_H
+#define ROMZ_AMITTAI_BTREE_SNAPSHOT_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "BPlusTree.hpp"
+
+//
+// Binary checkpoint of a B+ tree.
+//
+// All integers are little-endian.
+//
+// Header (40 bytes):
+//    magic "ABTS", u32 version, u32 flags, u32 entries per block,
+//    u64 order, u64 entry count, u32 CRC-32 of the preceding 32 bytes,
+//    u32 reserved.
+//
+// Blocks, until "entry count" entries have been read:
+//    u32 entry count, u32 payload size, u32 CRC-32 of the payload, payload.
+//
+// Payload of a plain block: i64 key, i64 value for every entry.
+// Payload of a compressed block: the first key as a zigzag varint, then the
+// gap to the previous key as a varint; every value is stored as the zigzag
+// varint of its difference to its key.
+//
+// With FLAG_DUPLICATES (trees allowing duplicate keys) every key is followed
+// by the number of its values (u64, or varint when compressed) and then by
+// the values in ascending order. Compressed, the values after the first one
+// are stored as varint gaps to their predecessor.
+//
+class Snapshot
+{
+public:
+    explicit Snapshot( BPlusTree& tree );
+    ~Snapshot() = default;
+
+    /// Stream the leaves of the tree in key order to "out".
+    void save( std::ostream& out, bool compress = false ) const;
+
+    /// Rebuild the (empty) tree bottom-up from a checkpoint written by save().
+    void load( std::istream& in );
+
+public:
+    static const std::uint32_t VERSION = 1;
+    static const std::uint32_t FLAG_COMPRESSED = 1;
+    static const std::uint32_t FLAG_DUPLICATES = 2;
+    static const std::uint32_t BLOCK_ENTRIES = 4096;
+
+private:
+    using Buffer = std::vector< std::uint8_t >;
+
+    void write_block( std::ostream& out, const Buffer& payload, std::uint32_t entry_no ) const;
+    static void encode_values( Buffer& payload, std::uint64_t key, const Record& record, bool compress );
+    static Record* decode_values( const std::uint8_t*& p, const std::uint8_t* end, std::uint64_t key, bool compress );
+
+private:
+    BPlusTree& m_tree;
+};
+
+#endif
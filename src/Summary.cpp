@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <limits>
+#include "Summary.hpp"
+
+//
+//
+//
+Summary::Summary()
+    : m_count{ 0 }
+    , m_value_count{ 0 }
+    , m_sum{ 0 }
+    , m_min{ std::numeric_limits< ValueType >::max() }
+    , m_max{ std::numeric_limits< ValueType >::min() }
+{
+
+}
+
+//
+//
+//
+Summary::Summary( std::size_t value_no, ValueType sum, ValueType min, ValueType max )
+    : m_count{ 1 }
+    , m_value_count{ value_no }
+    , m_sum{ sum }
+    , m_min{ min }
+    , m_max{ max }
+{
+
+}
+
+//
+//
+//
+Summary Summary::of_value( ValueType value )
+{
+    Summary summary( 1, value, value, value );
+    summary.m_count = 0;
+    return summary;
+}
+
+//
+// The sum wraps around instead of overflowing.
+//
+void Summary::add( const Summary& other )
+{
+    m_count += other.m_count;
+    m_value_count += other.m_value_count;
+    m_sum = static_cast< ValueType >( static_cast< std::uint64_t >( m_sum ) + static_cast< std::uint64_t >( other.m_sum ) );
+    m_min = std::min( m_min, other.m_min );
+    m_max = std::max( m_max, other.m_max );
+}
+
+//
+//
+//
+bool Summary::empty() const
+{
+    return !m_count;
+}
+
+//
+//
+//
+bool Summary::remove( const Summary& other )
+{
+    if( !( m_min < other.m_min ) || !( other.m_max < m_max ) )
+    {
+        return false;
+    }
+
+    m_count -= other.m_count;
+    m_value_count -= other.m_value_count;
+    m_sum = static_cast< ValueType >( static_cast< std::uint64_t >( m_sum ) - static_cast< std::uint64_t >( other.m_sum ) );
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef ROMZ_AMITTAI_BTREE_SUMMARY_H
+#define ROMZ_AMITTAI_BTREE_SUMMARY_H
+
+#include <cstddef>
+#include "Definitions.hpp"
+
+//
+// Aggregate of the values stored under a set of keys.
+//
+// Summaries form a commutative monoid: the default constructed summary is
+// the identity and add() combines two of them. Every internal entry keeps
+// the summary of its subtree, so a range aggregate combines whole-subtree
+// summaries and scans only the two boundary leaves.
+//
+class Summary
+{
+public:
+    /// The summary of an empty set.
+    Summary();
+
+    /// The summary of a single key holding "value_no" values.
+    Summary( std::size_t value_no, ValueType sum, ValueType min, ValueType max );
+
+    /// The change caused by one more value under a key already present.
+    static Summary of_value( ValueType value );
+
+    void add( const Summary& other );
+
+    /// Take out a summary added before. Returns false, leaving this
+    /// summary unchanged, if "other" may hold its minimum or maximum,
+    /// which then have to be recomputed.
+    bool remove( const Summary& other );
+
+    bool empty() const;
+
+public:
+    // Number of keys.
+    std::size_t m_count;
+
+    // Number of values; differs from m_count in multimap mode only.
+    std::size_t m_value_count;
+
+    // Sum of the values, modulo 2^64.
+    ValueType m_sum;
+
+    ValueType m_min;
+    ValueType m_max;
+};
+
+#endif
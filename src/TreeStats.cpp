@@ -0,0 +1,78 @@
+#include <algorithm>
+#include "TreeStats.hpp"
+
+const std::size_t LevelStats::FILL_BUCKET_NO;
+
+//
+//
+//
+double LevelStats::fill() const
+{
+    if( !m_nodes || !m_capacity )
+    {
+        return 0.0;
+    }
+    return static_cast< double >( m_entries ) / static_cast< double >( m_nodes * m_capacity );
+}
+
+//
+//
+//
+void LevelStats::merge( const LevelStats& other )
+{
+    if( other.m_keys )
+    {
+        m_min_key = m_keys ? std::min( m_min_key, other.m_min_key ) : other.m_min_key;
+        m_max_key = m_keys ? std::max( m_max_key, other.m_max_key ) : other.m_max_key;
+    }
+    m_keys += other.m_keys;
+    m_nodes += other.m_nodes;
+    m_entries += other.m_entries;
+    m_capacity = std::max( m_capacity, other.m_capacity );
+    for( std::size_t i = 0; i < FILL_BUCKET_NO; i++ )
+    {
+        m_fill[ i ] += other.m_fill[ i ];
+    }
+}
+
+//
+//
+//
+std::size_t TreeStats::nodes() const
+{
+    std::size_t total = 0;
+    for( const auto& level : m_levels )
+    {
+        total += level.m_nodes;
+    }
+    return total;
+}
+
+//
+//
+//
+std::size_t TreeStats::bytes() const
+{
+    return m_node_bytes + m_entry_bytes + m_record_bytes;
+}
+
+//
+//
+//
+void TreeStats::merge( const TreeStats& other, std::size_t offset )
+{
+    if( m_levels.size() < offset + other.m_levels.size() )
+    {
+        m_levels.resize( offset + other.m_levels.size() );
+    }
+    for( std::size_t i = 0; i < other.m_levels.size(); i++ )
+    {
+        m_levels[ offset + i ].merge( other.m_levels[ i ] );
+    }
+
+    m_keys += other.m_keys;
+    m_values += other.m_values;
+    m_node_bytes += other.m_node_bytes;
+    m_entry_bytes += other.m_entry_bytes;
+    m_record_bytes += other.m_record_bytes;
+}
@@ -0,0 +1,71 @@
+#ifndef ROMZ_AMITTAI_BTREE_TREESTATS_H
+#define ROMZ_AMITTAI_BTREE_TREESTATS_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "KeyType.h"
+
+//
+// Nodes of one level of a tree.
+//
+class LevelStats
+{
+public:
+    /// Mean number of entries per node over the maximum, in [0, 1].
+    double fill() const;
+
+    void merge( const LevelStats& other );
+
+public:
+    static const std::size_t FILL_BUCKET_NO = 10;
+
+    std::size_t m_nodes = 0;
+    std::size_t m_entries = 0;
+
+    // Most entries a node of the level may hold.
+    std::size_t m_capacity = 0;
+
+    // Nodes by fill: bucket i counts the nodes holding at least i/10 and
+    // less than (i + 1)/10 of the maximum; the last one takes full nodes.
+    std::array< std::size_t, FILL_BUCKET_NO > m_fill{};
+
+    // Smallest and largest key stored at the level; the separators for
+    // internal levels. Meaningful only if m_keys is not zero.
+    std::size_t m_keys = 0;
+    KeyType m_min_key{ 0 };
+    KeyType m_max_key{ 0 };
+};
+
+//
+// Shape and memory use of a tree, as returned by BPlusTree::stats().
+//
+class TreeStats
+{
+public:
+    std::size_t nodes() const;
+
+    /// Sum of the node, entry and record bytes.
+    std::size_t bytes() const;
+
+    /// Add the counts of a subtree whose root is at level "offset".
+    void merge( const TreeStats& other, std::size_t offset );
+
+public:
+    // Root first, leaves last.
+    std::vector< LevelStats > m_levels;
+
+    std::size_t m_keys = 0;
+    std::size_t m_values = 0;
+
+    // The nodes themselves.
+    std::size_t m_node_bytes = 0;
+
+    // The entry arrays of the nodes, by capacity.
+    std::size_t m_entry_bytes = 0;
+
+    // The records and their posting lists.
+    std::size_t m_record_bytes = 0;
+};
+
+#endif
@@ -1,6 +1,11 @@
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include "io.h"
+#include "BulkLoader.hpp"
+#include "InputParser.hpp"
+#include "MappedFile.hpp"
+#include "Snapshot.hpp"
 #include "InternalNode.hpp"
 #include "LeafNode.hpp"
 #include "Node.hpp"
@@ -47,14 +52,47 @@ LeafNode* Io::find_leaf_node( const KeyType& key, bool printing, bool verbose )
 
 void Io::read_input_from_file( std::string file_name )
 {
-    std::size_t key;
-    std::ifstream input(file_name);
-    while (input) {
-        input >> key;
-        m_tree.insert(key, key);
+    const MappedFile file( file_name );
+    const std::vector< std::int64_t > keys = InputParser().parse( file.begin(), file.end() );
+
+    if( m_tree.is_empty() )
+    {
+        BulkLoader loader( m_tree );
+        for( auto key : keys )
+        {
+            loader.append( key, key );
+        }
+        loader.finish();
+    }
+    else
+    {
+        for( auto key : keys )
+        {
+            m_tree.insert( key, key );
+        }
     }
 }
 
+void Io::write_snapshot( std::string file_name, bool compress )
+{
+    std::ofstream output( file_name, std::ios::binary );
+    if( !output )
+    {
+        throw std::runtime_error( "Cannot open " + file_name );
+    }
+    Snapshot( m_tree ).save( output, compress );
+}
+
+void Io::read_snapshot( std::string file_name )
+{
+    std::ifstream input( file_name, std::ios::binary );
+    if( !input )
+    {
+        throw std::runtime_error( "Cannot open " + file_name );
+    }
+    Snapshot( m_tree ).load( input );
+}
+
 void Io::print( bool verbose )
 {
     m_printer.set_verbose(verbose);
@@ -94,7 +132,7 @@ void Io::print_value( const KeyType& key, bool print_path, bool verbose )
         std::cout << "\t";
     }
     std::cout << "Record found at location " << std::hex << record << std::dec << ":" << std::endl;
-    std::cout << "\tKey: " << key.to_int64() << "   Value: " << record->value() << std::endl;
+    std::cout << "\tKey: " << key.to_int64() << "   Value: " << Printer::to_string( *record ) << std::endl;
 }
 
 void Io::print_path_to( const KeyType& key, bool verbose )
@@ -139,7 +177,7 @@ void Io::leaf_node_copy_range_starting_from( LeafNode* leaf, const KeyType& key,
             found = true;
         }
         if (found) {
-            vector.push_back(std::make_tuple(mapping.m_key, mapping.m_record->value(), leaf));
+            copy_values( leaf, mapping, vector );
         }
     }
 }
@@ -149,7 +187,7 @@ void Io::leaf_node_copy_range_until( LeafNode* leaf, const KeyType& key, std::ve
     bool found = false;
     for (auto mapping : leaf->m_elt) {
         if (!found) {
-            vector.push_back(std::make_tuple(mapping.m_key, mapping.m_record->value(), leaf));
+            copy_values( leaf, mapping, vector );
         }
         if (mapping.m_key == key) {
             found = true;
@@ -160,7 +198,15 @@ void Io::leaf_node_copy_range_until( LeafNode* leaf, const KeyType& key, std::ve
 void Io::leaf_node_copy_range( LeafNode* leaf, std::vector< EntryType >& vector )
 {
     for (auto mapping : leaf->m_elt) {
-        vector.push_back(std::make_tuple(mapping.m_key, mapping.m_record->value(), leaf));
+        copy_values( leaf, mapping, vector );
     }
 }
 
+
+//
+// One entry per value, so that duplicate keys are all reported.
+//
+void Io::copy_values( LeafNode* leaf, const LeafElt& elt, std::vector< EntryType >& vector )
+{
+    elt.m_record->for_each( [ & ]( ValueType value ){ vector.push_back( std::make_tuple( elt.m_key, value, leaf ) ); } );
+}
@@ -40,8 +40,17 @@ public:
     /// Each new element should consist of a single integer on a line by itself.
     /// This B+ tree treats each such input as both a new value and the key
     /// under which to store it.
+    /// The file is memory mapped and parsed in parallel; repeated integers are
+    /// stored once. An empty tree is built bottom-up from the sorted keys.
     void read_input_from_file( std::string file_name );
 
+    /// Write a binary checkpoint of this B+ tree (see Snapshot).
+    /// @param[in] compress Determines whether blocks are delta-encoded.
+    void write_snapshot( std::string file_name, bool compress = false );
+
+    /// Rebuild this (empty) B+ tree bottom-up from a binary checkpoint.
+    void read_snapshot( std::string file_name );
+
 
 
 private:
@@ -56,6 +65,7 @@ private:
     void leaf_node_copy_range_starting_from( LeafNode* leaf, const KeyType& key, std::vector< EntryType >& vector );
     void leaf_node_copy_range_until( LeafNode* leaf, const KeyType& key, std::vector< EntryType >& vector );
     void leaf_node_copy_range( LeafNode* leaf, std::vector< EntryType >& vector );
+    void copy_values( LeafNode* leaf, const LeafElt& elt, std::vector< EntryType >& vector );
 
 
 
@@ -1,9 +1,78 @@
 #include "gtest/gtest.h"
 #include "BPlusTree.hpp"
+#include "Compactor.hpp"
+#include "EntryArenas.hpp"
+#include "Finger.hpp"
+#include "InternalNode.hpp"
+#include "io.h"
+#include "LeafNode.hpp"
+#include "Replicas.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <numeric>
 #include <random>
 #include <map>
+#include <set>
+#include <sstream>
+#include <thread>
 
 
+//
+// Insert and remove random keys in [0, key_no], checking every key
+// present after each step.
+//
+static void insert_remove_random( std::size_t order, unsigned seed, std::size_t iter_no, int key_no )
+{
+    std::map< KeyType, ValueType > smap;
+    BPlusTree tree( order );
+
+    std::mt19937 rng( seed );
+    std::uniform_int_distribution< int > dist_int( 0, key_no );
+
+    for( std::size_t i = 0; i < iter_no; i++ )
+    {
+        const KeyType key( dist_int( rng ) );
+        if( rng() % 2 )
+        {
+            if( smap.insert( std::make_pair( key, i ) ).second )
+            {
+                ASSERT_NO_THROW( tree.insert( key, i ) );
+            }
+        }
+        else
+        {
+            smap.erase( key );
+            tree.remove( key );
+        }
+
+        for( auto v : smap )
+        {
+            const Record* rec = tree.search( v.first );
+            ASSERT_TRUE( rec );
+            ASSERT_TRUE( rec->value() == v.second );
+        }
+    }
+}
+
+
+//
+// Number of nodes other than the root under their minimum size.
+//
+static std::size_t underfull_nodes( const BPlusTree& tree, const Node* node )
+{
+    if( node->is_leaf() )
+    {
+        return ( node != tree.m_root && node->size() < tree.leaf_min_size() ) ? 1 : 0;
+    }
+
+    std::size_t count = ( node != tree.m_root && node->size() < tree.internal_min_size() ) ? 1 : 0;
+    for( std::size_t i = 0; i < node->size(); i++ )
+    {
+        count += underfull_nodes( tree, node->internal()->neighbor( i ) );
+    }
+    return count;
+}
+
 
 TEST( btree, constuction )
 {
@@ -19,7 +88,7 @@ TEST( btree, search_empty )
 {
     const std::size_t order = 4;
     BPlusTree tree( order );
-    Record* rec = tree.search( 1 );
+    const Record* rec = tree.search( 1 );
     ASSERT_TRUE( !rec );
 }
 
@@ -32,7 +101,7 @@ TEST( btree, one_item )
     BPlusTree tree( order );
 
     ASSERT_NO_THROW( tree.insert( k, k ) );
-    Record* rec = tree.search( k );
+    const Record* rec = tree.search( k );
     ASSERT_TRUE( rec != nullptr );
     ASSERT_TRUE( rec->value() == k );
 
@@ -42,6 +111,88 @@ TEST( btree, one_item )
     ASSERT_TRUE( tree.is_empty() );
 }
 
+TEST( btree, negative_keys )
+{
+    // The first entry of an internal node holds DUMMY_KEY (-1); smaller
+    // keys must still be routed to the first child.
+    const std::size_t order = 4;
+    BPlusTree tree( order );
+
+    for( int64_t k = -50; k <= 50; k++ )
+    {
+        ASSERT_NO_THROW( tree.insert( k, k ) );
+    }
+
+    for( int64_t k = -50; k <= 50; k++ )
+    {
+        const Record* rec = tree.search( k );
+        ASSERT_TRUE( rec );
+        ASSERT_TRUE( rec->value() == k );
+    }
+}
+
+
+TEST( btree, leaf_chain )
+{
+    // Coalescing two leaves has to unlink the emptied one from the chain.
+    const std::size_t order = 4;
+    BPlusTree tree( order );
+    std::vector< int64_t > keys;
+
+    for( int64_t k = 0; k < 40; k++ )
+    {
+        ASSERT_NO_THROW( tree.insert( k, k ) );
+    }
+    for( int64_t k = 0; k < 40; k++ )
+    {
+        if( k % 4 )
+        {
+            tree.remove( k );
+        }
+        else
+        {
+            keys.push_back( k );
+        }
+    }
+
+    Io io( tree );
+    testing::internal::CaptureStdout();
+    io.print_leaves();
+    std::string leaves = testing::internal::GetCapturedStdout();
+    std::replace( leaves.begin(), leaves.end(), '|', ' ' );
+
+    std::istringstream in( leaves );
+    std::vector< int64_t > printed;
+    int64_t k;
+    while( in >> k )
+    {
+        printed.push_back( k );
+    }
+    ASSERT_TRUE( printed == keys );
+}
+
+
+TEST( btree, internal_redistribute )
+{
+    // Borrowing an entry from an internal neighbor rotates the separator
+    // through the parent instead of moving DUMMY_KEY around.
+    for( std::size_t order = 4; order <= 8; order++ )
+    {
+        insert_remove_random( order, order, 4000, 300 );
+    }
+}
+
+
+TEST( btree, order_three )
+{
+    // An internal node of order 3 must keep two children, or the single
+    // child has no neighbor to borrow from or to coalesce with.
+    for( unsigned seed = 0; seed < 20; seed++ )
+    {
+        insert_remove_random( 3, seed, 3000, 200 );
+    }
+}
+
 /*
 TEST( btree, more_items )
 {
@@ -56,7 +207,7 @@ TEST( btree, more_items )
 
     for( std::size_t i = 0; i < item_no; i++ )
     {
-        Record* rec = tree.search( i );
+        const Record* rec = tree.search( i );
         ASSERT_TRUE( rec );
         ASSERT_TRUE( rec->value() == KeyType( i ) );
     }
@@ -91,7 +242,7 @@ TEST( btree, reverse_erase )
 
     for( std::size_t i = 0; i < item_no; i++ )
     {
-        Record* rec = tree.search( i );
+        const Record* rec = tree.search( i );
         ASSERT_TRUE( rec );
         ASSERT_TRUE( rec->value() == ValueType( i ) );
     }
@@ -132,7 +283,7 @@ TEST( btree, insert_search_delete )
 
     for( auto v : smap )
     {
-        Record* rec = tree.search( v.first );
+        const Record* rec = tree.search( v.first );
         ASSERT_TRUE( rec );
         ASSERT_TRUE( rec->value() == v.second );
     }
@@ -194,7 +345,7 @@ TEST( btree, insert_random )
 
         for( auto v : smap )
         {
-            Record* rec = tree.search( v.first );
+            const Record* rec = tree.search( v.first );
             ASSERT_TRUE( rec );
             ASSERT_TRUE( rec->value() == v.second );
         }
@@ -233,7 +384,7 @@ TEST( btree, erase_random )
 
     for( auto v : smap )
     {
-        Record* rec = tree.search( v.first );
+        const Record* rec = tree.search( v.first );
         ASSERT_TRUE( rec );
         ASSERT_TRUE( rec->value() == v.second );
     }
@@ -249,3 +400,1357 @@ TEST( btree, erase_random )
 }
 
 
+
+TEST( btree, duplicates_rejected_by_default )
+{
+    BPlusTree tree( 4 );
+    ASSERT_FALSE( tree.allows_duplicates() );
+    tree.insert( 1, 1 );
+    ASSERT_ANY_THROW( tree.insert( 1, 2 ) );
+    ASSERT_TRUE( tree.search( 1 )->size() == 1 );
+}
+
+
+TEST( btree, multimap )
+{
+    std::multimap< std::int64_t, ValueType > smap;
+    BPlusTree tree( 5, true );
+    ASSERT_TRUE( tree.allows_duplicates() );
+
+    std::mt19937 rng;
+    std::uniform_int_distribution< int > dist_key( 0, 300 );
+    std::uniform_int_distribution< int > dist_value( 0, 20 );
+    std::uniform_real_distribution<> dist_real( 0, 1 );
+
+    for( std::size_t i = 0; i < 6000; i++ )
+    {
+        const std::int64_t key = dist_key( rng );
+        const ValueType value = dist_value( rng );
+
+        if( dist_real( rng ) > 0.4 )
+        {
+            smap.insert( std::make_pair( key, value ) );
+            ASSERT_NO_THROW( tree.insert( key, value ) );
+        }
+        else
+        {
+            auto range = smap.equal_range( key );
+            for( auto it = range.first; it != range.second; ++it )
+            {
+                if( it->second == value )
+                {
+                    smap.erase( it );
+                    break;
+                }
+            }
+            tree.remove( key, value );
+        }
+    }
+
+    for( std::int64_t key = 0; key <= 300; key++ )
+    {
+        std::vector< ValueType > expected;
+        auto range = smap.equal_range( key );
+        for( auto it = range.first; it != range.second; ++it )
+        {
+            expected.push_back( it->second );
+        }
+        std::sort( expected.begin(), expected.end() );
+
+        const Record* rec = tree.search( key );
+        if( expected.empty() )
+        {
+            ASSERT_TRUE( rec == nullptr );
+        }
+        else
+        {
+            ASSERT_TRUE( rec );
+            ASSERT_TRUE( rec->values() == expected );
+            ASSERT_TRUE( rec->value() == expected.front() );
+        }
+    }
+
+    for( std::int64_t key = 0; key <= 300; key++ )
+    {
+        tree.remove( key );
+    }
+    ASSERT_TRUE( tree.is_empty() );
+}
+
+
+TEST( btree, multimap_range )
+{
+    BPlusTree tree( 3, true );
+    Io io( tree );
+    for( std::int64_t key = 0; key < 20; key++ )
+    {
+        tree.insert( key, 100 + key );
+        tree.insert( key, key );
+    }
+
+    testing::internal::CaptureStdout();
+    io.print_range( 5, 14 );
+    const std::string output = testing::internal::GetCapturedStdout();
+
+    ASSERT_TRUE( std::count( output.begin(), output.end(), '\n' ) == 20 );
+    ASSERT_TRUE( output.find( "Key: 5    Value: 5 " ) < output.find( "Key: 5    Value: 105 " ) );
+    ASSERT_TRUE( output.find( "Key: 14    Value: 114 " ) != std::string::npos );
+}
+
+
+TEST( btree, try_insert_and_insert_or_assign )
+{
+    BPlusTree tree( 4 );
+    for( std::int64_t key = 0; key < 100; key++ )
+    {
+        const auto ret = tree.try_insert( key, key );
+        ASSERT_TRUE( ret.second );
+        ASSERT_TRUE( ret.first == tree.search( key ) );
+    }
+
+    for( std::int64_t key = 0; key < 100; key++ )
+    {
+        const auto ret = tree.try_insert( key, -1 );
+        ASSERT_FALSE( ret.second );
+        ASSERT_TRUE( ret.first->value() == key );
+
+        ASSERT_FALSE( tree.insert_or_assign( key, 2 * key ) );
+        ASSERT_TRUE( tree.search( key )->value() == 2 * key );
+    }
+
+    ASSERT_TRUE( tree.insert_or_assign( 100, 7 ) );
+    ASSERT_TRUE( tree.search( 100 )->value() == 7 );
+}
+
+
+TEST( btree, update_and_upsert )
+{
+    BPlusTree tree( 3 );
+    const auto increment = []( ValueType v ){ return v + 1; };
+
+    ASSERT_FALSE( tree.update( 5, increment ) );
+    for( int i = 0; i < 10; i++ )
+    {
+        for( std::int64_t key = 0; key < 50; key++ )
+        {
+            tree.upsert( key, 0, increment );
+        }
+    }
+    for( std::int64_t key = 0; key < 50; key++ )
+    {
+        ASSERT_TRUE( tree.search( key )->value() == 9 );
+        ASSERT_TRUE( tree.update( key, increment ) );
+        ASSERT_TRUE( tree.search( key )->value() == 10 );
+    }
+
+    // In multimap mode every value is updated and assignment drops the rest.
+    BPlusTree multi( 3, true );
+    for( std::int64_t v : { 4, 1, 3 } )
+    {
+        multi.insert( 8, v );
+    }
+    ASSERT_TRUE( multi.update( 8, []( ValueType v ){ return 10 - v; } ) );
+    ASSERT_TRUE( multi.search( 8 )->values() == std::vector< ValueType >( { 6, 7, 9 } ) );
+
+    ASSERT_FALSE( multi.insert_or_assign( 8, 2 ) );
+    ASSERT_TRUE( multi.search( 8 )->size() == 1 );
+    ASSERT_TRUE( multi.search( 8 )->value() == 2 );
+}
+
+
+TEST( btree, erase_range )
+{
+    std::mt19937 rng;
+
+    for( std::size_t order : { 3, 4, 5, 8, 33 } )
+    {
+        std::map< std::int64_t, ValueType > smap;
+        BPlusTree tree( order );
+        std::uniform_int_distribution< std::int64_t > dist_key( 0, 3000 );
+
+        for( int round = 0; round < 40; round++ )
+        {
+            for( int i = 0; i < 200; i++ )
+            {
+                const std::int64_t key = dist_key( rng );
+                if( smap.insert( std::make_pair( key, key ) ).second )
+                {
+                    tree.insert( key, key );
+                }
+            }
+
+            std::int64_t lo = dist_key( rng );
+            std::int64_t hi = lo + dist_key( rng ) / ( 1 + round % 4 );
+            const auto b = smap.lower_bound( lo );
+            const auto e = smap.upper_bound( hi );
+            const std::size_t expected = static_cast< std::size_t >( std::distance( b, e ) );
+            smap.erase( b, e );
+
+            ASSERT_TRUE( tree.erase_range( lo, hi ) == expected );
+
+            // A snapshot walks the leaf chain, which has to visit exactly
+            // the remaining keys in ascending order.
+            std::stringstream ss;
+            Snapshot( tree ).save( ss );
+            BPlusTree copy( order );
+            ASSERT_NO_THROW( Snapshot( copy ).load( ss ) );
+            for( const auto& v : smap )
+            {
+                ASSERT_TRUE( copy.search( v.first ) != nullptr );
+            }
+            ASSERT_TRUE( copy.erase_range( -1, 100000 ) == smap.size() );
+
+            for( std::int64_t key = lo - 2; key <= hi + 2; key++ )
+            {
+                ASSERT_TRUE( ( tree.search( key ) != nullptr ) == ( smap.count( key ) == 1 ) );
+            }
+        }
+
+        // Single removals rely on the node sizes left by erase_range().
+        while( !smap.empty() )
+        {
+            tree.remove( smap.begin()->first );
+            smap.erase( smap.begin() );
+        }
+        ASSERT_TRUE( tree.is_empty() );
+    }
+
+    BPlusTree tree( 4 );
+    ASSERT_TRUE( tree.erase_range( 0, 10 ) == 0 );
+    for( std::int64_t key = 0; key < 1000; key++ )
+    {
+        tree.insert( key, key );
+    }
+    ASSERT_TRUE( tree.erase_range( 10, 0 ) == 0 );
+    ASSERT_TRUE( tree.erase_range( -5, 2000 ) == 1000 );
+    ASSERT_TRUE( tree.is_empty() );
+}
+
+
+TEST( btree, split_at_and_join )
+{
+    std::mt19937 rng;
+
+    for( std::size_t order : { 3, 4, 7, 32 } )
+    {
+        for( std::int64_t n : { 1, 10, 500, 3000 } )
+        {
+            std::uniform_int_distribution< std::int64_t > dist_key( -10, n + 10 );
+            for( int round = 0; round < 10; round++ )
+            {
+                BPlusTree tree( order );
+                for( std::int64_t key = 0; key < n; key++ )
+                {
+                    tree.insert( key, key );
+                }
+
+                const std::int64_t pivot = dist_key( rng );
+                BPlusTree right( order );
+                tree.split_at( pivot, right );
+
+                for( std::int64_t key = -1; key <= n; key++ )
+                {
+                    const bool in_range = ( key >= 0 && key < n );
+                    ASSERT_TRUE( ( tree.search( key ) != nullptr ) == ( in_range && key < pivot ) );
+                    ASSERT_TRUE( ( right.search( key ) != nullptr ) == ( in_range && key >= pivot ) );
+                }
+
+                // Both halves stay usable, and joining them restores the tree.
+                tree.insert( n + 100, 0 );
+                right.insert( -100, 0 );
+                right.remove( -100 );
+                tree.remove( n + 100 );
+
+                if( round % 2 )
+                {
+                    tree.join( right );
+                }
+                else
+                {
+                    right.join( tree );
+                    std::swap( tree.m_root, right.m_root );
+                }
+                ASSERT_TRUE( right.is_empty() );
+
+                std::stringstream ss;
+                Snapshot( tree ).save( ss );
+                BPlusTree copy( order );
+                ASSERT_NO_THROW( Snapshot( copy ).load( ss ) );
+                ASSERT_TRUE( copy.erase_range( -1, n ) == static_cast< std::size_t >( n ) );
+
+                for( std::int64_t key = 0; key < n; key++ )
+                {
+                    ASSERT_TRUE( tree.search( key ) != nullptr );
+                    tree.remove( key );
+                }
+                ASSERT_TRUE( tree.is_empty() );
+            }
+        }
+    }
+}
+
+
+TEST( btree, join_trees_of_different_height )
+{
+    for( std::int64_t small : { 1, 2, 5, 40 } )
+    {
+        BPlusTree big( 3 );
+        BPlusTree little( 3 );
+        for( std::int64_t key = 0; key < 1000; key++ )
+        {
+            big.insert( key, key );
+        }
+        for( std::int64_t key = 0; key < small; key++ )
+        {
+            little.insert( 2000 + key, key );
+        }
+
+        BPlusTree overlapping( 3 );
+        overlapping.insert( 500, 0 );
+        ASSERT_ANY_THROW( big.join( overlapping ) );
+        ASSERT_ANY_THROW( big.join( big ) );
+        BPlusTree other_order( 4 );
+        ASSERT_ANY_THROW( big.join( other_order ) );
+
+        little.join( big );
+        ASSERT_TRUE( big.is_empty() );
+        for( std::int64_t key = 0; key < 1000; key++ )
+        {
+            ASSERT_TRUE( little.search( key ) != nullptr );
+        }
+        ASSERT_TRUE( little.erase_range( 0, 3000 ) == static_cast< std::size_t >( 1000 + small ) );
+        ASSERT_TRUE( little.is_empty() );
+    }
+}
+
+
+TEST( btree, merge_overlapping )
+{
+    BPlusTree a( 5 );
+    BPlusTree b( 5 );
+    for( std::int64_t key = 0; key < 2000; key += 2 )
+    {
+        a.insert( key, key );
+    }
+    for( std::int64_t key = 0; key < 3000; key += 3 )
+    {
+        b.insert( key, -key );
+    }
+
+    a.merge( b );
+    ASSERT_TRUE( b.is_empty() );
+    for( std::int64_t key = 0; key < 3000; key++ )
+    {
+        const Record* rec = a.search( key );
+        const bool in_a = ( key % 2 == 0 && key < 2000 );
+        ASSERT_TRUE( ( rec != nullptr ) == ( in_a || key % 3 == 0 ) );
+        if( rec )
+        {
+            ASSERT_TRUE( rec->value() == ( in_a ? key : -key ) );
+        }
+    }
+
+    BPlusTree ma( 4, true );
+    BPlusTree mb( 4, true );
+    for( std::int64_t key = 0; key < 100; key++ )
+    {
+        ma.insert( key, 1 );
+        mb.insert( key, 2 );
+        mb.insert( key, 0 );
+    }
+    ma.merge( mb );
+    for( std::int64_t key = 0; key < 100; key++ )
+    {
+        ASSERT_TRUE( ma.search( key )->values() == std::vector< ValueType >( { 0, 1, 2 } ) );
+    }
+}
+
+
+TEST( btree, order_statistics )
+{
+    std::mt19937 rng;
+
+    for( std::size_t order : { 3, 4, 16 } )
+    {
+        std::set< std::int64_t > keys;
+        BPlusTree tree( order );
+        std::uniform_int_distribution< std::int64_t > dist_key( -2000, 2000 );
+
+        ASSERT_TRUE( tree.size() == 0 );
+        ASSERT_TRUE( tree.rank( 5 ) == 0 );
+        ASSERT_ANY_THROW( tree.select( 0 ) );
+
+        for( int round = 0; round < 20; round++ )
+        {
+            for( int i = 0; i < 300; i++ )
+            {
+                const std::int64_t key = dist_key( rng );
+                if( i % 3 == 2 )
+                {
+                    keys.erase( key );
+                    tree.remove( key );
+                }
+                else if( keys.insert( key ).second )
+                {
+                    tree.insert( key, key );
+                }
+            }
+
+            if( round % 5 == 4 )
+            {
+                const std::int64_t lo = dist_key( rng );
+                keys.erase( keys.lower_bound( lo ), keys.upper_bound( lo + 300 ) );
+                tree.erase_range( lo, lo + 300 );
+            }
+
+            ASSERT_TRUE( tree.size() == keys.size() );
+
+            std::size_t index = 0;
+            for( std::int64_t key : keys )
+            {
+                ASSERT_TRUE( tree.rank( key ) == index );
+                ASSERT_TRUE( tree.select( index ).first == key );
+                ASSERT_TRUE( tree.select( index ).second == tree.search( key ) );
+                index++;
+            }
+            ASSERT_ANY_THROW( tree.select( keys.size() ) );
+
+            for( int i = 0; i < 50; i++ )
+            {
+                const std::int64_t lo = dist_key( rng );
+                const std::int64_t hi = lo + dist_key( rng ) / 4;
+                const auto expected = std::distance( keys.lower_bound( lo ), keys.upper_bound( std::max( lo, hi ) ) );
+                ASSERT_TRUE( tree.count( lo, hi ) == ( hi < lo ? 0 : static_cast< std::size_t >( expected ) ) );
+            }
+        }
+    }
+}
+
+
+TEST( btree, range_aggregates )
+{
+    std::mt19937 rng;
+
+    for( bool duplicates : { false, true } )
+    {
+        std::map< std::int64_t, std::multiset< ValueType > > smap;
+        BPlusTree tree( 5, duplicates );
+        std::uniform_int_distribution< std::int64_t > dist_key( 0, 1000 );
+        std::uniform_int_distribution< ValueType > dist_value( -1000, 1000 );
+
+        ASSERT_TRUE( tree.aggregate( 0, 1000 ).empty() );
+
+        for( int i = 0; i < 6000; i++ )
+        {
+            const std::int64_t key = dist_key( rng );
+            const ValueType value = dist_value( rng );
+            switch( i % 6 )
+            {
+            case 0:
+                smap.erase( key );
+                tree.remove( key );
+                break;
+            case 1:
+                if( smap.count( key ) && tree.update( key, []( ValueType v ){ return v / 2; } ) )
+                {
+                    std::multiset< ValueType > halved;
+                    for( ValueType v : smap[ key ] )
+                    {
+                        halved.insert( v / 2 );
+                    }
+                    smap[ key ] = halved;
+                }
+                break;
+            case 2:
+                tree.insert_or_assign( key, value );
+                smap[ key ] = { value };
+                break;
+            case 3:
+                tree.upsert( key, value, []( ValueType v ){ return v - 300; } );
+                if( smap.count( key ) )
+                {
+                    std::multiset< ValueType > lowered;
+                    for( ValueType v : smap[ key ] )
+                    {
+                        lowered.insert( v - 300 );
+                    }
+                    smap[ key ] = lowered;
+                }
+                else
+                {
+                    smap[ key ] = { value };
+                }
+                break;
+            default:
+                if( duplicates || !smap.count( key ) )
+                {
+                    tree.insert( key, value );
+                    smap[ key ].insert( value );
+                }
+                break;
+            }
+        }
+
+        for( int i = 0; i < 200; i++ )
+        {
+            const std::int64_t lo = dist_key( rng );
+            const std::int64_t hi = lo + dist_key( rng ) / 3;
+
+            std::size_t count = 0;
+            std::size_t value_count = 0;
+            ValueType sum = 0;
+            ValueType min = INT64_MAX;
+            ValueType max = INT64_MIN;
+            for( auto it = smap.lower_bound( lo ); it != smap.end() && it->first <= hi; ++it )
+            {
+                count++;
+                for( ValueType v : it->second )
+                {
+                    value_count++;
+                    sum += v;
+                    min = std::min( min, v );
+                    max = std::max( max, v );
+                }
+            }
+
+            const Summary s = tree.aggregate( lo, hi );
+            ASSERT_TRUE( s.m_count == count );
+            ASSERT_TRUE( s.m_value_count == value_count );
+            ASSERT_TRUE( s.m_sum == sum );
+            if( count )
+            {
+                ASSERT_TRUE( s.m_min == min );
+                ASSERT_TRUE( s.m_max == max );
+            }
+        }
+    }
+}
+
+
+TEST( btree, top_down_mode )
+{
+    BPlusTree small( 3 );
+    ASSERT_ANY_THROW( small.set_top_down( true ) );
+
+    std::mt19937 rng;
+    for( std::size_t order : { 4, 5, 9 } )
+    {
+        BPlusTree tree( order );
+        ASSERT_NO_THROW( tree.set_top_down( true ) );
+        ASSERT_TRUE( tree.top_down() );
+
+        std::map< std::int64_t, ValueType > smap;
+        std::uniform_int_distribution< std::int64_t > dist_key( 0, 2000 );
+        for( int i = 0; i < 20000; i++ )
+        {
+            const std::int64_t key = dist_key( rng );
+            // Phases of growth and shrinkage.
+            if( ( i / 4000 ) % 2 ? i % 3 != 0 : i % 3 == 0 )
+            {
+                smap.erase( key );
+                tree.remove( key );
+            }
+            else if( smap.insert( std::make_pair( key, i ) ).second )
+            {
+                tree.insert( key, i );
+            }
+        }
+
+        ASSERT_ANY_THROW( tree.set_top_down( false ) );
+        ASSERT_TRUE( tree.size() == smap.size() );
+        for( const auto& v : smap )
+        {
+            const Record* rec = tree.search( v.first );
+            ASSERT_TRUE( rec );
+            ASSERT_TRUE( rec->value() == v.second );
+        }
+
+        while( !smap.empty() )
+        {
+            tree.remove( smap.begin()->first );
+            smap.erase( smap.begin() );
+        }
+        ASSERT_TRUE( tree.is_empty() );
+        ASSERT_NO_THROW( tree.set_top_down( false ) );
+    }
+}
+
+
+TEST( btree, append_mode )
+{
+    std::mt19937 rng;
+    for( std::size_t order : { 3, 4, 8 } )
+    {
+        BPlusTree tree( order );
+        tree.set_append_mode( true );
+        ASSERT_TRUE( tree.append_mode() );
+        tree.reset_rebalance_counters();
+
+        const std::int64_t key_no = 5000;
+        for( std::int64_t key = 0; key < key_no; key++ )
+        {
+            tree.insert( key, key );
+        }
+
+        // Ascending keys leave every leaf but the last one full.
+        Node* node = tree.m_root;
+        while( !node->is_leaf() )
+        {
+            node = node->internal()->first_child();
+        }
+        std::size_t leaf_no = 0;
+        for( LeafNode* leaf = node->leaf(); leaf; leaf = leaf->next() )
+        {
+            ASSERT_TRUE( leaf->size() == tree.leaf_max_size() || !leaf->next() );
+            leaf_no++;
+        }
+        ASSERT_TRUE( leaf_no == ( key_no + tree.leaf_max_size() - 1 ) / tree.leaf_max_size() );
+
+        // Every node but the first leaf and the roots was started by a
+        // split.
+        const TreeStats stats = tree.stats();
+        std::size_t node_no = 0;
+        for( const LevelStats& level : stats.m_levels )
+        {
+            node_no += level.m_nodes;
+        }
+        ASSERT_TRUE( tree.rebalance_counters().m_splits == node_no - stats.m_levels.size() );
+
+        // Appends mixed with other changes.
+        std::map< std::int64_t, ValueType > smap;
+        for( std::int64_t key = 0; key < key_no; key++ )
+        {
+            smap[ key ] = key;
+        }
+        std::int64_t next_key = key_no;
+        for( int i = 0; i < 20000; i++ )
+        {
+            const std::int64_t key = static_cast< std::int64_t >( rng() % static_cast< std::uint64_t >( next_key ) );
+            if( i % 4 == 0 )
+            {
+                smap.erase( key );
+                tree.remove( key );
+            }
+            else if( i % 4 == 1 && smap.insert( std::make_pair( key, i ) ).second )
+            {
+                tree.insert( key, i );
+            }
+            else
+            {
+                smap[ next_key ] = i;
+                tree.insert( next_key++, i );
+            }
+        }
+
+        ASSERT_TRUE( tree.size() == smap.size() );
+        ASSERT_TRUE( tree.aggregate( 0, next_key ).m_sum == std::accumulate( smap.begin(), smap.end(), ValueType( 0 ),
+            []( ValueType s, const std::pair< const std::int64_t, ValueType >& v ){ return s + v.second; } ) );
+
+        tree.set_append_mode( false );
+        for( const auto& v : smap )
+        {
+            const Record* rec = tree.search( v.first );
+            ASSERT_TRUE( rec );
+            ASSERT_TRUE( rec->value() == v.second );
+        }
+
+        while( !smap.empty() )
+        {
+            tree.remove( smap.begin()->first );
+            smap.erase( smap.begin() );
+        }
+        ASSERT_TRUE( tree.is_empty() );
+    }
+}
+
+
+TEST( btree, finger_search )
+{
+    std::mt19937 rng;
+    BPlusTree tree( 8 );
+    Finger finger( tree );
+    ASSERT_TRUE( finger.search( 1 ) == nullptr );
+
+    std::map< std::int64_t, ValueType > smap;
+    for( std::int64_t key = 0; key < 4000; key += 2 )
+    {
+        tree.insert( key, key );
+        smap[ key ] = key;
+    }
+
+    // A random walk over the keys, with occasional changes to the tree.
+    std::int64_t key = 2000;
+    for( int i = 0; i < 20000; i++ )
+    {
+        key = std::max< std::int64_t >( 0, std::min< std::int64_t >( 4000, key + static_cast< std::int64_t >( rng() % 9 ) - 4 ) );
+        if( i % 50 == 0 )
+        {
+            if( smap.erase( key ) )
+            {
+                tree.remove( key );
+            }
+            else
+            {
+                smap[ key ] = i;
+                tree.insert( key, i );
+            }
+        }
+
+        const Record* rec = finger.search( key );
+        ASSERT_TRUE( rec == tree.search( key ) );
+        ASSERT_TRUE( ( rec != nullptr ) == ( smap.count( key ) == 1 ) );
+    }
+
+    ASSERT_TRUE( finger.hits() + finger.next_hits() + finger.misses() == 20000 );
+    ASSERT_TRUE( finger.next_hits() > 0 );
+    ASSERT_TRUE( finger.hit_rate() > 0.5 );
+
+    finger.reset_counters();
+    ASSERT_TRUE( finger.hit_rate() == 0.0 );
+
+    tree.destroy_tree();
+    ASSERT_TRUE( finger.search( key ) == nullptr );
+}
+
+
+TEST( btree, underflow_policies )
+{
+    const std::pair< UnderflowPolicy, std::size_t > policies[] = {
+        { UnderflowPolicy::EAGER, 0 }, { UnderflowPolicy::THRESHOLD, 2 }, { UnderflowPolicy::AT_EMPTY, 0 } };
+
+    std::uint64_t eager_moved = 0;
+    for( const auto& policy : policies )
+    {
+        std::mt19937 rng;
+        BPlusTree tree( 8 );
+        tree.set_underflow_policy( policy.first, policy.second );
+        ASSERT_TRUE( tree.underflow_policy() == policy.first );
+
+        // Ascending inserts leave the leaves at their minimum size.
+        std::map< std::int64_t, ValueType > smap;
+        for( std::int64_t key = 0; key < 4000; key++ )
+        {
+            tree.insert( key, key );
+            smap[ key ] = key;
+        }
+        tree.reset_rebalance_counters();
+
+        // Churn: remove a key and insert it back a little later.
+        std::vector< std::int64_t > removed;
+        for( int i = 0; i < 20000; i++ )
+        {
+            const std::int64_t key = static_cast< std::int64_t >( rng() % 4000 );
+            if( smap.erase( key ) )
+            {
+                tree.remove( key );
+                removed.push_back( key );
+            }
+            if( removed.size() > 8 )
+            {
+                tree.insert( removed.front(), removed.front() );
+                smap[ removed.front() ] = removed.front();
+                removed.erase( removed.begin() );
+            }
+        }
+
+        const RebalanceCounters& counters = tree.rebalance_counters();
+        if( policy.first == UnderflowPolicy::EAGER )
+        {
+            eager_moved = counters.m_moved;
+            ASSERT_TRUE( tree.deferred_underflows() == 0 );
+            ASSERT_TRUE( underfull_nodes( tree, tree.m_root ) == 0 );
+        }
+        else
+        {
+            ASSERT_TRUE( counters.m_moved < eager_moved );
+            ASSERT_TRUE( tree.deferred_underflows() > 0 );
+        }
+
+        for( std::int64_t key = 0; key < 4000; key++ )
+        {
+            ASSERT_TRUE( ( tree.search( key ) != nullptr ) == ( smap.count( key ) == 1 ) );
+        }
+        ASSERT_TRUE( tree.size() == smap.size() );
+
+        tree.compact();
+        ASSERT_TRUE( tree.deferred_underflows() == 0 );
+        ASSERT_TRUE( underfull_nodes( tree, tree.m_root ) == 0 );
+        ASSERT_TRUE( tree.size() == smap.size() );
+
+        while( !smap.empty() )
+        {
+            tree.remove( smap.begin()->first );
+            smap.erase( smap.begin() );
+        }
+        ASSERT_TRUE( tree.is_empty() );
+    }
+}
+
+
+TEST( btree, compactor )
+{
+    std::mt19937 rng;
+    BPlusTree tree( 8 );
+    tree.set_underflow_policy( UnderflowPolicy::AT_EMPTY );
+
+    std::map< std::int64_t, ValueType > smap;
+    for( int i = 0; i < 6000; i++ )
+    {
+        const std::int64_t key = static_cast< std::int64_t >( rng() % 100000 );
+        if( smap.emplace( key, -key ).second )
+        {
+            tree.insert( key, -key );
+        }
+    }
+    for( int i = 0; i < 4000; i++ )
+    {
+        const std::int64_t key = static_cast< std::int64_t >( rng() % 100000 );
+        if( smap.erase( key ) )
+        {
+            tree.remove( key );
+        }
+    }
+    ASSERT_TRUE( underfull_nodes( tree, tree.m_root ) > 0 );
+
+    // Small steps, with the tree changing between them.
+    Compactor compactor( tree );
+    std::size_t step_no = 1;
+    while( !compactor.step( 3 ) )
+    {
+        const std::int64_t key = static_cast< std::int64_t >( rng() % 100000 );
+        if( smap.erase( key ) )
+        {
+            tree.remove( key );
+        }
+        step_no++;
+    }
+    ASSERT_TRUE( step_no > 1 );
+    ASSERT_TRUE( compactor.relocated() > 0 );
+
+    // A second pass over the quiet tree leaves no underfull node behind.
+    compactor.run();
+    ASSERT_TRUE( underfull_nodes( tree, tree.m_root ) == 0 );
+    ASSERT_TRUE( tree.deferred_underflows() == 0 );
+
+    ASSERT_TRUE( tree.size() == smap.size() );
+    for( const auto& kv : smap )
+    {
+        const Record* rec = tree.search( kv.first );
+        ASSERT_TRUE( rec && rec->value() == kv.second );
+    }
+
+    // The leaf chain still visits every key once, in order.
+    const Node* node = tree.m_root;
+    while( !node->is_leaf() )
+    {
+        node = node->internal()->neighbor( 0 );
+    }
+    std::vector< std::int64_t > keys;
+    for( const LeafNode* leaf = node->leaf(); leaf; leaf = leaf->next() )
+    {
+        for( std::size_t i = 0; i < leaf->size(); i++ )
+        {
+            keys.push_back( leaf->key_at( i ).to_int64() );
+        }
+    }
+    ASSERT_TRUE( keys.size() == smap.size() );
+    ASSERT_TRUE( std::equal( keys.begin(), keys.end(), smap.begin(), []( std::int64_t k, const std::pair< const std::int64_t, ValueType >& kv ){ return k == kv.first; } ) );
+
+    tree.destroy_tree();
+    ASSERT_TRUE( compactor.step() );
+}
+
+
+TEST( btree, compactor_upper_merges )
+{
+    // Repairing the levels above a bottom-level node may merge the leaf
+    // after it into the last relocated one; the pass has to continue
+    // from the tree as it is after the repair.
+    for( std::size_t order = 4; order <= 9; order++ )
+    {
+        for( unsigned seed = 0; seed < 10; seed++ )
+        {
+            std::mt19937 rng( seed );
+            BPlusTree tree( order );
+            tree.set_underflow_policy( UnderflowPolicy::AT_EMPTY );
+
+            std::vector< std::int64_t > keys( 2000 );
+            std::iota( keys.begin(), keys.end(), 0 );
+            for( std::int64_t key : keys )
+            {
+                tree.insert( key, key );
+            }
+            std::shuffle( keys.begin(), keys.end(), rng );
+            keys.resize( 1500 );
+            for( std::int64_t key : keys )
+            {
+                tree.remove( key );
+            }
+
+            Compactor compactor( tree );
+            while( !compactor.step() )
+            {
+            }
+            ASSERT_TRUE( underfull_nodes( tree, tree.m_root ) == 0 );
+            ASSERT_TRUE( tree.size() == 500 );
+
+            std::sort( keys.begin(), keys.end() );
+            for( std::int64_t key = 0; key < 2000; key++ )
+            {
+                ASSERT_TRUE( ( tree.search( key ) == nullptr ) == std::binary_search( keys.begin(), keys.end(), key ) );
+            }
+        }
+    }
+}
+
+
+TEST( btree, compactor_memory )
+{
+    // Every pass moves the leaves to fresh slots. The chunks left empty
+    // behind are returned, so repeated passes do not grow the arena.
+    const std::int64_t key_no = 100000;
+    BPlusTree tree( 4 );
+    for( std::int64_t key = 0; key < key_no; key++ )
+    {
+        tree.insert( key, key );
+    }
+
+    Compactor compactor( tree );
+    compactor.run();
+    const std::size_t bytes = LeafNode::arena().bytes();
+    for( int pass = 0; pass < 5; pass++ )
+    {
+        compactor.run();
+    }
+    ASSERT_TRUE( compactor.relocated() >= 6 * static_cast< std::uint64_t >( key_no ) / 4 );
+    ASSERT_TRUE( LeafNode::arena().bytes() <= bytes + 2 * NodeArena::CHUNK_SIZE );
+    ASSERT_TRUE( tree.size() == static_cast< std::size_t >( key_no ) );
+}
+
+
+TEST( btree, arena_threads )
+{
+    // Threads build and destroy trees of their own through the thread
+    // caches of the node arenas. The slots go back to the chunks, at the
+    // latest when a thread ends, so the arenas do not grow.
+    const std::size_t bytes = LeafNode::arena().bytes() + InternalNode::arena().bytes();
+    std::vector< std::thread > threads;
+    std::vector< int > ok( 4, 0 );
+    for( int t = 0; t < 4; t++ )
+    {
+        threads.emplace_back( [ &ok, t ]()
+        {
+            BPlusTree tree( 4 );
+            for( std::int64_t key = 0; key < 20000; key++ )
+            {
+                tree.insert( key * 4 + t, key );
+            }
+            for( std::int64_t key = 0; key < 20000; key += 2 )
+            {
+                tree.remove( key * 4 + t );
+            }
+            bool found = tree.size() == 10000;
+            for( std::int64_t key = 0; key < 20000; key++ )
+            {
+                found = found && ( tree.search( key * 4 + t ) != nullptr ) == ( key % 2 == 1 );
+            }
+            ok[ t ] = found;
+        } );
+    }
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    ASSERT_TRUE( std::count( ok.begin(), ok.end(), 1 ) == 4 );
+    ASSERT_TRUE( LeafNode::arena().bytes() + InternalNode::arena().bytes() <= bytes + 2 * NodeArena::CHUNK_SIZE );
+}
+
+
+TEST( btree, relayout )
+{
+    std::mt19937 rng;
+    BPlusTree tree( 16 );
+    tree.relayout();
+    ASSERT_TRUE( tree.is_empty() );
+
+    std::map< std::int64_t, ValueType > smap;
+    for( int i = 0; i < 20000; i++ )
+    {
+        const std::int64_t key = static_cast< std::int64_t >( rng() % 1000000 );
+        if( smap.emplace( key, key / 3 ).second )
+        {
+            tree.insert( key, key / 3 );
+        }
+    }
+
+    tree.relayout();
+    const std::size_t bytes = LeafNode::arena().bytes() + InternalNode::arena().bytes();
+    for( int i = 0; i < 4; i++ )
+    {
+        tree.relayout();
+    }
+    // The chunks vacated by a pass are returned.
+    ASSERT_TRUE( LeafNode::arena().bytes() + InternalNode::arena().bytes() <= bytes + 2 * NodeArena::CHUNK_SIZE );
+
+    // Neighbors in the leaf chain are neighbors in memory, except where
+    // a chunk ends.
+    const Node* node = tree.m_root;
+    while( !node->is_leaf() )
+    {
+        node = node->internal()->neighbor( 0 );
+    }
+    const LeafNode* first = node->leaf();
+    const std::ptrdiff_t stride = reinterpret_cast< const char* >( first->next() ) - reinterpret_cast< const char* >( first );
+    ASSERT_TRUE( stride > 0 );
+
+    std::size_t leaf_no = 0;
+    std::size_t adjacent = 0;
+    std::vector< std::int64_t > keys;
+    for( const LeafNode* leaf = first; leaf; leaf = leaf->next() )
+    {
+        leaf_no++;
+        if( leaf->next() && reinterpret_cast< const char* >( leaf->next() ) - reinterpret_cast< const char* >( leaf ) == stride )
+        {
+            adjacent++;
+        }
+        for( std::size_t i = 0; i < leaf->size(); i++ )
+        {
+            keys.push_back( leaf->key_at( i ).to_int64() );
+        }
+    }
+    ASSERT_TRUE( adjacent + 1 + leaf_no * static_cast< std::size_t >( stride ) / NodeArena::CHUNK_SIZE >= leaf_no );
+
+    ASSERT_TRUE( keys.size() == smap.size() );
+    ASSERT_TRUE( std::equal( keys.begin(), keys.end(), smap.begin(), []( std::int64_t k, const std::pair< const std::int64_t, ValueType >& kv ){ return k == kv.first; } ) );
+    for( const auto& kv : smap )
+    {
+        const Record* rec = tree.search( kv.first );
+        ASSERT_TRUE( rec && rec->value() == kv.second );
+    }
+
+    std::vector< std::int64_t > scanned;
+    const std::size_t visited = tree.scan( 250000, 500000, [ &scanned ]( const KeyType& key, const Record* rec ){
+        ASSERT_TRUE( rec->value() == key.to_int64() / 3 );
+        scanned.push_back( key.to_int64() );
+    } );
+    const auto lo = smap.lower_bound( 250000 );
+    const auto hi = smap.upper_bound( 500000 );
+    ASSERT_TRUE( visited == static_cast< std::size_t >( std::distance( lo, hi ) ) );
+    ASSERT_TRUE( std::equal( scanned.begin(), scanned.end(), lo, []( std::int64_t k, const std::pair< const std::int64_t, ValueType >& kv ){ return k == kv.first; } ) );
+    ASSERT_TRUE( tree.scan( 5, 4, []( const KeyType&, const Record* ){} ) == 0 );
+
+    // The tree keeps working after a relayout.
+    for( int i = 0; i < 5000; i++ )
+    {
+        const std::int64_t key = static_cast< std::int64_t >( rng() % 1000000 );
+        if( smap.erase( key ) )
+        {
+            tree.remove( key );
+        }
+        else
+        {
+            tree.insert( key, key / 3 );
+            smap[ key ] = key / 3;
+        }
+    }
+    ASSERT_TRUE( tree.size() == smap.size() );
+}
+
+
+TEST( btree, entry_arenas )
+{
+    // Arrays up to MAX_SIZE come from the arenas, larger ones from the
+    // C library.
+    for( std::size_t size : { std::size_t( 1 ), EntryArenas::MIN_SIZE + 1, EntryArenas::MAX_SIZE, EntryArenas::MAX_SIZE + 1 } )
+    {
+        char* p = static_cast< char* >( EntryArenas::allocate( size ) );
+        std::fill( p, p + size, 'x' );
+        EntryArenas::deallocate( p, size );
+    }
+
+    // The entry arrays of a tree take arena memory, which goes back
+    // once the tree is gone.
+    const std::size_t bytes = EntryArenas::bytes();
+    {
+        BPlusTree tree( 16 );
+        for( std::int64_t key = 0; key < 200000; key++ )
+        {
+            tree.insert( key, key );
+        }
+        ASSERT_TRUE( EntryArenas::bytes() > bytes );
+    }
+    ASSERT_TRUE( EntryArenas::bytes() <= bytes + EntryArenas::ARENA_NO * NodeArena::CHUNK_SIZE );
+}
+
+
+TEST( btree, huge_pages )
+{
+    std::mt19937 rng;
+    std::map< std::int64_t, ValueType > smap;
+    BPlusTree tree( 8 );
+
+    // The huge page pool is usually empty; the chunks then fall back to
+    // transparent huge pages or to normal pages.
+    for( auto mode : { NodeArena::HUGE_PAGES, NodeArena::TRANSPARENT_HUGE_PAGES, NodeArena::SMALL_PAGES } )
+    {
+        BPlusTree::set_page_mode( mode );
+        ASSERT_TRUE( LeafNode::arena().page_mode() == mode );
+        ASSERT_TRUE( InternalNode::arena().page_mode() == mode );
+
+        for( int i = 0; i < 20000; i++ )
+        {
+            const std::int64_t key = static_cast< std::int64_t >( rng() % 1000000 );
+            if( smap.emplace( key, key + 1 ).second )
+            {
+                tree.insert( key, key + 1 );
+            }
+        }
+        tree.relayout();
+
+        ASSERT_TRUE( LeafNode::arena().huge_bytes() <= LeafNode::arena().bytes() );
+        ASSERT_TRUE( InternalNode::arena().huge_bytes() <= InternalNode::arena().bytes() );
+        ASSERT_TRUE( EntryArenas::huge_bytes() <= EntryArenas::bytes() );
+        ASSERT_TRUE( tree.size() == smap.size() );
+        for( const auto& kv : smap )
+        {
+            const Record* rec = tree.search( kv.first );
+            ASSERT_TRUE( rec && rec->value() == kv.second );
+        }
+    }
+}
+
+
+//
+// Every copy matches its node, and every replica leads to the leaf the
+// tree itself leads to.
+//
+static void check_replicas( const BPlusTree& tree, const std::map< std::int64_t, ValueType >& smap )
+{
+    ASSERT_TRUE( tree.size() == smap.size() );
+    if( tree.is_empty() )
+    {
+        return;
+    }
+    ASSERT_TRUE( tree.m_replicas->check( tree.m_root ) );
+
+    std::size_t i = 0;
+    for( const auto& kv : smap )
+    {
+        if( i++ % 7 )
+        {
+            continue;
+        }
+        const Node* node = tree.m_root;
+        while( !node->is_leaf() )
+        {
+            node = node->internal()->lookup( kv.first );
+        }
+        for( std::size_t r = 0; r < tree.replica_no(); r++ )
+        {
+            ASSERT_TRUE( tree.m_replicas->find_leaf( tree.m_root, kv.first, r ) == node->leaf() );
+        }
+        const Record* rec = tree.search( kv.first );
+        ASSERT_TRUE( rec && rec->value() == kv.second );
+    }
+}
+
+
+TEST( btree, replication )
+{
+    std::mt19937 rng;
+    const std::size_t REPLICA_NO = 3;
+
+    for( int mode = 0; mode < 4; mode++ )
+    {
+        std::map< std::int64_t, ValueType > smap;
+        BPlusTree tree( 5 );
+        tree.set_top_down( mode == 1 );
+        tree.set_append_mode( mode == 2 );
+        if( mode == 3 )
+        {
+            tree.set_underflow_policy( UnderflowPolicy::AT_EMPTY );
+        }
+        tree.set_replication( true, REPLICA_NO );
+        ASSERT_TRUE( tree.replica_no() == REPLICA_NO );
+
+        for( int round = 0; round < 8; round++ )
+        {
+            for( int i = 0; i < 1500; i++ )
+            {
+                const std::int64_t key = ( mode == 2 && round < 4 ) ? static_cast< std::int64_t >( smap.size() ) : static_cast< std::int64_t >( rng() % 5000 );
+                if( smap.count( key ) )
+                {
+                    tree.remove( key );
+                    smap.erase( key );
+                }
+                else
+                {
+                    tree.insert( key, key * 2 );
+                    smap[ key ] = key * 2;
+                }
+                if( i % 8 == 0 && !tree.is_empty() )
+                {
+                    ASSERT_TRUE( tree.m_replicas->check( tree.m_root ) );
+                }
+            }
+            check_replicas( tree, smap );
+        }
+
+        tree.set_append_mode( false );
+        check_replicas( tree, smap );
+    }
+
+    // Bulk operations.
+    std::map< std::int64_t, ValueType > smap;
+    BPlusTree tree( 6 );
+    tree.set_replication( true, REPLICA_NO );
+    for( std::int64_t key = 0; key < 20000; key++ )
+    {
+        tree.insert( key, key * 2 );
+        smap[ key ] = key * 2;
+    }
+    check_replicas( tree, smap );
+
+    ASSERT_TRUE( tree.erase_range( 3000, 9000 ) == 6001 );
+    smap.erase( smap.find( 3000 ), smap.find( 9001 ) );
+    check_replicas( tree, smap );
+
+    tree.relayout();
+    check_replicas( tree, smap );
+
+    for( std::int64_t key = 0; key < 20000; key += 3 )
+    {
+        if( smap.erase( key ) )
+        {
+            tree.remove( key );
+        }
+    }
+    tree.set_underflow_policy( UnderflowPolicy::AT_EMPTY );
+    for( std::int64_t key = 1; key < 20000; key += 3 )
+    {
+        if( smap.erase( key ) )
+        {
+            tree.remove( key );
+        }
+    }
+    tree.compact();
+    check_replicas( tree, smap );
+
+    Compactor( tree ).run();
+    check_replicas( tree, smap );
+
+    // Split and join with a tree that is not replicated, and back.
+    BPlusTree right( 6 );
+    tree.split_at( 12000, right );
+    std::map< std::int64_t, ValueType > right_map( smap.lower_bound( 12000 ), smap.end() );
+    smap.erase( smap.lower_bound( 12000 ), smap.end() );
+    check_replicas( tree, smap );
+    ASSERT_TRUE( right.size() == right_map.size() );
+    right.set_replication( true, 2 );
+    check_replicas( right, right_map );
+
+    tree.join( right );
+    ASSERT_TRUE( right.is_empty() );
+    smap.insert( right_map.begin(), right_map.end() );
+    check_replicas( tree, smap );
+
+    BPlusTree other( 6 );
+    std::map< std::int64_t, ValueType > other_map;
+    for( std::int64_t key = 5; key < 30000; key += 10 )
+    {
+        if( !smap.count( key ) )
+        {
+            other.insert( key, key * 2 );
+            other_map[ key ] = key * 2;
+        }
+    }
+    tree.merge( other );
+    smap.insert( other_map.begin(), other_map.end() );
+    check_replicas( tree, smap );
+
+    std::stringstream ss;
+    Snapshot( tree ).save( ss );
+    BPlusTree copy( 6 );
+    copy.set_replication( true );
+    Snapshot( copy ).load( ss );
+    check_replicas( copy, smap );
+
+    tree.set_replication( false );
+    ASSERT_TRUE( tree.replica_no() == 0 );
+    for( const auto& kv : smap )
+    {
+        const Record* rec = tree.search( kv.first );
+        ASSERT_TRUE( rec && rec->value() == kv.second );
+    }
+}
+
+
+TEST( btree, stats )
+{
+    BPlusTree tree( 8, true );
+    ASSERT_TRUE( tree.stats().m_levels.empty() );
+
+    tree.insert( 5, 1 );
+    TreeStats single = tree.stats( 4 );
+    ASSERT_TRUE( single.m_levels.size() == 1 );
+    ASSERT_TRUE( single.m_keys == 1 );
+    ASSERT_TRUE( single.m_levels[ 0 ].m_min_key == 5 );
+
+    std::mt19937 rng;
+    std::map< std::int64_t, std::size_t > smap;
+    for( int i = 0; i < 20000; i++ )
+    {
+        const std::int64_t key = static_cast< std::int64_t >( rng() % 5000 );
+        tree.insert( key, i );
+        smap[ key ]++;
+    }
+    smap[ 5 ]++;
+
+    const TreeStats stats = tree.stats();
+    ASSERT_TRUE( stats.m_keys == smap.size() );
+    ASSERT_TRUE( stats.m_values == 20001 );
+
+    const LevelStats& root = stats.m_levels.front();
+    const LevelStats& leaves = stats.m_levels.back();
+    ASSERT_TRUE( stats.m_levels.size() > 2 );
+    ASSERT_TRUE( root.m_nodes == 1 );
+    ASSERT_TRUE( leaves.m_entries == smap.size() );
+    ASSERT_TRUE( leaves.m_keys == smap.size() );
+    ASSERT_TRUE( leaves.m_min_key == smap.begin()->first );
+    ASSERT_TRUE( leaves.m_max_key == smap.rbegin()->first );
+    ASSERT_TRUE( leaves.m_capacity == tree.leaf_max_size() );
+    ASSERT_TRUE( leaves.fill() > 0.5 && leaves.fill() <= 1.0 );
+
+    for( std::size_t i = 0; i + 1 < stats.m_levels.size(); i++ )
+    {
+        // Every entry of a level is a node of the next one.
+        ASSERT_TRUE( stats.m_levels[ i ].m_entries == stats.m_levels[ i + 1 ].m_nodes );
+        ASSERT_TRUE( stats.m_levels[ i ].m_keys == stats.m_levels[ i ].m_entries - stats.m_levels[ i ].m_nodes );
+    }
+    for( const auto& level : stats.m_levels )
+    {
+        ASSERT_TRUE( std::accumulate( level.m_fill.begin(), level.m_fill.end(), std::size_t( 0 ) ) == level.m_nodes );
+    }
+    ASSERT_TRUE( stats.m_node_bytes >= stats.nodes() * sizeof( LeafNode ) );
+    ASSERT_TRUE( stats.m_entry_bytes >= leaves.m_entries * sizeof( LeafElt ) );
+    ASSERT_TRUE( stats.m_record_bytes >= stats.m_keys * sizeof( Record ) );
+    ASSERT_TRUE( stats.bytes() == stats.m_node_bytes + stats.m_entry_bytes + stats.m_record_bytes );
+
+    // The parallel walk gives the same result.
+    for( std::size_t thread_no : { 0, 3, 64 } )
+    {
+        const TreeStats parallel = tree.stats( thread_no );
+        ASSERT_TRUE( parallel.m_levels.size() == stats.m_levels.size() );
+        for( std::size_t i = 0; i < stats.m_levels.size(); i++ )
+        {
+            const LevelStats& a = parallel.m_levels[ i ];
+            const LevelStats& b = stats.m_levels[ i ];
+            ASSERT_TRUE( a.m_nodes == b.m_nodes && a.m_entries == b.m_entries && a.m_keys == b.m_keys );
+            ASSERT_TRUE( a.m_min_key == b.m_min_key && a.m_max_key == b.m_max_key );
+            ASSERT_TRUE( a.m_fill == b.m_fill );
+        }
+        ASSERT_TRUE( parallel.m_values == stats.m_values );
+        ASSERT_TRUE( parallel.bytes() == stats.bytes() );
+    }
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "BPlusTree.hpp"
+#include "InputParser.hpp"
+#include "io.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+
+
+
+TEST( input_parser, parse_chunk )
+{
+    const std::string text = " 12\n-7\r\n+3\t0\n9223372036854775807 -9223372036854775808\n";
+    std::vector< std::int64_t > keys;
+    InputParser::parse_chunk( text.data(), text.data() + text.size(), keys );
+
+    const std::vector< std::int64_t > expected{ 12, -7, 3, 0, INT64_MAX, INT64_MIN };
+    ASSERT_TRUE( keys == expected );
+}
+
+
+TEST( input_parser, rejects_garbage )
+{
+    for( std::string text : { "12x", "--1", "-", "9223372036854775808", "1 2 a" } )
+    {
+        std::vector< std::int64_t > keys;
+        ASSERT_ANY_THROW( InputParser::parse_chunk( text.data(), text.data() + text.size(), keys ) );
+    }
+}
+
+
+TEST( input_parser, parallel_sort_and_dedupe )
+{
+    std::mt19937 rng;
+    std::uniform_int_distribution< std::int64_t > dist( -100000, 100000 );
+
+    std::set< std::int64_t > expected;
+    std::ostringstream oss;
+    for( int i = 0; i < 20000; i++ )
+    {
+        const std::int64_t key = dist( rng );
+        expected.insert( key );
+        oss << key << "\n";
+    }
+    const std::string text = oss.str();
+
+    for( std::size_t thread_no : { 1, 3, 4 } )
+    {
+        const auto keys = InputParser( thread_no, 1024 ).parse( text.data(), text.data() + text.size() );
+        ASSERT_TRUE( keys.size() == expected.size() );
+        ASSERT_TRUE( std::equal( keys.begin(), keys.end(), expected.begin() ) );
+    }
+}
+
+
+TEST( io, read_input_from_file )
+{
+    const std::string file_name = "input_test.txt";
+    {
+        std::ofstream out( file_name );
+        out << "5\n3\n8\n3\n-2\n";
+    }
+
+    BPlusTree tree( 4 );
+    Io io( tree );
+    ASSERT_NO_THROW( io.read_input_from_file( file_name ) );
+
+    for( std::int64_t key : { 5, 3, 8, -2 } )
+    {
+        const Record* rec = tree.search( key );
+        ASSERT_TRUE( rec );
+        ASSERT_TRUE( rec->value() == key );
+    }
+    ASSERT_TRUE( tree.search( 0 ) == nullptr );
+
+    // A non-empty tree takes the keys one by one.
+    {
+        std::ofstream out( file_name );
+        out << "6\n7";
+    }
+    ASSERT_NO_THROW( io.read_input_from_file( file_name ) );
+    ASSERT_TRUE( tree.search( 6 ) && tree.search( 7 ) );
+
+    std::remove( file_name.c_str() );
+    ASSERT_ANY_THROW( io.read_input_from_file( file_name ) );
+}
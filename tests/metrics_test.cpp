@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include "BPlusTree.hpp"
+#include "Metrics.hpp"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+
+TEST( metrics, counters_and_latencies )
+{
+    Metrics metrics;
+    ASSERT_TRUE( metrics.count( Metrics::SEARCHES ) == 0 );
+
+    std::vector< std::thread > threads;
+    for( int t = 0; t < 4; t++ )
+    {
+        threads.emplace_back( [ &metrics ]()
+        {
+            for( std::uint64_t i = 1; i <= 1000; i++ )
+            {
+                metrics.add( Metrics::SEARCHES );
+                metrics.record( Metrics::SEARCH_LATENCY, i );
+            }
+        } );
+    }
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+    metrics.add( Metrics::LEAF_SPLITS, 3 );
+
+    ASSERT_TRUE( metrics.count( Metrics::SEARCHES ) == 4000 );
+    ASSERT_TRUE( metrics.count( Metrics::LEAF_SPLITS ) == 3 );
+    const LatencyHistogram h = metrics.latency( Metrics::SEARCH_LATENCY );
+    ASSERT_TRUE( h.count() == 4000 );
+    ASSERT_TRUE( h.max() == 1000 );
+    ASSERT_TRUE( metrics.latency( Metrics::INSERT_LATENCY ).count() == 0 );
+
+    std::ostringstream oss;
+    metrics.write_prometheus( oss, "tree" );
+    const std::string text = oss.str();
+    ASSERT_TRUE( text.find( "# TYPE tree_searches_total counter\ntree_searches_total 4000\n" ) != std::string::npos );
+    ASSERT_TRUE( text.find( "tree_leaf_splits_total 3\n" ) != std::string::npos );
+    ASSERT_TRUE( text.find( "# TYPE tree_search_latency_seconds summary\n" ) != std::string::npos );
+    ASSERT_TRUE( text.find( "tree_search_latency_seconds{quantile=\"0.999\"} " ) != std::string::npos );
+    ASSERT_TRUE( text.find( "tree_search_latency_seconds_count 4000\n" ) != std::string::npos );
+
+    metrics.reset();
+    ASSERT_TRUE( metrics.count( Metrics::SEARCHES ) == 0 );
+    ASSERT_TRUE( metrics.latency( Metrics::SEARCH_LATENCY ).count() == 0 );
+}
+
+
+#ifdef BTREE_STATS
+TEST( metrics, tree_statistics )
+{
+    BPlusTree tree( 4 );
+    Metrics& metrics = tree.metrics();
+    metrics.reset();
+
+    for( std::int64_t key = 0; key < 1000; key++ )
+    {
+        tree.insert( key, key );
+    }
+    for( std::int64_t key = 0; key < 1000; key += 2 )
+    {
+        tree.search( key );
+    }
+    for( std::int64_t key = 0; key < 1000; key++ )
+    {
+        tree.remove( key );
+    }
+
+    ASSERT_TRUE( metrics.count( Metrics::INSERTS ) == 1000 );
+    ASSERT_TRUE( metrics.count( Metrics::SEARCHES ) == 500 );
+    ASSERT_TRUE( metrics.count( Metrics::REMOVES ) == 1000 );
+    ASSERT_TRUE( metrics.count( Metrics::LEAF_SPLITS ) > 0 );
+    ASSERT_TRUE( metrics.count( Metrics::INTERNAL_SPLITS ) > 0 );
+    ASSERT_TRUE( metrics.count( Metrics::COALESCES ) > 0 );
+    ASSERT_TRUE( metrics.count( Metrics::COALESCES ) + metrics.count( Metrics::REDISTRIBUTIONS ) == tree.rebalance_counters().m_merges + tree.rebalance_counters().m_redistributions );
+    ASSERT_TRUE( metrics.latency( Metrics::INSERT_LATENCY ).count() == 1000 );
+    ASSERT_TRUE( metrics.latency( Metrics::REMOVE_LATENCY ).count() == 1000 );
+}
+
+TEST( metrics, updates )
+{
+    // Read-modify-writes count as writes.
+    BPlusTree tree( 4 );
+    for( std::int64_t key = 0; key < 100; key++ )
+    {
+        tree.insert( key, key );
+    }
+    Metrics& metrics = tree.metrics();
+    metrics.reset();
+
+    for( std::int64_t key = 0; key < 200; key++ )
+    {
+        tree.update( key, []( ValueType v ){ return v + 1; } );
+    }
+    ASSERT_TRUE( metrics.count( Metrics::INSERTS ) == 200 );
+    ASSERT_TRUE( metrics.latency( Metrics::INSERT_LATENCY ).count() == 200 );
+}
+
+TEST( metrics, append_splits )
+{
+    // Appends count the nodes they start as splits.
+    BPlusTree tree( 4 );
+    tree.set_append_mode( true );
+    Metrics& metrics = tree.metrics();
+    metrics.reset();
+
+    for( std::int64_t key = 0; key < 1000; key++ )
+    {
+        tree.insert( key, key );
+    }
+
+    ASSERT_TRUE( metrics.count( Metrics::LEAF_SPLITS ) > 0 );
+    ASSERT_TRUE( metrics.count( Metrics::INTERNAL_SPLITS ) > 0 );
+    ASSERT_TRUE( metrics.count( Metrics::LEAF_SPLITS ) + metrics.count( Metrics::INTERNAL_SPLITS ) == tree.rebalance_counters().m_splits );
+}
+#endif
@@ -0,0 +1,306 @@
+#include "gtest/gtest.h"
+#include "PartitionedTree.hpp"
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+//
+// Compare every key and value of "tree" with "expected", through find()
+// and through a scan of the whole key space.
+//
+void check( const PartitionedTree& tree, const std::map< std::int64_t, ValueType >& expected )
+{
+    ASSERT_EQ( tree.size(), expected.size() );
+
+    for( const auto& kv : expected )
+    {
+        ValueType value = 0;
+        ASSERT_TRUE( tree.find( kv.first, value ) );
+        ASSERT_EQ( value, kv.second );
+    }
+
+    auto it = expected.begin();
+    const std::size_t count = tree.scan( std::numeric_limits< std::int64_t >::min(), std::numeric_limits< std::int64_t >::max(),
+        [ & ]( const KeyType& key, ValueType value )
+        {
+            ASSERT_TRUE( it != expected.end() );
+            ASSERT_EQ( key.to_int64(), it->first );
+            ASSERT_EQ( value, it->second );
+            ++it;
+        } );
+    ASSERT_EQ( count, expected.size() );
+
+    // Every partition holds only keys of its own range.
+    const std::vector< KeyType > bounds = tree.bounds();
+    const std::vector< std::size_t > sizes = tree.sizes();
+    ASSERT_EQ( bounds.size(), tree.partition_no() );
+    ASSERT_EQ( sizes.size(), tree.partition_no() );
+    auto kv = expected.begin();
+    for( std::size_t p = 0; p < bounds.size(); p++ )
+    {
+        std::size_t n = 0;
+        for( ; kv != expected.end() && ( p + 1 == bounds.size() || kv->first < bounds[ p + 1 ].to_int64() ); ++kv )
+        {
+            n++;
+        }
+        ASSERT_EQ( sizes[ p ], n );
+    }
+}
+
+}
+
+TEST( partition, routing )
+{
+    ASSERT_THROW( PartitionedTree( 4, std::vector< KeyType >{ 10, 10 } ), std::runtime_error );
+    ASSERT_THROW( PartitionedTree( 4, 0, 0, 100 ), std::runtime_error );
+
+    PartitionedTree tree( 4, std::vector< KeyType >{ 0, 100 } );
+    ASSERT_EQ( tree.partition_no(), 3u );
+    ASSERT_EQ( tree.partition_of( std::numeric_limits< std::int64_t >::min() ), 0u );
+    ASSERT_EQ( tree.partition_of( -1 ), 0u );
+    ASSERT_EQ( tree.partition_of( 0 ), 1u );
+    ASSERT_EQ( tree.partition_of( 99 ), 1u );
+    ASSERT_EQ( tree.partition_of( 100 ), 2u );
+    ASSERT_EQ( tree.partition_of( std::numeric_limits< std::int64_t >::max() ), 2u );
+
+    PartitionedTree even( 4, 4, 0, 399 );
+    ASSERT_EQ( even.partition_no(), 4u );
+    for( std::int64_t k = 0; k < 400; k++ )
+    {
+        ASSERT_EQ( even.partition_of( k ), static_cast< std::size_t >( k / 100 ) );
+    }
+
+    // The whole key space, without overflow.
+    PartitionedTree wide( 4, 8, std::numeric_limits< std::int64_t >::min(), std::numeric_limits< std::int64_t >::max() );
+    ASSERT_EQ( wide.partition_no(), 8u );
+    ASSERT_EQ( wide.partition_of( std::numeric_limits< std::int64_t >::min() ), 0u );
+    ASSERT_EQ( wide.partition_of( -1 ), 3u );
+    ASSERT_EQ( wide.partition_of( 0 ), 4u );
+    ASSERT_EQ( wide.partition_of( std::numeric_limits< std::int64_t >::max() ), 7u );
+}
+
+TEST( partition, operations )
+{
+    PartitionedTree tree( 4, 5, -1000, 1000 );
+    std::map< std::int64_t, ValueType > expected;
+    std::mt19937_64 gen( 7 );
+    std::uniform_int_distribution< std::int64_t > dist( -1200, 1200 );
+
+    for( int i = 0; i < 5000; i++ )
+    {
+        const std::int64_t key = dist( gen );
+        switch( gen() % 3 )
+        {
+        case 0:
+            if( expected.count( key ) )
+            {
+                ASSERT_THROW( tree.insert( key, key ), std::runtime_error );
+            }
+            else
+            {
+                tree.insert( key, key );
+                expected[ key ] = key;
+            }
+            break;
+        case 1:
+            ASSERT_EQ( tree.insert_or_assign( key, i ), expected.count( key ) == 0 );
+            expected[ key ] = i;
+            break;
+        default:
+            if( expected.count( key ) )
+            {
+                tree.remove( key );
+                expected.erase( key );
+            }
+            break;
+        }
+    }
+    check( tree, expected );
+
+    ValueType value = 0;
+    ASSERT_FALSE( tree.find( 5000, value ) );
+
+    // Scans across partition boundaries.
+    for( int i = 0; i < 200; i++ )
+    {
+        std::int64_t lo = dist( gen );
+        std::int64_t hi = dist( gen );
+        if( hi < lo )
+        {
+            std::swap( lo, hi );
+        }
+
+        std::vector< std::int64_t > keys;
+        const std::size_t count = tree.scan( lo, hi, [ &keys ]( const KeyType& key, ValueType ){ keys.push_back( key.to_int64() ); } );
+        std::vector< std::int64_t > want;
+        for( auto it = expected.lower_bound( lo ); it != expected.end() && it->first <= hi; ++it )
+        {
+            want.push_back( it->first );
+        }
+        ASSERT_EQ( count, want.size() );
+        ASSERT_EQ( keys, want );
+    }
+    const std::size_t empty = tree.scan( 10, 0, []( const KeyType&, ValueType ){} );
+    ASSERT_EQ( empty, 0u );
+}
+
+TEST( partition, repartition )
+{
+    PartitionedTree tree( 4, std::vector< KeyType >{} );
+    std::map< std::int64_t, ValueType > expected;
+    ASSERT_FALSE( tree.split( 0 ) );
+    ASSERT_THROW( tree.split( 1 ), std::runtime_error );
+    ASSERT_THROW( tree.merge( 0 ), std::runtime_error );
+
+    for( std::int64_t k = 0; k < 1000; k++ )
+    {
+        tree.insert( k * 3, k );
+        expected[ k * 3 ] = k;
+    }
+
+    ASSERT_TRUE( tree.split( 0 ) );
+    ASSERT_EQ( tree.partition_no(), 2u );
+    ASSERT_EQ( tree.bounds()[ 1 ].to_int64(), 1500 );
+    ASSERT_EQ( tree.sizes()[ 0 ], 500u );
+    check( tree, expected );
+
+    ASSERT_TRUE( tree.split( 1 ) );
+    ASSERT_TRUE( tree.split( 0 ) );
+    ASSERT_EQ( tree.partition_no(), 4u );
+    check( tree, expected );
+
+    // Keys between the old bounds still go where they belong.
+    tree.insert( 1499, 1 );
+    expected[ 1499 ] = 1;
+    tree.insert( 1501, 1 );
+    expected[ 1501 ] = 1;
+    check( tree, expected );
+
+    tree.merge( 1 );
+    ASSERT_EQ( tree.partition_no(), 3u );
+    check( tree, expected );
+    tree.merge( 0 );
+    tree.merge( 0 );
+    ASSERT_EQ( tree.partition_no(), 1u );
+    check( tree, expected );
+
+    // Merged partitions are reused by the next split.
+    for( int i = 0; i < 100; i++ )
+    {
+        ASSERT_TRUE( tree.split( 0 ) );
+        ASSERT_TRUE( tree.split( 1 ) );
+        tree.merge( 0 );
+        tree.merge( 0 );
+    }
+    ASSERT_EQ( tree.partition_no(), 1u );
+    check( tree, expected );
+}
+
+TEST( partition, rebalance )
+{
+    PartitionedTree tree( 4, 4, 0, 3999 );
+    std::map< std::int64_t, ValueType > expected;
+    for( std::int64_t k = 0; k < 4000; k += 2 )
+    {
+        tree.insert( k, k );
+        expected[ k ] = k;
+    }
+
+    // Even load: nothing to do.
+    ASSERT_FALSE( tree.rebalance() );
+    for( std::int64_t k = 0; k < 4000; k++ )
+    {
+        ValueType value;
+        tree.find( k, value );
+    }
+    ASSERT_FALSE( tree.rebalance() );
+
+    // Partition 2 runs hot; it is split and the two coldest neighbors,
+    // 0 and 1, are merged.
+    for( int i = 0; i < 10; i++ )
+    {
+        for( std::int64_t k = 2000; k < 3000; k++ )
+        {
+            ValueType value;
+            tree.find( k, value );
+        }
+    }
+    ASSERT_TRUE( tree.rebalance() );
+    ASSERT_EQ( tree.partition_no(), 4u );
+    const std::vector< KeyType > bounds = tree.bounds();
+    ASSERT_EQ( bounds[ 1 ].to_int64(), 2000 );
+    ASSERT_EQ( bounds[ 2 ].to_int64(), 2500 );
+    ASSERT_EQ( bounds[ 3 ].to_int64(), 3000 );
+    check( tree, expected );
+}
+
+TEST( partition, concurrent )
+{
+    const int THREAD_NO = 4;
+    const std::int64_t KEY_NO = 20000;
+
+    PartitionedTree tree( 8, THREAD_NO, 0, THREAD_NO * KEY_NO - 1 );
+    std::atomic< bool > done{ false };
+
+    // Splits and merges while the writers run.
+    std::thread repartitioner( [ & ]()
+    {
+        std::mt19937_64 gen( 3 );
+        while( !done.load() )
+        {
+            const std::size_t n = tree.partition_no();
+            if( n < 2 || ( n < 16 && gen() % 2 ) )
+            {
+                tree.split( gen() % n );
+            }
+            else
+            {
+                tree.merge( gen() % ( n - 1 ) );
+            }
+            tree.rebalance();
+            std::this_thread::yield();
+        }
+    } );
+
+    std::vector< std::thread > writers;
+    for( int t = 0; t < THREAD_NO; t++ )
+    {
+        writers.emplace_back( [ &tree, t, KEY_NO ]()
+        {
+            const std::int64_t base = t * KEY_NO;
+            for( std::int64_t k = 0; k < KEY_NO; k++ )
+            {
+                tree.insert( base + k, base + k );
+                if( k % 4 == 3 )
+                {
+                    tree.remove( base + k - 2 );
+                }
+            }
+        } );
+    }
+    for( auto& w : writers )
+    {
+        w.join();
+    }
+    done.store( true );
+    repartitioner.join();
+
+    std::map< std::int64_t, ValueType > expected;
+    for( std::int64_t k = 0; k < THREAD_NO * KEY_NO; k++ )
+    {
+        if( k % KEY_NO % 4 != 1 )
+        {
+            expected[ k ] = k;
+        }
+    }
+    check( tree, expected );
+}
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "BPlusTree.hpp"
+#include "PerfCounters.hpp"
+#include "PerfProfile.hpp"
+#include <cstdint>
+#include <string>
+#include <sys/mman.h>
+
+
+
+TEST( perf, counters )
+{
+    PerfCounters counters;
+    const PerfCounters::Values zero = counters.read();
+    for( auto v : zero )
+    {
+        ASSERT_TRUE( v == 0 );
+    }
+
+    // Blocked perf events are not an error; nothing is counted then.
+    if( !counters.available() )
+    {
+        for( int e = 0; e < PerfCounters::EVENT_NO; e++ )
+        {
+            ASSERT_FALSE( counters.available( static_cast< PerfCounters::Event >( e ) ) );
+        }
+        counters.start();
+        counters.stop();
+        return;
+    }
+
+    // A fresh mapping, so that its pages fault in on first touch whatever
+    // the heap holds after the tests before.
+    const std::size_t size = std::size_t( 1 ) << 20;
+    void* memory = mmap( nullptr, size * sizeof( std::uint64_t ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    ASSERT_TRUE( memory != MAP_FAILED );
+    std::uint64_t* v = static_cast< std::uint64_t* >( memory );
+
+    counters.start();
+    for( std::size_t i = 0; i < size; i++ )
+    {
+        v[ i ] = i * i;
+    }
+    counters.stop();
+    const PerfCounters::Values first = counters.read();
+
+    // Stopped counters stand still.
+    for( std::size_t i = 0; i < size; i++ )
+    {
+        v[ i ] += i;
+    }
+    const PerfCounters::Values second = counters.read();
+    for( int e = 0; e < PerfCounters::EVENT_NO; e++ )
+    {
+        ASSERT_TRUE( first[ e ] == second[ e ] );
+    }
+
+    if( counters.available( PerfCounters::INSTRUCTIONS ) )
+    {
+        ASSERT_TRUE( first[ PerfCounters::INSTRUCTIONS ] > size );
+    }
+    if( counters.available( PerfCounters::TASK_CLOCK ) )
+    {
+        ASSERT_TRUE( first[ PerfCounters::TASK_CLOCK ] > 0 );
+    }
+    if( counters.available( PerfCounters::PAGE_FAULTS ) )
+    {
+        ASSERT_TRUE( first[ PerfCounters::PAGE_FAULTS ] > 0 );
+    }
+    munmap( memory, size * sizeof( std::uint64_t ) );
+
+    counters.reset();
+    ASSERT_TRUE( counters.read()[ PerfCounters::TASK_CLOCK ] == 0 );
+    ASSERT_TRUE( std::string( PerfCounters::name( PerfCounters::LLC_MISSES ) ) == "llc_misses" );
+}
+
+
+TEST( perf, profile_regions )
+{
+    PerfProfile::reset();
+    {
+        const PerfProfile::Scope outer( PerfProfile::MERGE );
+        const PerfProfile::Scope inner( PerfProfile::MERGE );
+    }
+    ASSERT_TRUE( PerfProfile::totals( PerfProfile::MERGE ).m_calls == 1 );
+    ASSERT_TRUE( PerfProfile::totals( PerfProfile::SPLIT ).m_calls == 0 );
+
+#ifdef BTREE_PERF
+    PerfProfile::reset();
+    BPlusTree tree( 4 );
+    for( std::int64_t key = 0; key < 1000; key++ )
+    {
+        tree.insert( key, key );
+    }
+    for( std::int64_t key = 0; key < 1000; key++ )
+    {
+        ASSERT_TRUE( tree.search( key ) );
+    }
+    for( std::int64_t key = 0; key < 1000; key++ )
+    {
+        tree.remove( key );
+    }
+    ASSERT_TRUE( PerfProfile::totals( PerfProfile::FIND_LEAF ).m_calls >= 2000 );
+    ASSERT_TRUE( PerfProfile::totals( PerfProfile::LEAF_LOOKUP ).m_calls >= 1000 );
+    ASSERT_TRUE( PerfProfile::totals( PerfProfile::SPLIT ).m_calls > 0 );
+    ASSERT_TRUE( PerfProfile::totals( PerfProfile::MERGE ).m_calls > 0 );
+#endif
+}
@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+#include "PostingList.hpp"
+#include <random>
+#include <set>
+#include <vector>
+
+
+
+namespace
+{
+
+std::vector< ValueType > contents( const PostingList& list )
+{
+    std::vector< ValueType > v;
+    list.for_each( [ &v ]( ValueType x ){ v.push_back( x ); } );
+    return v;
+}
+
+}
+
+
+TEST( posting_list, append )
+{
+    PostingList list;
+    for( ValueType v = 0; v < 10000; v += 3 )
+    {
+        list.insert( v );
+    }
+
+    ASSERT_TRUE( list.size() == 3334 );
+    ASSERT_TRUE( list.front() == 0 );
+
+    const auto v = contents( list );
+    for( std::size_t i = 0; i < v.size(); i++ )
+    {
+        ASSERT_TRUE( v[ i ] == ValueType( 3 * i ) );
+    }
+
+    // Gaps of 3 need two bits each instead of a full 64-bit value.
+    ASSERT_TRUE( list.bytes() < list.size() * sizeof( ValueType ) / 4 );
+}
+
+
+TEST( posting_list, random_against_multiset )
+{
+    std::mt19937 rng;
+    std::uniform_int_distribution< int > dist_op( 0, 9 );
+    const std::vector< ValueType > extremes{ INT64_MIN, INT64_MIN + 1, -1, 0, 1, INT64_MAX - 1, INT64_MAX };
+
+    for( ValueType range : { ValueType( 10 ), ValueType( 1000 ), INT64_MAX } )
+    {
+        std::uniform_int_distribution< ValueType > dist( -range, range );
+        std::multiset< ValueType > expected;
+        PostingList list;
+
+        for( std::size_t i = 0; i < 5000; i++ )
+        {
+            const int op = dist_op( rng );
+            const ValueType value = ( op == 0 ) ? extremes[ i % extremes.size() ] : dist( rng );
+
+            if( op < 7 )
+            {
+                expected.insert( value );
+                list.insert( value );
+            }
+            else
+            {
+                const auto it = expected.find( value );
+                ASSERT_TRUE( list.remove( value ) == ( it != expected.end() ) );
+                if( it != expected.end() )
+                {
+                    expected.erase( it );
+                }
+            }
+
+            ASSERT_TRUE( list.size() == expected.size() );
+        }
+
+        const auto v = contents( list );
+        ASSERT_TRUE( std::vector< ValueType >( expected.begin(), expected.end() ) == v );
+
+        for( auto value : v )
+        {
+            ASSERT_TRUE( list.remove( value ) );
+        }
+        ASSERT_TRUE( list.empty() );
+    }
+}
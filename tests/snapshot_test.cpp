@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+#include "BPlusTree.hpp"
+#include "BulkLoader.hpp"
+#include "Snapshot.hpp"
+#include <random>
+#include <map>
+#include <sstream>
+
+
+
+TEST( bulk_loader, build_and_modify )
+{
+    for( std::size_t order = 3; order <= 12; order++ )
+    {
+        for( std::size_t item_no : { 0, 1, 2, 7, 100, 1001 } )
+        {
+            BPlusTree tree( order );
+            BulkLoader loader( tree );
+            for( std::size_t i = 0; i < item_no; i++ )
+            {
+                loader.append( KeyType( 2 * i ), 2 * i );
+            }
+            loader.finish();
+
+            ASSERT_TRUE( tree.is_empty() == ( item_no == 0 ) );
+
+            for( std::size_t i = 0; i < item_no; i++ )
+            {
+                const Record* rec = tree.search( 2 * i );
+                ASSERT_TRUE( rec );
+                ASSERT_TRUE( rec->value() == ValueType( 2 * i ) );
+                ASSERT_TRUE( tree.search( 2 * i + 1 ) == nullptr );
+            }
+
+            for( std::size_t i = 0; i < item_no; i++ )
+            {
+                ASSERT_NO_THROW( tree.insert( 2 * i + 1, 2 * i + 1 ) );
+            }
+
+            for( std::size_t i = 0; i < 2 * item_no; i++ )
+            {
+                tree.remove( i );
+            }
+
+            ASSERT_TRUE( tree.is_empty() );
+        }
+    }
+}
+
+
+TEST( bulk_loader, rejects_unsorted )
+{
+    BPlusTree tree( 4 );
+    BulkLoader loader( tree );
+    loader.append( 5, 5 );
+    ASSERT_ANY_THROW( loader.append( 5, 5 ) );
+    ASSERT_ANY_THROW( loader.append( 4, 4 ) );
+
+    BPlusTree full( 4 );
+    full.insert( 1, 1 );
+    ASSERT_ANY_THROW( BulkLoader{ full } );
+}
+
+
+TEST( snapshot, round_trip )
+{
+    std::mt19937 rng;
+    std::uniform_int_distribution< std::int64_t > dist;
+
+    for( bool compress : { false, true } )
+    {
+        std::map< std::int64_t, ValueType > smap;
+        BPlusTree tree( 7 );
+        for( std::size_t i = 0; i < 10000; i++ )
+        {
+            const std::int64_t key = dist( rng ) >> ( i % 40 );
+            if( smap.insert( std::make_pair( key, dist( rng ) ) ).second )
+            {
+                tree.insert( key, smap[ key ] );
+            }
+        }
+
+        std::stringstream first;
+        Snapshot( tree ).save( first, compress );
+
+        BPlusTree copy( 5 );
+        Snapshot( copy ).load( first );
+
+        for( auto v : smap )
+        {
+            const Record* rec = copy.search( v.first );
+            ASSERT_TRUE( rec );
+            ASSERT_TRUE( rec->value() == v.second );
+        }
+
+        std::stringstream second;
+        Snapshot( copy ).save( second, compress );
+        // Only the header (which records the order) may differ.
+        ASSERT_TRUE( first.str().substr( 40 ) == second.str().substr( 40 ) );
+    }
+}
+
+
+TEST( snapshot, empty_tree )
+{
+    BPlusTree tree( 4 );
+    std::stringstream ss;
+    Snapshot( tree ).save( ss, true );
+
+    BPlusTree copy( 4 );
+    Snapshot( copy ).load( ss );
+    ASSERT_TRUE( copy.is_empty() );
+}
+
+
+TEST( snapshot, detects_corruption )
+{
+    BPlusTree tree( 4 );
+    for( std::int64_t i = 0; i < 100; i++ )
+    {
+        tree.insert( i, i );
+    }
+
+    std::stringstream ss;
+    Snapshot( tree ).save( ss );
+    const std::string image = ss.str();
+
+    for( std::size_t pos : { std::size_t( 0 ), std::size_t( 30 ), image.size() - 1 } )
+    {
+        std::string bad = image;
+        bad[ pos ] ^= 0x10;
+        std::stringstream in( bad );
+        BPlusTree copy( 4 );
+        ASSERT_ANY_THROW( Snapshot( copy ).load( in ) );
+    }
+
+    std::stringstream truncated( image.substr( 0, image.size() - 8 ) );
+    BPlusTree copy( 4 );
+    ASSERT_ANY_THROW( Snapshot( copy ).load( truncated ) );
+}
+
+
+TEST( snapshot, duplicates )
+{
+    for( bool compress : { false, true } )
+    {
+        BPlusTree tree( 4, true );
+        for( std::int64_t i = 0; i < 3000; i++ )
+        {
+            tree.insert( i % 101, INT64_MAX - i );
+            tree.insert( i % 101, -i );
+        }
+
+        std::stringstream ss;
+        Snapshot( tree ).save( ss, compress );
+        const std::string image = ss.str();
+
+        BPlusTree unique( 4 );
+        ASSERT_ANY_THROW( Snapshot( unique ).load( ss ) );
+
+        std::stringstream in( image );
+        BPlusTree copy( 6, true );
+        Snapshot( copy ).load( in );
+
+        for( std::int64_t key = 0; key < 101; key++ )
+        {
+            ASSERT_TRUE( copy.search( key ) );
+            ASSERT_TRUE( copy.search( key )->values() == tree.search( key )->values() );
+        }
+    }
+}
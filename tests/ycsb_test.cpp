@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+#include "BPlusTree.hpp"
+#include "Driver.hpp"
+#include "LatencyHistogram.hpp"
+#include "Mix.hpp"
+#include "Trace.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+
+TEST( ycsb, latency_histogram )
+{
+    LatencyHistogram h;
+    ASSERT_TRUE( h.percentile( 0.5 ) == 0 );
+
+    for( std::uint64_t ns = 1; ns <= 10000; ns++ )
+    {
+        h.record( ns );
+    }
+    ASSERT_TRUE( h.count() == 10000 );
+    ASSERT_TRUE( h.max() == 10000 );
+    ASSERT_NEAR( h.mean(), 5000.5, 1e-6 );
+
+    // Exact below 32, within 1/16 above.
+    ASSERT_TRUE( h.percentile( 0.001 ) == 10 );
+    for( double p : { 0.5, 0.99, 0.999 } )
+    {
+        const double expected = p * 10000;
+        const double got = static_cast< double >( h.percentile( p ) );
+        ASSERT_TRUE( got >= expected && got <= expected * 17 / 16 );
+    }
+    ASSERT_TRUE( h.percentile( 1.0 ) == 10000 );
+
+    LatencyHistogram other;
+    other.record( std::uint64_t( -1 ) );
+    h.merge( other );
+    ASSERT_TRUE( h.count() == 10001 );
+    ASSERT_TRUE( h.percentile( 1.0 ) == std::uint64_t( -1 ) );
+}
+
+
+TEST( ycsb, trace_round_trip )
+{
+    const std::vector< Operation > ops{
+        { OpType::READ, 7, 0 }, { OpType::UPDATE, -3, 9 }, { OpType::INSERT, 100, -1 },
+        { OpType::SCAN, 5, 20 }, { OpType::READ_MODIFY_WRITE, 8, 4 } };
+
+    std::stringstream ss;
+    Trace::write( ss, ops );
+    ss << "\n# comment\n";
+    const auto back = Trace::read( ss );
+
+    ASSERT_TRUE( back.size() == ops.size() );
+    for( std::size_t i = 0; i < ops.size(); i++ )
+    {
+        ASSERT_TRUE( back[ i ].m_type == ops[ i ].m_type );
+        ASSERT_TRUE( back[ i ].m_key == ops[ i ].m_key );
+        ASSERT_TRUE( back[ i ].m_arg == ops[ i ].m_arg );
+    }
+
+    for( std::string line : { "READ", "READ x", "WRITE 1 2", "UPDATE 1", "SCAN 1 0", "READ 1 2" } )
+    {
+        std::istringstream in( line );
+        ASSERT_ANY_THROW( Trace::read( in ) );
+    }
+}
+
+
+TEST( ycsb, standard_mixes )
+{
+    ASSERT_ANY_THROW( Mix::standard( "G" ) );
+    ASSERT_ANY_THROW( Mix::parse_distribution( "normal" ) );
+
+    const std::uint64_t record_no = 1000;
+    for( const char* name : { "a", "B", "C", "D", "E", "F" } )
+    {
+        const Mix mix = Mix::standard( name );
+        const auto ops = mix.generate( record_no, 20000, 1 );
+
+        std::size_t counts[ OP_TYPE_NO ] = {};
+        std::int64_t next_insert = static_cast< std::int64_t >( record_no );
+        for( const auto& op : ops )
+        {
+            counts[ static_cast< std::size_t >( op.m_type ) ]++;
+            if( op.m_type == OpType::INSERT )
+            {
+                ASSERT_TRUE( op.m_key == next_insert++ );
+            }
+            else
+            {
+                ASSERT_TRUE( op.m_key >= 0 && op.m_key < next_insert );
+            }
+            if( op.m_type == OpType::SCAN )
+            {
+                ASSERT_TRUE( op.m_arg >= 1 && op.m_arg <= mix.m_max_scan_length );
+            }
+        }
+
+        const double shares[ OP_TYPE_NO ] = { mix.m_read, mix.m_update, mix.m_insert, mix.m_scan, mix.m_read_modify_write };
+        for( std::size_t i = 0; i < OP_TYPE_NO; i++ )
+        {
+            ASSERT_NEAR( static_cast< double >( counts[ i ] ) / ops.size(), shares[ i ], 0.02 );
+        }
+    }
+
+    // "latest" favours the newest keys, the scrambled Zipfian does not.
+    Mix mix = Mix::standard( "C" );
+    for( auto distribution : { Distribution::LATEST, Distribution::ZIPFIAN, Distribution::UNIFORM } )
+    {
+        mix.m_distribution = distribution;
+        std::size_t newest = 0;
+        for( const auto& op : mix.generate( record_no, 10000, 2 ) )
+        {
+            newest += ( op.m_key >= static_cast< std::int64_t >( record_no ) - 10 ) ? 1 : 0;
+        }
+        if( distribution == Distribution::LATEST )
+        {
+            ASSERT_TRUE( newest > 3000 );
+        }
+        else
+        {
+            ASSERT_TRUE( newest < 2000 );
+        }
+    }
+}
+
+
+TEST( ycsb, driver )
+{
+    BPlusTree empty( 4 );
+    ASSERT_ANY_THROW( Driver( empty, 0 ) );
+
+    const std::uint64_t record_no = 2000;
+    for( std::size_t thread_no : { 1, 4 } )
+    {
+        BPlusTree tree( 16 );
+        Driver driver( tree, thread_no );
+        driver.load( record_no );
+        ASSERT_TRUE( tree.size() == record_no );
+
+        Mix mix = Mix::standard( "D" );
+        mix.m_update = 0.2;
+        mix.m_scan = 0.1;
+        mix.m_read_modify_write = 0.1;
+        const auto ops = mix.generate( record_no, 5000, 3 );
+        const Report report = driver.run( ops );
+
+        std::size_t inserts = 0;
+        for( const auto& op : ops )
+        {
+            inserts += ( op.m_type == OpType::INSERT ) ? 1 : 0;
+        }
+        ASSERT_TRUE( tree.size() == record_no + inserts );
+
+        std::uint64_t total = 0;
+        for( const auto& h : report.m_latency )
+        {
+            total += h.count();
+        }
+        ASSERT_TRUE( total == ops.size() );
+        ASSERT_TRUE( report.m_seconds > 0 );
+
+        std::ostringstream oss;
+        report.print( oss );
+        ASSERT_TRUE( oss.str().find( "p999" ) != std::string::npos );
+    }
+}
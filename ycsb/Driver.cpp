@@ -0,0 +1,192 @@
+#include <chrono>
+#include <iomanip>
+#include <pthread.h>
+#include <stdexcept>
+#include <thread>
+#include "Driver.hpp"
+#include "Trace.hpp"
+
+namespace
+{
+
+//
+//
+//
+class RwLock
+{
+public:
+    RwLock() { pthread_rwlock_init( &m_lock, nullptr ); }
+    ~RwLock() { pthread_rwlock_destroy( &m_lock ); }
+
+    RwLock( const RwLock& ) = delete;
+    RwLock& operator=( const RwLock& ) = delete;
+
+    void lock_shared() { pthread_rwlock_rdlock( &m_lock ); }
+    void lock() { pthread_rwlock_wrlock( &m_lock ); }
+    void unlock() { pthread_rwlock_unlock( &m_lock ); }
+
+private:
+    pthread_rwlock_t m_lock;
+};
+
+//
+//
+//
+bool is_read_only( OpType type )
+{
+    return type == OpType::READ || type == OpType::SCAN;
+}
+
+//
+//
+//
+void execute( BPlusTree& tree, const Operation& op )
+{
+    switch( op.m_type )
+    {
+    case OpType::READ:
+        tree.search( op.m_key );
+        break;
+    case OpType::UPDATE:
+    case OpType::INSERT:
+        tree.insert_or_assign( op.m_key, op.m_arg );
+        break;
+    case OpType::SCAN:
+        tree.scan( op.m_key, op.m_key + op.m_arg - 1, []( const KeyType&, const Record* ){} );
+        break;
+    case OpType::READ_MODIFY_WRITE:
+    {
+        const std::int64_t arg = op.m_arg;
+        tree.update( op.m_key, [ arg ]( ValueType v ){ return v ^ arg; } );
+        break;
+    }
+    }
+}
+
+}
+
+//
+//
+//
+void Report::print( std::ostream& out ) const
+{
+    LatencyHistogram total;
+    for( const auto& h : m_latency )
+    {
+        total.merge( h );
+    }
+
+    out << std::fixed << std::setprecision( 3 );
+    out << "operations: " << total.count() << "\n";
+    out << "seconds:    " << m_seconds << "\n";
+    out << "throughput: " << std::setprecision( 0 ) << ( m_seconds > 0 ? static_cast< double >( total.count() ) / m_seconds : 0.0 ) << " ops/s\n";
+
+    out << std::setprecision( 3 );
+    out << "\n" << std::left << std::setw( 8 ) << "op" << std::right
+        << std::setw( 12 ) << "count" << std::setw( 12 ) << "mean us"
+        << std::setw( 12 ) << "p50 us" << std::setw( 12 ) << "p99 us"
+        << std::setw( 12 ) << "p999 us" << std::setw( 12 ) << "max us" << "\n";
+
+    const auto row = [ &out ]( const char* name, const LatencyHistogram& h )
+    {
+        out << std::left << std::setw( 8 ) << name << std::right
+            << std::setw( 12 ) << h.count()
+            << std::setw( 12 ) << h.mean() / 1e3
+            << std::setw( 12 ) << static_cast< double >( h.percentile( 0.5 ) ) / 1e3
+            << std::setw( 12 ) << static_cast< double >( h.percentile( 0.99 ) ) / 1e3
+            << std::setw( 12 ) << static_cast< double >( h.percentile( 0.999 ) ) / 1e3
+            << std::setw( 12 ) << static_cast< double >( h.max() ) / 1e3 << "\n";
+    };
+
+    for( std::size_t i = 0; i < OP_TYPE_NO; i++ )
+    {
+        if( m_latency[ i ].count() )
+        {
+            row( Trace::name( static_cast< OpType >( i ) ), m_latency[ i ] );
+        }
+    }
+    row( "ALL", total );
+}
+
+//
+//
+//
+Driver::Driver( BPlusTree& tree, std::size_t thread_no )
+    : m_tree( tree )
+    , m_thread_no{ thread_no }
+{
+    if( !m_thread_no )
+    {
+        throw std::runtime_error( "The driver needs at least one thread" );
+    }
+}
+
+//
+//
+//
+void Driver::load( std::uint64_t record_no )
+{
+    for( std::uint64_t key = 0; key < record_no; key++ )
+    {
+        const std::int64_t k = static_cast< std::int64_t >( key );
+        m_tree.insert_or_assign( k, k );
+    }
+}
+
+//
+//
+//
+Report Driver::run( const std::vector< Operation >& ops )
+{
+    using Clock = std::chrono::steady_clock;
+
+    RwLock lock;
+    std::vector< std::array< LatencyHistogram, OP_TYPE_NO > > latency( m_thread_no );
+
+    const auto worker = [ & ]( std::size_t t )
+    {
+        for( std::size_t i = t; i < ops.size(); i += m_thread_no )
+        {
+            const Operation& op = ops[ i ];
+            const bool shared = is_read_only( op.m_type );
+
+            const auto start = Clock::now();
+            if( shared )
+            {
+                lock.lock_shared();
+            }
+            else
+            {
+                lock.lock();
+            }
+            execute( m_tree, op );
+            lock.unlock();
+            const auto ns = std::chrono::duration_cast< std::chrono::nanoseconds >( Clock::now() - start ).count();
+
+            latency[ t ][ static_cast< std::size_t >( op.m_type ) ].record( static_cast< std::uint64_t >( ns ) );
+        }
+    };
+
+    const auto start = Clock::now();
+    std::vector< std::thread > threads;
+    for( std::size_t t = 1; t < m_thread_no; t++ )
+    {
+        threads.emplace_back( worker, t );
+    }
+    worker( 0 );
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    Report report;
+    report.m_seconds = std::chrono::duration< double >( Clock::now() - start ).count();
+    for( const auto& h : latency )
+    {
+        for( std::size_t i = 0; i < OP_TYPE_NO; i++ )
+        {
+            report.m_latency[ i ].merge( h[ i ] );
+        }
+    }
+    return report;
+}
@@ -0,0 +1,49 @@
+#ifndef ROMZ_AMITTAI_BTREE_DRIVER_H
+#define ROMZ_AMITTAI_BTREE_DRIVER_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "BPlusTree.hpp"
+#include "LatencyHistogram.hpp"
+#include "Operation.hpp"
+
+//
+// Throughput and latencies of one run, per operation type.
+//
+class Report
+{
+public:
+    void print( std::ostream& out ) const;
+
+public:
+    double m_seconds = 0;
+    std::array< LatencyHistogram, OP_TYPE_NO > m_latency;
+};
+
+//
+// Runs operations against a tree on several threads.
+//
+// The tree does no locking of its own, so the driver takes a
+// readers-writer lock around each operation: reads and scans share it,
+// updates, inserts and read-modify-writes hold it alone. Thread "t" of
+// "n" executes the operations t, t + n, t + 2n, ... in order.
+//
+class Driver
+{
+public:
+    Driver( BPlusTree& tree, std::size_t thread_no );
+    ~Driver() = default;
+
+    /// Insert keys 0 .. record_no - 1 with values equal to the keys.
+    void load( std::uint64_t record_no );
+
+    Report run( const std::vector< Operation >& ops );
+
+private:
+    BPlusTree& m_tree;
+    std::size_t m_thread_no;
+};
+
+#endif
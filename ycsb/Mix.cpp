@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <stdexcept>
+#include "Mix.hpp"
+#include "Zipfian.hpp"
+
+//
+//
+//
+Mix Mix::standard( const std::string& name )
+{
+    Mix mix;
+    const char letter = ( name.size() == 1 ) ? static_cast< char >( std::toupper( name[ 0 ] ) ) : '?';
+    switch( letter )
+    {
+    case 'A':
+        mix.m_read = 0.5;
+        mix.m_update = 0.5;
+        break;
+    case 'B':
+        mix.m_read = 0.95;
+        mix.m_update = 0.05;
+        break;
+    case 'C':
+        mix.m_read = 1.0;
+        break;
+    case 'D':
+        mix.m_read = 0.95;
+        mix.m_insert = 0.05;
+        mix.m_distribution = Distribution::LATEST;
+        break;
+    case 'E':
+        mix.m_scan = 0.95;
+        mix.m_insert = 0.05;
+        break;
+    case 'F':
+        mix.m_read = 0.5;
+        mix.m_read_modify_write = 0.5;
+        break;
+    default:
+        throw std::runtime_error( "Unknown workload: " + name );
+    }
+    return mix;
+}
+
+//
+//
+//
+Distribution Mix::parse_distribution( const std::string& name )
+{
+    if( name == "uniform" )
+    {
+        return Distribution::UNIFORM;
+    }
+    if( name == "zipfian" )
+    {
+        return Distribution::ZIPFIAN;
+    }
+    if( name == "latest" )
+    {
+        return Distribution::LATEST;
+    }
+    throw std::runtime_error( "Unknown key distribution: " + name );
+}
+
+//
+// The Zipfian ranks are drawn over the initial keys; "latest" counts
+// them back from the newest key.
+//
+std::vector< Operation > Mix::generate( std::uint64_t record_no, std::uint64_t operation_no, std::uint64_t seed ) const
+{
+    if( !record_no )
+    {
+        throw std::runtime_error( "The workload needs at least one record" );
+    }
+
+    std::mt19937_64 rng( seed );
+    std::uniform_real_distribution< double > coin( 0.0, m_read + m_update + m_insert + m_scan + m_read_modify_write );
+    std::uniform_int_distribution< std::int64_t > scan_length( 1, m_max_scan_length );
+    std::uniform_int_distribution< std::int64_t > value;
+    Zipfian zipf( record_no, 0.99, m_distribution != Distribution::LATEST );
+
+    std::uint64_t key_no = record_no;
+    const auto choose_key = [ & ]() -> std::int64_t
+    {
+        switch( m_distribution )
+        {
+        case Distribution::UNIFORM:
+            return static_cast< std::int64_t >( std::uniform_int_distribution< std::uint64_t >( 0, key_no - 1 )( rng ) );
+        case Distribution::ZIPFIAN:
+            return static_cast< std::int64_t >( zipf( rng ) );
+        case Distribution::LATEST:
+            break;
+        }
+        return static_cast< std::int64_t >( key_no - 1 - zipf( rng ) );
+    };
+
+    std::vector< Operation > ops( operation_no );
+    for( auto& op : ops )
+    {
+        double c = coin( rng );
+        if( ( c -= m_read ) < 0 )
+        {
+            op = Operation{ OpType::READ, choose_key(), 0 };
+        }
+        else if( ( c -= m_update ) < 0 )
+        {
+            op = Operation{ OpType::UPDATE, choose_key(), value( rng ) };
+        }
+        else if( ( c -= m_insert ) < 0 )
+        {
+            op = Operation{ OpType::INSERT, static_cast< std::int64_t >( key_no++ ), value( rng ) };
+        }
+        else if( ( c -= m_scan ) < 0 )
+        {
+            op = Operation{ OpType::SCAN, choose_key(), scan_length( rng ) };
+        }
+        else
+        {
+            op = Operation{ OpType::READ_MODIFY_WRITE, choose_key(), value( rng ) };
+        }
+    }
+    return ops;
+}
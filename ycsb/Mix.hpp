@@ -0,0 +1,54 @@
+#ifndef ROMZ_AMITTAI_BTREE_MIX_H
+#define ROMZ_AMITTAI_BTREE_MIX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Operation.hpp"
+
+enum class Distribution
+{
+    UNIFORM,
+    ZIPFIAN,
+    LATEST
+};
+
+//
+// Operation proportions and key distribution of a workload, after the
+// core workloads of YCSB (Cooper et al., "Benchmarking Cloud Serving
+// Systems with YCSB", SoCC 2010).
+//
+// The tree is loaded with keys 0 .. record_no - 1, and inserts add the
+// following keys in order. Requests choose among the keys inserted so
+// far: uniformly, with scrambled Zipfian popularity, or with Zipfian
+// popularity favouring the latest inserts.
+//
+class Mix
+{
+public:
+    /// Workloads "A" to "F" (case-insensitive):
+    /// A 50% reads, 50% updates, Zipfian;
+    /// B 95% reads, 5% updates, Zipfian;
+    /// C 100% reads, Zipfian;
+    /// D 95% reads, 5% inserts, latest;
+    /// E 95% scans of up to 100 keys, 5% inserts, Zipfian;
+    /// F 50% reads, 50% read-modify-writes, Zipfian.
+    static Mix standard( const std::string& name );
+
+    static Distribution parse_distribution( const std::string& name );
+
+    /// "operation_no" requests against a tree loaded with "record_no" keys.
+    std::vector< Operation > generate( std::uint64_t record_no, std::uint64_t operation_no, std::uint64_t seed ) const;
+
+public:
+    double m_read = 0;
+    double m_update = 0;
+    double m_insert = 0;
+    double m_scan = 0;
+    double m_read_modify_write = 0;
+
+    Distribution m_distribution = Distribution::ZIPFIAN;
+    std::int64_t m_max_scan_length = 100;
+};
+
+#endif
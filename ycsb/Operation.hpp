@@ -0,0 +1,28 @@
+#ifndef ROMZ_AMITTAI_BTREE_OPERATION_H
+#define ROMZ_AMITTAI_BTREE_OPERATION_H
+
+#include <cstdint>
+
+enum class OpType
+{
+    READ,
+    UPDATE,
+    INSERT,
+    SCAN,
+    READ_MODIFY_WRITE
+};
+
+const std::size_t OP_TYPE_NO = 5;
+
+//
+// One request of a workload. "m_arg" is the value written by updates,
+// inserts and read-modify-writes, and the number of keys read by scans.
+//
+struct Operation
+{
+    OpType m_type;
+    std::int64_t m_key;
+    std::int64_t m_arg;
+};
+
+#endif
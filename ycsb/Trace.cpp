@@ -0,0 +1,91 @@
+#include <sstream>
+#include <stdexcept>
+#include "Trace.hpp"
+
+//
+//
+//
+void Trace::write( std::ostream& out, const std::vector< Operation >& ops )
+{
+    for( const auto& op : ops )
+    {
+        out << name( op.m_type ) << ' ' << op.m_key;
+        if( op.m_type != OpType::READ )
+        {
+            out << ' ' << op.m_arg;
+        }
+        out << '\n';
+    }
+}
+
+//
+//
+//
+std::vector< Operation > Trace::read( std::istream& in )
+{
+    std::vector< Operation > ops;
+    std::string line;
+    std::size_t line_no = 0;
+    while( std::getline( in, line ) )
+    {
+        line_no++;
+        std::istringstream iss( line );
+        std::string word;
+        if( !( iss >> word ) || word[ 0 ] == '#' )
+        {
+            continue;
+        }
+
+        Operation op{ OpType::READ, 0, 0 };
+        bool known = false;
+        for( std::size_t i = 0; i < OP_TYPE_NO; i++ )
+        {
+            if( word == name( static_cast< OpType >( i ) ) )
+            {
+                op.m_type = static_cast< OpType >( i );
+                known = true;
+            }
+        }
+
+        bool ok = known && ( iss >> op.m_key );
+        if( ok && op.m_type != OpType::READ )
+        {
+            ok = static_cast< bool >( iss >> op.m_arg );
+        }
+        if( ok && op.m_type == OpType::SCAN )
+        {
+            ok = op.m_arg > 0;
+        }
+        if( ok && ( iss >> word ) )
+        {
+            ok = false;
+        }
+        if( !ok )
+        {
+            throw std::runtime_error( "Malformed trace line " + std::to_string( line_no ) + ": " + line );
+        }
+        ops.push_back( op );
+    }
+    return ops;
+}
+
+//
+//
+//
+const char* Trace::name( OpType type )
+{
+    switch( type )
+    {
+    case OpType::READ:
+        return "READ";
+    case OpType::UPDATE:
+        return "UPDATE";
+    case OpType::INSERT:
+        return "INSERT";
+    case OpType::SCAN:
+        return "SCAN";
+    case OpType::READ_MODIFY_WRITE:
+        break;
+    }
+    return "RMW";
+}
@@ -0,0 +1,32 @@
+#ifndef ROMZ_AMITTAI_BTREE_TRACE_H
+#define ROMZ_AMITTAI_BTREE_TRACE_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Operation.hpp"
+
+//
+// Text file of operations, one per line:
+//
+//    READ <key>
+//    UPDATE <key> <value>
+//    INSERT <key> <value>
+//    SCAN <key> <length>
+//    RMW <key> <value>
+//
+// Empty lines and lines starting with '#' are skipped.
+//
+class Trace
+{
+public:
+    static void write( std::ostream& out, const std::vector< Operation >& ops );
+
+    /// Throws std::runtime_error on a malformed line.
+    static std::vector< Operation > read( std::istream& in );
+
+    static const char* name( OpType type );
+};
+
+#endif
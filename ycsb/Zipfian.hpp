@@ -0,0 +1,86 @@
+#ifndef ROMZ_AMITTAI_BTREE_ZIPFIAN_H
+#define ROMZ_AMITTAI_BTREE_ZIPFIAN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+//
+// Ranks in [0, n) with P( rank i ) proportional to 1 / ( i + 1 )^theta,
+// drawn in constant time by the method of Gray et al., "Quickly
+// Generating Billion-Record Synthetic Databases" (SIGMOD 1994), as in
+// YCSB. With "scrambled" the ranks are hashed over [0, n), so that the
+// popular keys are spread over the key space instead of clustered at
+// its start.
+//
+class Zipfian
+{
+public:
+    Zipfian( std::uint64_t n, double theta = 0.99, bool scrambled = true )
+        : m_n( n )
+        , m_theta( theta )
+        , m_scrambled( scrambled )
+        , m_zeta_n( zeta( n, theta ) )
+        , m_alpha( 1.0 / ( 1.0 - theta ) )
+        , m_eta( ( 1.0 - std::pow( 2.0 / static_cast< double >( n ), 1.0 - theta ) ) / ( 1.0 - zeta( 2, theta ) / m_zeta_n ) )
+    {
+    }
+
+    template < typename Rng >
+    std::uint64_t operator()( Rng& rng )
+    {
+        const double u = std::uniform_real_distribution< double >( 0.0, 1.0 )( rng );
+        const double uz = u * m_zeta_n;
+
+        std::uint64_t rank;
+        if( uz < 1.0 )
+        {
+            rank = 0;
+        }
+        else if( uz < 1.0 + std::pow( 0.5, m_theta ) )
+        {
+            rank = 1;
+        }
+        else
+        {
+            rank = static_cast< std::uint64_t >( static_cast< double >( m_n ) * std::pow( m_eta * u - m_eta + 1.0, m_alpha ) );
+        }
+        rank = std::min( rank, m_n - 1 );
+
+        return m_scrambled ? fnv1a( rank ) % m_n : rank;
+    }
+
+private:
+    static double zeta( std::uint64_t n, double theta )
+    {
+        double sum = 0.0;
+        for( std::uint64_t i = 1; i <= n; i++ )
+        {
+            sum += 1.0 / std::pow( static_cast< double >( i ), theta );
+        }
+        return sum;
+    }
+
+    static std::uint64_t fnv1a( std::uint64_t value )
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        for( int i = 0; i < 8; i++ )
+        {
+            hash ^= value & 0xff;
+            hash *= 0x100000001b3ULL;
+            value >>= 8;
+        }
+        return hash;
+    }
+
+private:
+    const std::uint64_t m_n;
+    const double m_theta;
+    const bool m_scrambled;
+    const double m_zeta_n;
+    const double m_alpha;
+    const double m_eta;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "BPlusTree.hpp"
+#include "Driver.hpp"
+#include "Mix.hpp"
+#include "Trace.hpp"
+
+//
+// YCSB-style workload driver for BPlusTree.
+//
+// btree_ycsb [--workload=A..F] [--distribution=uniform|zipfian|latest]
+//            [--records=N] [--operations=N] [--threads=N] [--order=N]
+//            [--seed=N] [--record-trace=FILE] [--replay=FILE] [--replicas=N]
+//
+// The tree is loaded with --records keys, then runs either the generated
+// operations of the workload or, with --replay, those of a trace file.
+// --record-trace saves the generated operations for a later replay.
+// --replicas keeps N copies of the internal levels, spread over the NUMA
+// nodes (see BPlusTree::set_replication()).
+//
+
+namespace
+{
+
+struct Options
+{
+    std::string m_workload = "A";
+    std::string m_distribution;
+    std::uint64_t m_records = 100000;
+    std::uint64_t m_operations = 1000000;
+    std::size_t m_threads = 1;
+    std::size_t m_order = 64;
+    std::uint64_t m_seed = 1;
+    std::string m_record_trace;
+    std::string m_replay;
+    std::size_t m_replicas = 0;
+};
+
+std::uint64_t to_number( const std::string& name, const std::string& text )
+{
+    char* end = nullptr;
+    const unsigned long long n = std::strtoull( text.c_str(), &end, 10 );
+    if( text.empty() || *end || text[ 0 ] == '-' )
+    {
+        throw std::runtime_error( "Invalid value of --" + name + ": " + text );
+    }
+    return n;
+}
+
+Options parse( int argc, char* argv[] )
+{
+    Options options;
+    for( int i = 1; i < argc; i++ )
+    {
+        const std::string arg = argv[ i ];
+        const std::size_t eq = arg.find( '=' );
+        if( arg.compare( 0, 2, "--" ) || eq == std::string::npos )
+        {
+            throw std::runtime_error( "Invalid argument: " + arg );
+        }
+        const std::string name = arg.substr( 2, eq - 2 );
+        const std::string value = arg.substr( eq + 1 );
+
+        if( name == "workload" )
+        {
+            options.m_workload = value;
+        }
+        else if( name == "distribution" )
+        {
+            options.m_distribution = value;
+        }
+        else if( name == "records" )
+        {
+            options.m_records = to_number( name, value );
+        }
+        else if( name == "operations" )
+        {
+            options.m_operations = to_number( name, value );
+        }
+        else if( name == "threads" )
+        {
+            options.m_threads = static_cast< std::size_t >( to_number( name, value ) );
+        }
+        else if( name == "order" )
+        {
+            options.m_order = static_cast< std::size_t >( to_number( name, value ) );
+        }
+        else if( name == "seed" )
+        {
+            options.m_seed = to_number( name, value );
+        }
+        else if( name == "record-trace" )
+        {
+            options.m_record_trace = value;
+        }
+        else if( name == "replay" )
+        {
+            options.m_replay = value;
+        }
+        else if( name == "replicas" )
+        {
+            options.m_replicas = static_cast< std::size_t >( to_number( name, value ) );
+        }
+        else
+        {
+            throw std::runtime_error( "Unknown option: --" + name );
+        }
+    }
+    return options;
+}
+
+std::vector< Operation > operations( const Options& options )
+{
+    if( !options.m_replay.empty() )
+    {
+        std::ifstream in( options.m_replay );
+        if( !in )
+        {
+            throw std::runtime_error( "Cannot open " + options.m_replay );
+        }
+        return Trace::read( in );
+    }
+
+    Mix mix = Mix::standard( options.m_workload );
+    if( !options.m_distribution.empty() )
+    {
+        mix.m_distribution = Mix::parse_distribution( options.m_distribution );
+    }
+    std::vector< Operation > ops = mix.generate( options.m_records, options.m_operations, options.m_seed );
+
+    if( !options.m_record_trace.empty() )
+    {
+        std::ofstream out( options.m_record_trace );
+        Trace::write( out, ops );
+        if( !out )
+        {
+            throw std::runtime_error( "Cannot write " + options.m_record_trace );
+        }
+    }
+    return ops;
+}
+
+}
+
+//
+//
+//
+int main( int argc, char* argv[] )
+{
+    try
+    {
+        const Options options = parse( argc, argv );
+        const std::vector< Operation > ops = operations( options );
+
+        BPlusTree tree( options.m_order );
+        Driver driver( tree, options.m_threads );
+        driver.load( options.m_records );
+        if( options.m_replicas )
+        {
+            tree.set_replication( true, options.m_replicas );
+        }
+
+        std::cout << "workload:   " << ( options.m_replay.empty() ? options.m_workload : options.m_replay ) << "\n";
+        std::cout << "records:    " << options.m_records << "\n";
+        std::cout << "threads:    " << options.m_threads << "\n";
+        std::cout << "order:      " << options.m_order << "\n";
+        std::cout << "replicas:   " << tree.replica_no() << "\n";
+        driver.run( ops ).print( std::cout );
+#ifdef BTREE_STATS
+        std::cout << "\n";
+        tree.metrics().write_prometheus( std::cout );
+#endif
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << "btree_ycsb: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}